@@ -0,0 +1,270 @@
+/*
+ * Host unit test for the asset store on a simulated NOR flash
+ * Covers upload, lookup and rescan, duplicate keys refused before any
+ * erase, upload errors (offset, length, hash), a full partition,
+ * erase_all, and a power cut at every flash operation of an upload: after
+ * each, a rescan must show the earlier assets intact and the new one either
+ * complete or absent, and the store must take the next upload.
+ *
+ * The store only asks its io hook for a key; FNV-1a stands in for the
+ * truncated SHA-256 here.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "asset_store.h"
+#include "nor_flash_sim.h"
+
+#define SECTOR ASSET_STORE_SECTOR
+#define PARTITION (16 * SECTOR)
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static void fnv_hash(const uint8_t *data, size_t len, uint8_t key[ASSET_KEY_LEN], void *ctx)
+{
+    (void)ctx;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 0x100000001b3ULL;
+    }
+    for (int i = 0; i < ASSET_KEY_LEN; i++) {
+        key[i] = (uint8_t)(h >> (8 * i));
+    }
+}
+
+typedef struct {
+    uint8_t data[3 * SECTOR];
+    uint32_t size;
+    uint8_t key[ASSET_KEY_LEN];
+} asset_t;
+
+static void make_asset(asset_t *a, uint32_t size, uint8_t seed)
+{
+    a->size = size;
+    for (uint32_t i = 0; i < size; i++) {
+        a->data[i] = (uint8_t)(seed + i * 7 + (i >> 8));
+    }
+    fnv_hash(a->data, size, a->key, NULL);
+}
+
+static void mount(asset_store_t *s, nor_flash_sim_t *f)
+{
+    asset_store_io_t io = {
+        .write = nor_flash_sim_write,
+        .erase = nor_flash_sim_erase,
+        .hash = fnv_hash,
+        .ctx = f,
+    };
+    asset_store_init(s, f->mem, f->size, &io);
+}
+
+// Upload in fragments of chunk bytes, the way asset_task feeds the ring
+static asset_store_status_t upload(asset_store_t *s, const asset_t *a, uint32_t chunk)
+{
+    asset_store_status_t status = asset_store_begin(s, a->key, ASSET_TYPE_BLOB, a->size);
+    for (uint32_t off = 0; status == ASSET_STORE_OK && off < a->size; off += chunk) {
+        uint32_t n = a->size - off < chunk ? a->size - off : chunk;
+        status = asset_store_write(s, off, a->data + off, n);
+    }
+    return status == ASSET_STORE_OK ? asset_store_finish(s) : status;
+}
+
+static bool stored(const asset_store_t *s, const asset_t *a)
+{
+    uint8_t type;
+    uint32_t size;
+    const uint8_t *data = asset_store_find(s, a->key, &type, &size);
+    return data != NULL && size == a->size && memcmp(data, a->data, a->size) == 0;
+}
+
+static void test_upload_and_rescan(void)
+{
+    static asset_t a, b;
+    make_asset(&a, 1000, 1);
+    make_asset(&b, 2 * SECTOR, 2);  // header pushes it into a third sector
+
+    nor_flash_sim_t f;
+    CHECK(nor_flash_sim_init(&f, PARTITION, SECTOR));
+    asset_store_t s;
+    mount(&s, &f);
+    CHECK(s.count == 0 && s.end == 0);
+
+    CHECK(upload(&s, &a, 244) == ASSET_STORE_OK);
+    CHECK(upload(&s, &b, 509) == ASSET_STORE_OK);
+    CHECK(stored(&s, &a) && stored(&s, &b));
+    CHECK(s.end == 4 * SECTOR);
+
+    // The found pointer is into the mapping, not a copy
+    uint8_t type;
+    uint32_t size;
+    CHECK(asset_store_find(&s, a.key, &type, &size) == f.mem + ASSET_STORE_HEADER_SIZE);
+    CHECK(type == ASSET_TYPE_BLOB);
+
+    // Boot again from what is in flash
+    asset_store_t again;
+    mount(&again, &f);
+    CHECK(again.count == 2 && again.end == 4 * SECTOR);
+    CHECK(stored(&again, &a) && stored(&again, &b));
+
+    // Duplicate: refused before anything is erased
+    uint32_t ops = f.ops;
+    CHECK(asset_store_begin(&again, a.key, ASSET_TYPE_BLOB, a.size) == ASSET_STORE_ERR_DUPLICATE);
+    CHECK(f.ops == ops);
+
+    CHECK(f.violations == 0 && f.misaligned == 0);
+    nor_flash_sim_free(&f);
+}
+
+static void test_upload_errors(void)
+{
+    static asset_t a, b;
+    make_asset(&a, 3000, 3);
+    make_asset(&b, 500, 4);
+
+    nor_flash_sim_t f;
+    CHECK(nor_flash_sim_init(&f, PARTITION, SECTOR));
+    asset_store_t s;
+    mount(&s, &f);
+
+    CHECK(asset_store_write(&s, 0, a.data, 10) == ASSET_STORE_ERR_NOT_OPEN);
+    CHECK(asset_store_finish(&s) == ASSET_STORE_ERR_NOT_OPEN);
+
+    CHECK(asset_store_begin(&s, a.key, ASSET_TYPE_BLOB, a.size) == ASSET_STORE_OK);
+    CHECK(asset_store_write(&s, 0, a.data, 100) == ASSET_STORE_OK);
+    CHECK(asset_store_write(&s, 200, a.data + 200, 100) == ASSET_STORE_ERR_OFFSET);
+    CHECK(asset_store_write(&s, 100, a.data + 100, 100) == ASSET_STORE_ERR_NOT_OPEN);
+
+    CHECK(asset_store_begin(&s, a.key, ASSET_TYPE_BLOB, a.size) == ASSET_STORE_OK);
+    CHECK(asset_store_write(&s, 0, a.data, a.size + 1) == ASSET_STORE_ERR_TOO_LONG);
+
+    CHECK(asset_store_begin(&s, a.key, ASSET_TYPE_BLOB, a.size) == ASSET_STORE_OK);
+    CHECK(asset_store_write(&s, 0, a.data, a.size - 1) == ASSET_STORE_OK);
+    CHECK(asset_store_finish(&s) == ASSET_STORE_ERR_INCOMPLETE);
+
+    // Data that does not hash to the announced key is never published
+    CHECK(asset_store_begin(&s, a.key, ASSET_TYPE_BLOB, b.size) == ASSET_STORE_OK);
+    CHECK(asset_store_write(&s, 0, b.data, b.size) == ASSET_STORE_OK);
+    CHECK(asset_store_finish(&s) == ASSET_STORE_ERR_HASH);
+    CHECK(s.count == 0 && s.end == 0);
+
+    asset_store_stats_t stats;
+    asset_store_get_stats(&s, &stats);
+    CHECK(stats.failures == 4 && stats.uploads == 0);
+
+    // The abandoned PENDING records end the log; their sectors are erased and reused
+    CHECK(upload(&s, &a, 244) == ASSET_STORE_OK);
+    asset_store_t again;
+    mount(&again, &f);
+    CHECK(again.count == 1 && stored(&again, &a));
+    CHECK(f.erase_counts[0] == 5);
+
+    CHECK(f.violations == 0 && f.misaligned == 0);
+    nor_flash_sim_free(&f);
+}
+
+static void test_full_and_erase_all(void)
+{
+    static asset_t a, big;
+    make_asset(&a, SECTOR - ASSET_STORE_HEADER_SIZE, 5);  // exactly one sector
+
+    nor_flash_sim_t f;
+    CHECK(nor_flash_sim_init(&f, 4 * SECTOR, SECTOR));
+    asset_store_t s;
+    mount(&s, &f);
+
+    CHECK(upload(&s, &a, 509) == ASSET_STORE_OK);
+    CHECK(s.end == SECTOR);
+    // Three sectors left: a record needing four is refused before any erase
+    uint32_t ops = f.ops;
+    make_asset(&big, 3 * SECTOR - ASSET_STORE_HEADER_SIZE + 1, 6);
+    CHECK(asset_store_begin(&s, big.key, ASSET_TYPE_BLOB, big.size) == ASSET_STORE_ERR_FULL);
+    CHECK(asset_store_begin(&s, big.key, ASSET_TYPE_BLOB, UINT32_MAX) == ASSET_STORE_ERR_FULL);
+    CHECK(f.ops == ops);
+    make_asset(&big, 3 * SECTOR - ASSET_STORE_HEADER_SIZE, 6);
+    CHECK(upload(&s, &big, 509) == ASSET_STORE_OK);
+    CHECK(s.end == 4 * SECTOR);
+
+    CHECK(asset_store_erase_all(&s) == ASSET_STORE_OK);
+    CHECK(!stored(&s, &a) && s.end == 0);
+    asset_store_t again;
+    mount(&again, &f);
+    CHECK(again.count == 0 && again.end == 0);
+    CHECK(upload(&again, &big, 509) == ASSET_STORE_OK);
+
+    CHECK(f.violations == 0 && f.misaligned == 0);
+    nor_flash_sim_free(&f);
+}
+
+static void test_power_cut(void)
+{
+    static asset_t a, b, c;
+    make_asset(&a, 700, 7);
+    make_asset(&b, SECTOR + 300, 8);
+    make_asset(&c, 900, 9);
+
+    // Count the operations of an uninterrupted upload of b
+    uint32_t upload_ops;
+    {
+        nor_flash_sim_t f;
+        CHECK(nor_flash_sim_init(&f, PARTITION, SECTOR));
+        asset_store_t s;
+        mount(&s, &f);
+        CHECK(upload(&s, &a, 244) == ASSET_STORE_OK);
+        uint32_t before = f.ops;
+        CHECK(upload(&s, &b, 244) == ASSET_STORE_OK);
+        upload_ops = f.ops - before;
+        nor_flash_sim_free(&f);
+    }
+    CHECK(upload_ops > 3);
+
+    for (uint32_t cut = 0; cut < upload_ops; cut++) {
+        nor_flash_sim_t f;
+        CHECK(nor_flash_sim_init(&f, PARTITION, SECTOR));
+        asset_store_t s;
+        mount(&s, &f);
+        CHECK(upload(&s, &a, 244) == ASSET_STORE_OK);
+
+        f.cut_at = f.ops + cut;
+        CHECK(upload(&s, &b, 244) != ASSET_STORE_OK);
+        nor_flash_sim_power_on(&f);
+
+        asset_store_t again;
+        mount(&again, &f);
+        CHECK(stored(&again, &a));
+        // The state word is the last write: a cut anywhere before it completes leaves b out
+        CHECK(again.count == 1);
+        CHECK(!stored(&again, &b));
+
+        // Uploads work after the reboot, and b can be sent again
+        CHECK(upload(&again, &c, 244) == ASSET_STORE_OK);
+        CHECK(upload(&again, &b, 244) == ASSET_STORE_OK);
+        asset_store_t third;
+        mount(&third, &f);
+        CHECK(third.count == 3 && stored(&third, &a) && stored(&third, &b) && stored(&third, &c));
+
+        CHECK(f.violations == 0 && f.misaligned == 0);
+        nor_flash_sim_free(&f);
+    }
+}
+
+int main(void)
+{
+    test_upload_and_rescan();
+    test_upload_errors();
+    test_full_and_erase_all();
+    test_power_cut();
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("asset_store_test passed\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Host benchmark for the command frame parser
+ * Reports parse and encode throughput, in frames/s and MB/s of frame bytes,
+ * for the frames the Flutter app sends: a single slider op, the color and
+ * text update of one send, every operation at once with the longest text,
+ * and a frame rejected on its last op.
+ */
+
+#define _POSIX_C_SOURCE 199309L  // clock_gettime
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "cmd_frame.h"
+
+#define MIN_BENCH_NS 200000000LL  // run each case for at least 0.2 s
+#define BATCH 10000
+
+typedef struct {
+    const char *name;
+    uint8_t data[CMD_FRAME_ENCODED_MAX + 8];
+    size_t len;
+    cmd_frame_status_t expect;
+} bench_case_t;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static size_t encode_case(bench_case_t *c, const cmd_frame_t *frame)
+{
+    c->len = cmd_frame_encode(frame, c->data, sizeof(c->data));
+    return c->len;
+}
+
+static int bench_parse(const bench_case_t *c)
+{
+    cmd_frame_t frame;
+    uint32_t sink = 0;
+    uint64_t frames = 0;
+    int64_t start = now_ns();
+    int64_t elapsed;
+    do {
+        for (int i = 0; i < BATCH; i++) {
+            if (cmd_frame_parse(c->data, c->len, &frame) != c->expect) {
+                fprintf(stderr, "%s: unexpected status\n", c->name);
+                return 1;
+            }
+            sink += frame.fields;
+        }
+        frames += BATCH;
+        elapsed = now_ns() - start;
+    } while (elapsed < MIN_BENCH_NS);
+
+    double seconds = elapsed / 1e9;
+    printf("%-14s parse  %4zu B %8.2f M frames/s %8.1f MB/s (%u)\n", c->name, c->len, frames / seconds / 1e6,
+           frames * c->len / seconds / 1e6, (unsigned int)(sink & 0xFF));
+    return 0;
+}
+
+static void bench_encode(const bench_case_t *c)
+{
+    cmd_frame_t frame;
+    cmd_frame_parse(c->data, c->len, &frame);
+    uint8_t out[CMD_FRAME_ENCODED_MAX];
+    uint32_t sink = 0;
+    uint64_t frames = 0;
+    int64_t start = now_ns();
+    int64_t elapsed;
+    do {
+        for (int i = 0; i < BATCH; i++) {
+            sink += (uint32_t)cmd_frame_encode(&frame, out, sizeof(out));
+            frame.brightness = (uint8_t)sink;  // keep the compiler from hoisting the call
+        }
+        frames += BATCH;
+        elapsed = now_ns() - start;
+    } while (elapsed < MIN_BENCH_NS);
+
+    double seconds = elapsed / 1e9;
+    printf("%-14s encode %4zu B %8.2f M frames/s %8.1f MB/s (%u)\n", c->name, c->len, frames / seconds / 1e6,
+           frames * c->len / seconds / 1e6, (unsigned int)(sink & 0xFF));
+}
+
+int main(void)
+{
+    static bench_case_t cases[4];
+    cmd_frame_t frame;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.fields = CMD_FIELD_BRIGHTNESS;
+    frame.brightness = 200;
+    cases[0].name = "brightness";
+    encode_case(&cases[0], &frame);
+
+    frame.fields = CMD_FIELD_BG | CMD_FIELD_TEXT;
+    frame.bg_rgb888 = 0x2080C0;
+    frame.text_len = (uint8_t)snprintf(frame.text, sizeof(frame.text), "Living room 21.5 C");
+    cases[1].name = "color+text";
+    encode_case(&cases[1], &frame);
+
+    frame.fields = CMD_FIELD_BG | CMD_FIELD_TEXT | CMD_FIELD_TEXT_COLOR | CMD_FIELD_FONT | CMD_FIELD_BRIGHTNESS |
+                   CMD_FIELD_ASSET;
+    memset(frame.text, 'x', CMD_FRAME_TEXT_MAX);
+    frame.text_len = CMD_FRAME_TEXT_MAX;
+    frame.text_rgb888 = 0xFFFFFF;
+    frame.font_size = 24;
+    frame.asset_visible = 1;
+    memcpy(frame.asset_key, "ICONWIFI", CMD_FRAME_ASSET_KEY_LEN);
+    frame.asset_x = 16;
+    frame.asset_y = 32;
+    cases[2].name = "all ops";
+    encode_case(&cases[2], &frame);
+
+    // The full frame with COMMIT replaced by an unknown op: the parser walks every op, then rejects
+    cases[3] = cases[2];
+    cases[3].name = "rejected";
+    cases[3].data[cases[3].len - 2] = 0x7F;
+    cases[3].expect = CMD_FRAME_ERR_UNKNOWN_OP;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (cases[i].len == 0 || bench_parse(&cases[i]) != 0) {
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < 3; i++) {
+        bench_encode(&cases[i]);
+    }
+    return 0;
+}
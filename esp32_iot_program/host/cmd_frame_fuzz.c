@@ -0,0 +1,223 @@
+/*
+ * Fuzz target for the command frame parser
+ * Every input goes through cmd_frame_parse; an accepted frame is encoded
+ * again and must parse back to the same operations, and the re-encoding
+ * must be byte-identical. With -DCMD_FRAME_LIBFUZZER=ON (clang) this is a
+ * libFuzzer target; built normally it also serves as an AFL harness, taking
+ * the input as file argument (afl-fuzz ... -- ./cmd_frame_fuzz @@).
+ *
+ * Without libFuzzer a small driver replays the files given on the command
+ * line, or mutates a built-in seed corpus with a fixed seed, so ctest runs
+ * it under AddressSanitizer and UndefinedBehaviorSanitizer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmd_frame.h"
+
+#define MUTATIONS 200000u
+
+static void fail(const char *what)
+{
+    fprintf(stderr, "cmd_frame_fuzz: %s\n", what);
+    abort();
+}
+
+// Compare the operations both frames carry; values of absent operations are unspecified
+static int frames_equal(const cmd_frame_t *a, const cmd_frame_t *b)
+{
+    if (a->fields != b->fields) {
+        return 0;
+    }
+    if ((a->fields & CMD_FIELD_BG) && a->bg_rgb888 != b->bg_rgb888) {
+        return 0;
+    }
+    if ((a->fields & CMD_FIELD_TEXT) &&
+        (a->text_len != b->text_len || memcmp(a->text, b->text, a->text_len) != 0)) {
+        return 0;
+    }
+    if ((a->fields & CMD_FIELD_TEXT_COLOR) && a->text_rgb888 != b->text_rgb888) {
+        return 0;
+    }
+    if ((a->fields & CMD_FIELD_FONT) && a->font_size != b->font_size) {
+        return 0;
+    }
+    if ((a->fields & CMD_FIELD_BRIGHTNESS) && a->brightness != b->brightness) {
+        return 0;
+    }
+    if (a->fields & CMD_FIELD_ASSET) {
+        if (a->asset_visible != b->asset_visible) {
+            return 0;
+        }
+        if (a->asset_visible && (memcmp(a->asset_key, b->asset_key, CMD_FRAME_ASSET_KEY_LEN) != 0 ||
+                                 a->asset_x != b->asset_x || a->asset_y != b->asset_y)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    cmd_frame_t frame;
+    cmd_frame_status_t status = cmd_frame_parse(data, size, &frame);
+    if (cmd_frame_status_str(status)[0] == '?') {
+        fail("status without a name");
+    }
+    if (frame.text_len > CMD_FRAME_TEXT_MAX || frame.text[frame.text_len] != '\0') {
+        fail("text not terminated within bounds");
+    }
+    if (status != CMD_FRAME_OK) {
+        return 0;
+    }
+    if ((frame.fields & CMD_FIELD_FONT) && !cmd_frame_font_supported(frame.font_size)) {
+        fail("accepted an unsupported font size");
+    }
+
+    uint8_t encoded[CMD_FRAME_ENCODED_MAX];
+    size_t len = cmd_frame_encode(&frame, encoded, sizeof(encoded));
+    if (len == 0 || len > size) {
+        fail("encoding is empty or longer than the accepted input");
+    }
+    cmd_frame_t again;
+    if (cmd_frame_parse(encoded, len, &again) != CMD_FRAME_OK || !frames_equal(&frame, &again)) {
+        fail("encoded frame does not parse back to the same operations");
+    }
+    uint8_t reencoded[CMD_FRAME_ENCODED_MAX];
+    if (cmd_frame_encode(&again, reencoded, sizeof(reencoded)) != len || memcmp(encoded, reencoded, len) != 0) {
+        fail("re-encoding is not stable");
+    }
+    if (cmd_frame_encode(&frame, encoded, len - 1) != 0) {
+        fail("encoded into a buffer that is too short");
+    }
+    return 0;
+}
+
+#ifndef CMD_FRAME_LIBFUZZER
+
+static uint32_t rng_state = 0x2545F491;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Frames the Flutter app sends, plus the edges of each operation
+static const uint8_t seed_color_text[] = {0x01, 3, 0x20, 0x40, 0x80, 0x02, 5, 'h', 'e', 'l', 'l', 'o',
+                                          0x03, 3, 0xFF, 0xFF, 0xFF, 0x04, 1, 24, 0xFF, 0};
+static const uint8_t seed_brightness[] = {0x05, 1, 128, 0xFF, 0};
+static const uint8_t seed_asset[] = {0x06, 12, 1, 2, 3, 4, 5, 6, 7, 8, 10, 0, 20, 0, 0x06, 0, 0xFF, 0};
+static const uint8_t seed_repeat[] = {0x01, 3, 1, 2, 3, 0x01, 3, 4, 5, 6, 0x02, 0, 0xFF, 0};
+static const uint8_t seed_commit[] = {0xFF, 0};
+
+static const struct {
+    const uint8_t *data;
+    size_t len;
+} seeds[] = {
+    {seed_color_text, sizeof(seed_color_text)},
+    {seed_brightness, sizeof(seed_brightness)},
+    {seed_asset, sizeof(seed_asset)},
+    {seed_repeat, sizeof(seed_repeat)},
+    {seed_commit, sizeof(seed_commit)},
+};
+
+#define INPUT_MAX 512
+
+// Bit flips, random bytes, off-by-one edits (which hit the length bytes), insertions, truncation and
+// appended seeds
+static size_t mutate(uint8_t *buf, size_t len)
+{
+    int edits = 1 + rng() % 4;
+    for (int i = 0; i < edits; i++) {
+        switch (rng() % 6) {
+        case 0:
+            if (len) {
+                buf[rng() % len] ^= (uint8_t)(1u << (rng() % 8));
+            }
+            break;
+        case 1:
+            if (len) {
+                buf[rng() % len] = (uint8_t)rng();
+            }
+            break;
+        case 2:
+            if (len) {
+                size_t at = rng() % len;
+                buf[at] = (uint8_t)(buf[at] + (rng() % 3) - 1);
+            }
+            break;
+        case 3:
+            if (len < INPUT_MAX) {
+                size_t at = rng() % (len + 1);
+                memmove(&buf[at + 1], &buf[at], len - at);
+                buf[at] = (uint8_t)rng();
+                len++;
+            }
+            break;
+        case 4:
+            len = len ? rng() % (len + 1) : 0;
+            break;
+        default: {
+            size_t s = rng() % (sizeof(seeds) / sizeof(seeds[0]));
+            size_t n = seeds[s].len;
+            if (len + n <= INPUT_MAX) {
+                memcpy(&buf[len], seeds[s].data, n);
+                len += n;
+            }
+            break;
+        }
+        }
+    }
+    return len;
+}
+
+static int replay_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    static uint8_t buf[1 << 16];
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, len);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        int errors = 0;
+        for (int i = 1; i < argc; i++) {
+            errors += replay_file(argv[i]);
+        }
+        printf("cmd_frame_fuzz: replayed %d inputs\n", argc - 1 - errors);
+        return errors ? 1 : 0;
+    }
+
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < MUTATIONS; i++) {
+        uint8_t buf[INPUT_MAX];
+        size_t s = rng() % (sizeof(seeds) / sizeof(seeds[0]));
+        size_t len = seeds[s].len;
+        memcpy(buf, seeds[s].data, len);
+        len = mutate(buf, len);
+
+        // Copy to an exact-size heap block so the sanitizer catches reads past the end
+        uint8_t *input = malloc(len ? len : 1);
+        memcpy(input, buf, len);
+        cmd_frame_t frame;
+        accepted += cmd_frame_parse(input, len, &frame) == CMD_FRAME_OK;
+        LLVMFuzzerTestOneInput(input, len);
+        free(input);
+    }
+    printf("cmd_frame_fuzz: %u mutated inputs, %u accepted\n", MUTATIONS, accepted);
+    return 0;
+}
+
+#endif  // CMD_FRAME_LIBFUZZER
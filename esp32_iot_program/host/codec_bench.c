@@ -0,0 +1,345 @@
+/*
+ * Host benchmark for the Q565 image codec
+ * Reports compression ratio and decode throughput per image. Images are
+ * binary PPM (P6) files given on the command line, converted to RGB565;
+ * without arguments a built-in corpus of synthetic UI screens and
+ * photo-like content at panel resolution is used.
+ *
+ * Every image is also round-tripped through the incremental decoder with
+ * random input splits into a slot-sized output buffer, the same way the
+ * firmware feeds image_stream.
+ */
+
+#define _POSIX_C_SOURCE 199309L  // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "image_codec.h"
+
+#define PANEL_W 320
+#define PANEL_H 172
+#define SLOT_PIXELS (PANEL_W * 8)  // one image_stream slot
+#define MIN_BENCH_NS 200000000LL   // decode each image for at least 0.2 s
+
+typedef struct {
+    char name[64];
+    int w;
+    int h;
+    uint16_t *pixels;  // native RGB565
+} image_t;
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint16_t rgb565(int r, int g, int b)
+{
+    r = r < 0 ? 0 : r > 255 ? 255 : r;
+    g = g < 0 ? 0 : g > 255 ? 255 : g;
+    b = b < 0 ? 0 : b > 255 ? 255 : b;
+    return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static image_t image_new(const char *name, int w, int h)
+{
+    image_t img = {.w = w, .h = h};
+    snprintf(img.name, sizeof(img.name), "%s", name);
+    img.pixels = calloc((size_t)w * h, sizeof(uint16_t));
+    return img;
+}
+
+static void fill_rect(image_t *img, int x, int y, int w, int h, uint16_t color)
+{
+    for (int j = y; j < y + h && j < img->h; j++) {
+        for (int i = x; i < x + w && i < img->w; i++) {
+            img->pixels[j * img->w + i] = color;
+        }
+    }
+}
+
+// Label-like text: random glyph cells with anti-aliased edge pixels
+static void draw_text(image_t *img, int x, int y, int chars, int glyph_w, int glyph_h, int fr, int fg, int fb,
+                      int br, int bg, int bb)
+{
+    for (int c = 0; c < chars; c++) {
+        for (int j = 0; j < glyph_h; j++) {
+            for (int i = 0; i < glyph_w - 2; i++) {
+                uint32_t v = rng() % 8;
+                int level = v < 5 ? 0 : v < 6 ? 128 : 255;  // mostly background, some edge, some ink
+                int px = x + c * glyph_w + i;
+                int py = y + j;
+                if (px < img->w && py < img->h) {
+                    img->pixels[py * img->w + px] = rgb565(br + (fr - br) * level / 255, bg + (fg - bg) * level / 255,
+                                                           bb + (fb - bb) * level / 255);
+                }
+            }
+        }
+    }
+}
+
+static image_t make_ui_label(void)
+{
+    image_t img = image_new("ui_label", PANEL_W, PANEL_H);
+    fill_rect(&img, 0, 0, PANEL_W, PANEL_H, rgb565(0, 0, 160));
+    draw_text(&img, 40, 72, 12, 20, 28, 255, 255, 255, 0, 0, 160);
+    fill_rect(&img, 300, 10, 10, 10, rgb565(0, 255, 0));
+    return img;
+}
+
+static image_t make_ui_widgets(void)
+{
+    image_t img = image_new("ui_widgets", PANEL_W, PANEL_H);
+    fill_rect(&img, 0, 0, PANEL_W, PANEL_H, rgb565(240, 240, 240));
+    fill_rect(&img, 0, 0, PANEL_W, 24, rgb565(33, 150, 243));
+    draw_text(&img, 8, 4, 10, 12, 16, 255, 255, 255, 33, 150, 243);
+    for (int b = 0; b < 3; b++) {
+        int bx = 12 + b * 102;
+        // Button with a vertical gradient and a one pixel border
+        for (int j = 0; j < 40; j++) {
+            fill_rect(&img, bx, 40 + j, 92, 1, rgb565(80 + j, 120 + j, 200 + j / 2));
+        }
+        fill_rect(&img, bx, 40, 92, 1, rgb565(40, 60, 120));
+        fill_rect(&img, bx, 79, 92, 1, rgb565(40, 60, 120));
+        draw_text(&img, bx + 14, 52, 5, 12, 16, 255, 255, 255, 100, 140, 210);
+    }
+    // Slider track and knob
+    fill_rect(&img, 20, 120, 280, 6, rgb565(200, 200, 200));
+    fill_rect(&img, 20, 120, 170, 6, rgb565(33, 150, 243));
+    fill_rect(&img, 182, 112, 22, 22, rgb565(255, 255, 255));
+    draw_text(&img, 20, 146, 18, 12, 16, 60, 60, 60, 240, 240, 240);
+    return img;
+}
+
+static image_t make_gradient(void)
+{
+    image_t img = image_new("gradient", PANEL_W, PANEL_H);
+    for (int y = 0; y < PANEL_H; y++) {
+        for (int x = 0; x < PANEL_W; x++) {
+            img.pixels[y * PANEL_W + x] = rgb565(x * 255 / PANEL_W, y * 255 / PANEL_H, 255 - x * 255 / PANEL_W);
+        }
+    }
+    return img;
+}
+
+// Smooth value noise plus sensor grain, a stand-in for a photo
+static image_t make_photo(const char *name, int grain)
+{
+    image_t img = image_new(name, PANEL_W, PANEL_H);
+    enum { CELL = 16 };
+    int gw = PANEL_W / CELL + 2;
+    int gh = PANEL_H / CELL + 2;
+    int *lattice = malloc(sizeof(int) * gw * gh * 3);
+    for (int i = 0; i < gw * gh * 3; i++) {
+        lattice[i] = rng() % 256;
+    }
+    for (int y = 0; y < PANEL_H; y++) {
+        for (int x = 0; x < PANEL_W; x++) {
+            int cx = x / CELL;
+            int cy = y / CELL;
+            int fx = x % CELL;
+            int fy = y % CELL;
+            int c[3];
+            for (int k = 0; k < 3; k++) {
+                int v00 = lattice[(cy * gw + cx) * 3 + k];
+                int v10 = lattice[(cy * gw + cx + 1) * 3 + k];
+                int v01 = lattice[((cy + 1) * gw + cx) * 3 + k];
+                int v11 = lattice[((cy + 1) * gw + cx + 1) * 3 + k];
+                int top = v00 * (CELL - fx) + v10 * fx;
+                int bottom = v01 * (CELL - fx) + v11 * fx;
+                c[k] = (top * (CELL - fy) + bottom * fy) / (CELL * CELL);
+                if (grain > 0) {
+                    c[k] += (int)(rng() % (2 * grain + 1)) - grain;
+                }
+            }
+            img.pixels[y * PANEL_W + x] = rgb565(c[0], c[1], c[2]);
+        }
+    }
+    free(lattice);
+    return img;
+}
+
+static image_t make_noise(void)
+{
+    image_t img = image_new("noise", PANEL_W, PANEL_H);
+    for (int i = 0; i < PANEL_W * PANEL_H; i++) {
+        img.pixels[i] = (uint16_t)rng();
+    }
+    return img;
+}
+
+static int read_token(FILE *f)
+{
+    int c;
+    int value = 0;
+    do {
+        c = fgetc(f);
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = fgetc(f);
+            }
+        }
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    while (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        c = fgetc(f);
+    }
+    return value;
+}
+
+static int load_ppm(const char *path, image_t *img)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    if (fgetc(f) != 'P' || fgetc(f) != '6') {
+        fclose(f);
+        return -1;
+    }
+    int w = read_token(f);
+    int h = read_token(f);
+    int maxval = read_token(f);
+    if (w <= 0 || h <= 0 || maxval != 255) {
+        fclose(f);
+        return -1;
+    }
+    const char *base = strrchr(path, '/');
+    *img = image_new(base ? base + 1 : path, w, h);
+    for (int i = 0; i < w * h; i++) {
+        int r = fgetc(f);
+        int g = fgetc(f);
+        int b = fgetc(f);
+        if (b == EOF) {
+            fclose(f);
+            free(img->pixels);
+            return -1;
+        }
+        img->pixels[i] = rgb565(r, g, b);
+    }
+    fclose(f);
+    return 0;
+}
+
+// Decode with random input splits into a slot-sized buffer and compare against the source
+static int verify(const image_t *img, const uint8_t *enc, size_t enc_len, uint8_t *slot)
+{
+    image_codec_decoder_t dec;
+    size_t count = (size_t)img->w * img->h;
+    size_t checked = 0;
+    size_t pos = 0;
+
+    image_codec_decoder_init(&dec, count);
+    while (pos < enc_len || image_codec_decoder_pending(&dec)) {
+        size_t chunk = 1 + rng() % 244;
+        if (chunk > enc_len - pos) {
+            chunk = enc_len - pos;
+        }
+        const uint8_t *in = enc + pos;
+        size_t in_len = chunk;
+        do {
+            size_t produced;
+            if (image_codec_decode(&dec, &in, &in_len, slot, SLOT_PIXELS, &produced) != IMAGE_CODEC_OK) {
+                return -1;
+            }
+            for (size_t i = 0; i < produced; i++) {
+                uint16_t px = (uint16_t)((slot[2 * i] << 8) | slot[2 * i + 1]);
+                if (checked + i >= count || px != img->pixels[checked + i]) {
+                    return -1;
+                }
+            }
+            checked += produced;
+        } while (in_len > 0 || image_codec_decoder_pending(&dec));
+        pos += chunk;
+    }
+    return checked == count ? 0 : -1;
+}
+
+static double bench_decode(const image_t *img, const uint8_t *enc, size_t enc_len, uint8_t *slot)
+{
+    size_t count = (size_t)img->w * img->h;
+    int64_t start = now_ns();
+    int64_t elapsed;
+    long iterations = 0;
+    do {
+        image_codec_decoder_t dec;
+        const uint8_t *in = enc;
+        size_t in_len = enc_len;
+        image_codec_decoder_init(&dec, count);
+        do {
+            size_t produced;
+            image_codec_decode(&dec, &in, &in_len, slot, SLOT_PIXELS, &produced);
+        } while (in_len > 0 || image_codec_decoder_pending(&dec));
+        iterations++;
+        elapsed = now_ns() - start;
+    } while (elapsed < MIN_BENCH_NS);
+    return (double)count * 2 * iterations / (elapsed / 1e9) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    image_t images[32];
+    int image_count = 0;
+
+    if (argc > 1) {
+        for (int i = 1; i < argc && image_count < 32; i++) {
+            if (load_ppm(argv[i], &images[image_count]) == 0) {
+                image_count++;
+            } else {
+                fprintf(stderr, "Skipping %s: not a binary PPM with maxval 255\n", argv[i]);
+            }
+        }
+    } else {
+        images[image_count++] = make_ui_label();
+        images[image_count++] = make_ui_widgets();
+        images[image_count++] = make_gradient();
+        images[image_count++] = make_photo("photo_smooth", 0);
+        images[image_count++] = make_photo("photo_grain", 6);
+        images[image_count++] = make_noise();
+    }
+
+    uint8_t *slot = malloc(SLOT_PIXELS * 2);
+    size_t total_raw = 0;
+    size_t total_enc = 0;
+    int failures = 0;
+
+    printf("%-16s %9s %9s %7s %12s\n", "image", "raw", "encoded", "ratio", "decode MB/s");
+    for (int i = 0; i < image_count; i++) {
+        image_t *img = &images[i];
+        size_t count = (size_t)img->w * img->h;
+        uint8_t *enc = malloc(IMAGE_CODEC_MAX_ENCODED(count));
+        size_t enc_len = image_codec_encode(img->pixels, count, enc);
+
+        if (verify(img, enc, enc_len, slot) != 0) {
+            printf("%-16s round trip FAILED\n", img->name);
+            failures++;
+        } else {
+            double mbps = bench_decode(img, enc, enc_len, slot);
+            printf("%-16s %9zu %9zu %6.2fx %12.1f\n", img->name, count * 2, enc_len,
+                   (double)(count * 2) / enc_len, mbps);
+        }
+        total_raw += count * 2;
+        total_enc += enc_len;
+        free(enc);
+        free(img->pixels);
+    }
+    if (total_enc > 0) {
+        printf("%-16s %9zu %9zu %6.2fx\n", "total", total_raw, total_enc, (double)total_raw / total_enc);
+    }
+    free(slot);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Host unit test for long (prepared) write reassembly
+ * Covers in-order and overlapping fragments, a prepare past the arena, an
+ * offset gap, the busy arena seen by a second client, and execute after a
+ * voided payload, which must report the error and leave the arena usable.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "long_write.h"
+
+#define CAPACITY 64
+#define HANDLE_TEXT 42
+#define HANDLE_COMMAND 43
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static uint8_t arena[CAPACITY + 1];
+static uint8_t payload[CAPACITY + 16];
+
+static void setup(long_write_t *lw)
+{
+    long_write_init(lw, arena, CAPACITY);
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)('a' + i % 26);
+    }
+}
+
+static long_write_status_t prepare(long_write_t *lw, uint16_t handle, uint16_t offset, uint16_t len)
+{
+    return long_write_append(lw, handle, offset, &payload[offset], len);
+}
+
+static void test_reassembly(void)
+{
+    long_write_t lw;
+    setup(&lw);
+
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 20) == LONG_WRITE_OK);
+    CHECK(prepare(&lw, HANDLE_TEXT, 20, 20) == LONG_WRITE_OK);
+    CHECK(prepare(&lw, HANDLE_TEXT, 30, 10) == LONG_WRITE_OK);  // retransmitted tail
+    CHECK(prepare(&lw, HANDLE_TEXT, 40, CAPACITY - 40) == LONG_WRITE_OK);
+    CHECK(prepare(&lw, HANDLE_COMMAND, 0, 1) == LONG_WRITE_ERR_HANDLE);
+
+    uint16_t handle = 0;
+    const uint8_t *data = NULL;
+    size_t len = 0;
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_OK);
+    CHECK(handle == HANDLE_TEXT);
+    CHECK(len == CAPACITY);
+    CHECK(data != NULL && memcmp(data, payload, CAPACITY) == 0 && data[CAPACITY] == '\0');
+    long_write_release(&lw);
+
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_ERR_EMPTY);
+    CHECK(lw.stats.completed == 1);
+    CHECK(lw.stats.bytes == CAPACITY);
+}
+
+static void test_over_capacity(void)
+{
+    long_write_t lw;
+    setup(&lw);
+
+    // A single fragment larger than the arena
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, CAPACITY + 1) == LONG_WRITE_ERR_OVERFLOW);
+    // A fragment that fits by itself but runs past the end after earlier ones
+    long_write_cancel(&lw);
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 40) == LONG_WRITE_OK);
+    CHECK(prepare(&lw, HANDLE_TEXT, 40, 40) == LONG_WRITE_ERR_OVERFLOW);
+    CHECK(lw.stats.rejected_overflow == 2);
+
+    // The rest of the voided payload is rejected too, even fragments that would fit
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 10) == LONG_WRITE_ERR_OVERFLOW);
+    CHECK(lw.stats.rejected_overflow == 2);
+
+    // A plain write of more than the arena holds
+    const uint8_t *stored = NULL;
+    long_write_cancel(&lw);
+    CHECK(long_write_store(&lw, payload, CAPACITY + 1, &stored) == LONG_WRITE_ERR_OVERFLOW);
+    CHECK(long_write_store(&lw, payload, CAPACITY, &stored) == LONG_WRITE_OK);
+    CHECK(stored != NULL && stored[CAPACITY] == '\0');
+    long_write_release(&lw);
+}
+
+static void test_offset_gap(void)
+{
+    long_write_t lw;
+    setup(&lw);
+
+    CHECK(prepare(&lw, HANDLE_TEXT, 1, 10) == LONG_WRITE_ERR_OFFSET);
+    long_write_cancel(&lw);
+
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 10) == LONG_WRITE_OK);
+    CHECK(prepare(&lw, HANDLE_TEXT, 10, 10) == LONG_WRITE_OK);
+    CHECK(prepare(&lw, HANDLE_TEXT, 21, 10) == LONG_WRITE_ERR_OFFSET);
+    // Filling the gap afterwards does not revive the payload
+    CHECK(prepare(&lw, HANDLE_TEXT, 20, 1) == LONG_WRITE_ERR_OFFSET);
+    CHECK(lw.stats.rejected_offset == 2);
+
+    uint16_t handle;
+    const uint8_t *data;
+    size_t len;
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_ERR_OFFSET);
+    CHECK(lw.stats.completed == 0);
+    CHECK(!atomic_load(&lw.locked));
+}
+
+// The module has no notion of clients: a second client sees the arena busy while the first
+// client's payload is locked by its consumer, or in progress for a plain write
+static void test_busy_second_client(void)
+{
+    long_write_t lw;
+    setup(&lw);
+
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 10) == LONG_WRITE_OK);
+    const uint8_t *stored;
+    CHECK(long_write_store(&lw, payload, 4, &stored) == LONG_WRITE_ERR_BUSY);
+
+    uint16_t handle;
+    const uint8_t *data;
+    size_t len;
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_OK);
+    // Not released yet: fragments and plain writes are turned away without touching the payload
+    CHECK(prepare(&lw, HANDLE_COMMAND, 0, 10) == LONG_WRITE_ERR_BUSY);
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 10) == LONG_WRITE_ERR_BUSY);
+    CHECK(long_write_store(&lw, payload + 20, 4, &stored) == LONG_WRITE_ERR_BUSY);
+    CHECK(memcmp(data, payload, 10) == 0 && data[10] == '\0');
+    CHECK(lw.stats.rejected_busy == 4);
+
+    long_write_release(&lw);
+    CHECK(prepare(&lw, HANDLE_COMMAND, 0, 10) == LONG_WRITE_OK);
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_OK);
+    CHECK(handle == HANDLE_COMMAND);
+    long_write_release(&lw);
+}
+
+static void test_exec_after_overflow(void)
+{
+    long_write_t lw;
+    setup(&lw);
+
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 40) == LONG_WRITE_OK);
+    CHECK(prepare(&lw, HANDLE_TEXT, 40, 40) == LONG_WRITE_ERR_OVERFLOW);
+
+    uint16_t handle;
+    const uint8_t *data = NULL;
+    size_t len = 0;
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_ERR_OVERFLOW);
+    CHECK(data == NULL);
+    CHECK(lw.stats.completed == 0);
+    CHECK(!atomic_load(&lw.locked));
+
+    // The error is reported once; the arena takes the next payload
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_ERR_EMPTY);
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, 8) == LONG_WRITE_OK);
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_OK);
+    CHECK(len == 8 && memcmp(data, payload, 8) == 0);
+    long_write_release(&lw);
+
+    // Cancel drops a voided payload without an error
+    CHECK(prepare(&lw, HANDLE_TEXT, 0, CAPACITY + 1) == LONG_WRITE_ERR_OVERFLOW);
+    long_write_cancel(&lw);
+    CHECK(long_write_finish(&lw, &handle, &data, &len) == LONG_WRITE_ERR_EMPTY);
+    CHECK(lw.stats.cancelled == 1);
+}
+
+int main(void)
+{
+    test_reassembly();
+    test_over_capacity();
+    test_offset_gap();
+    test_busy_second_client();
+    test_exec_after_overflow();
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("long_write_test passed\n");
+    return 0;
+}
@@ -0,0 +1,25 @@
+/*
+ * LVGL configuration for the host builds, mirroring the LVGL settings in
+ * sdkconfig.defaults so the scene renders the same as on the panel.
+ * Everything not set here keeps the LVGL v8 default.
+ */
+
+#ifndef LV_CONF_H
+#define LV_CONF_H
+
+#define LV_COLOR_DEPTH 16
+#define LV_COLOR_16_SWAP 1  // panel wire order, CONFIG_LV_COLOR_16_SWAP
+
+#define LV_MEM_CUSTOM 1  // plain malloc, the benchmark measures rendering, not the LVGL heap
+
+#define LV_USE_LOG 0
+
+#define LV_USE_SNAPSHOT 1  // rendered label cache, CONFIG_LV_USE_SNAPSHOT
+
+#define LV_FONT_MONTSERRAT_16 1
+#define LV_FONT_MONTSERRAT_20 1
+#define LV_FONT_MONTSERRAT_24 1
+#define LV_FONT_MONTSERRAT_28 1
+#define LV_FONT_DEFAULT &lv_font_montserrat_24
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * NOR flash simulator for host tests, see nor_flash_sim.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "nor_flash_sim.h"
+
+bool nor_flash_sim_init(nor_flash_sim_t *f, uint32_t size, uint32_t sector)
+{
+    memset(f, 0, sizeof(*f));
+    if (sector == 0 || size % sector != 0) {
+        return false;
+    }
+    f->mem = malloc(size);
+    f->erase_counts = calloc(size / sector, sizeof(uint32_t));
+    if (f->mem == NULL || f->erase_counts == NULL) {
+        nor_flash_sim_free(f);
+        return false;
+    }
+    memset(f->mem, 0xFF, size);
+    f->size = size;
+    f->sector = sector;
+    f->cut_at = NOR_FLASH_SIM_NO_CUT;
+    return true;
+}
+
+void nor_flash_sim_free(nor_flash_sim_t *f)
+{
+    free(f->mem);
+    free(f->erase_counts);
+    f->mem = NULL;
+    f->erase_counts = NULL;
+}
+
+void nor_flash_sim_power_on(nor_flash_sim_t *f)
+{
+    f->cut_at = NOR_FLASH_SIM_NO_CUT;
+}
+
+// Bytes of the current operation that take effect: all, half when power is cut now, none after
+static size_t sim_effective_len(nor_flash_sim_t *f, size_t len)
+{
+    uint32_t op = f->ops++;
+    if (f->cut_at == NOR_FLASH_SIM_NO_CUT || op < f->cut_at) {
+        return len;
+    }
+    return op == f->cut_at ? len / 2 : 0;
+}
+
+bool nor_flash_sim_write(uint32_t offset, const void *data, size_t len, void *ctx)
+{
+    nor_flash_sim_t *f = ctx;
+    if (offset > f->size || len > f->size - offset) {
+        return false;
+    }
+    size_t effective = sim_effective_len(f, len);
+    const uint8_t *src = data;
+    for (size_t i = 0; i < effective; i++) {
+        uint8_t old = f->mem[offset + i];
+        if ((old & src[i]) != src[i]) {
+            f->violations++;
+        }
+        f->mem[offset + i] = old & src[i];
+    }
+    return effective == len;
+}
+
+bool nor_flash_sim_erase(uint32_t offset, size_t len, void *ctx)
+{
+    nor_flash_sim_t *f = ctx;
+    if (offset % f->sector != 0 || len % f->sector != 0 || offset > f->size || len > f->size - offset) {
+        f->misaligned++;
+        return false;
+    }
+    // An interrupted erase completes whole sectors only
+    size_t effective = sim_effective_len(f, len) / f->sector * f->sector;
+    memset(&f->mem[offset], 0xFF, effective);
+    for (size_t s = 0; s < effective / f->sector; s++) {
+        f->erase_counts[offset / f->sector + s]++;
+    }
+    return effective == len;
+}
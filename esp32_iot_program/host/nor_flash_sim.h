@@ -0,0 +1,44 @@
+/*
+ * NOR flash simulator for host tests
+ * A RAM image with the rules of the SPI flash behind a data partition:
+ * erase works on whole sectors and sets every bit, programming can only
+ * clear bits (the stored value becomes old & new). Programming a 0 bit
+ * back to 1 is counted as a violation, since on the chip it silently
+ * leaves the old bit in place.
+ *
+ * A power cut can be scheduled after a number of operations: the cut
+ * operation takes effect only on the first half of its range (whole
+ * sectors of it for an erase) and fails, and every later operation fails
+ * without touching the image.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NOR_FLASH_SIM_NO_CUT UINT32_MAX
+
+typedef struct {
+    uint8_t *mem;
+    uint32_t size;
+    uint32_t sector;
+    uint32_t *erase_counts;  // per sector
+    uint32_t ops;            // erase and write calls so far
+    uint32_t cut_at;         // the operation that loses power, NOR_FLASH_SIM_NO_CUT for none
+    uint32_t violations;     // writes that tried to set a cleared bit
+    uint32_t misaligned;     // erases not on sector boundaries, rejected
+} nor_flash_sim_t;
+
+// Allocates an erased image of size bytes; size is a multiple of sector
+bool nor_flash_sim_init(nor_flash_sim_t *f, uint32_t size, uint32_t sector);
+
+void nor_flash_sim_free(nor_flash_sim_t *f);
+
+// Power comes back: operations work again, the image keeps whatever the cut left
+void nor_flash_sim_power_on(nor_flash_sim_t *f);
+
+// Signatures match asset_store_io_t; ctx is the nor_flash_sim_t
+bool nor_flash_sim_write(uint32_t offset, const void *data, size_t len, void *ctx);
+bool nor_flash_sim_erase(uint32_t offset, size_t len, void *ctx);
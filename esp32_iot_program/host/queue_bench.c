@@ -0,0 +1,147 @@
+/*
+ * Host benchmark for the display command queue
+ * Reports the cost of a reserve/commit/peek/pop cycle on one thread, the
+ * producer-to-consumer handoff latency between two spinning threads
+ * (p50/p99/max), and the sustained cross-thread rate with the ring kept
+ * full. The firmware adds a task notification on top of the handoff; this
+ * measures the queue itself.
+ */
+
+#define _POSIX_C_SOURCE 199309L  // clock_gettime, sched_yield
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "display_cmd_queue.h"
+
+#define CYCLES          10000000u
+#define LATENCY_SAMPLES 200000u
+#define BURST_COMMANDS  10000000u
+
+static display_cmd_queue_t queue;
+static int64_t sent_ns[LATENCY_SAMPLES];
+static int64_t latency_ns[LATENCY_SAMPLES];
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_single_thread(void)
+{
+    display_cmd_queue_init(&queue);
+    uint32_t sum = 0;
+    int64_t start = now_ns();
+    for (uint32_t i = 0; i < CYCLES; i++) {
+        display_cmd_t *cmd = display_cmd_queue_reserve(&queue);
+        cmd->type = DISPLAY_CMD_SET_BG_RGB888;
+        cmd->rgb888 = i;
+        display_cmd_queue_commit(&queue);
+        sum += display_cmd_queue_peek(&queue)->rgb888;
+        display_cmd_queue_pop(&queue);
+    }
+    int64_t elapsed = now_ns() - start;
+    printf("%-24s %8.1f ns per command (checksum %08x)\n", "single thread cycle", (double)elapsed / CYCLES,
+           (unsigned int)sum);
+}
+
+static void *latency_consumer(void *arg)
+{
+    (void)arg;
+    for (uint32_t seq = 0; seq < LATENCY_SAMPLES;) {
+        const display_cmd_t *cmd = display_cmd_queue_peek(&queue);
+        if (cmd == NULL) {
+            sched_yield();  // no-op with a core to spare, keeps single-core hosts moving
+            continue;
+        }
+        latency_ns[cmd->rgb888] = now_ns() - sent_ns[cmd->rgb888];
+        display_cmd_queue_pop(&queue);
+        seq++;
+    }
+    return NULL;
+}
+
+// One command in flight at a time: the time from commit until the consumer sees it
+static void bench_handoff_latency(void)
+{
+    display_cmd_queue_init(&queue);
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, latency_consumer, NULL);
+    for (uint32_t seq = 0; seq < LATENCY_SAMPLES; seq++) {
+        while (display_cmd_queue_count(&queue) != 0) {
+            sched_yield();
+        }
+        display_cmd_t *cmd = display_cmd_queue_reserve(&queue);
+        cmd->type = DISPLAY_CMD_SET_BG_RGB888;
+        cmd->rgb888 = seq;
+        sent_ns[seq] = now_ns();
+        display_cmd_queue_commit(&queue);
+    }
+    pthread_join(consumer, NULL);
+
+    qsort(latency_ns, LATENCY_SAMPLES, sizeof(latency_ns[0]), compare_i64);
+    printf("%-24s p50 %6lld ns, p99 %6lld ns, max %8lld ns\n", "handoff latency",
+           (long long)latency_ns[LATENCY_SAMPLES / 2], (long long)latency_ns[LATENCY_SAMPLES * 99 / 100],
+           (long long)latency_ns[LATENCY_SAMPLES - 1]);
+}
+
+static void *burst_consumer(void *arg)
+{
+    (void)arg;
+    for (uint32_t seq = 0; seq < BURST_COMMANDS;) {
+        if (display_cmd_queue_peek(&queue) != NULL) {
+            display_cmd_queue_pop(&queue);
+            seq++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Producer pushing as fast as the ring takes commands
+static void bench_burst(void)
+{
+    display_cmd_queue_init(&queue);
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, burst_consumer, NULL);
+    int64_t start = now_ns();
+    for (uint32_t seq = 0; seq < BURST_COMMANDS;) {
+        display_cmd_t *cmd = display_cmd_queue_reserve(&queue);
+        if (cmd == NULL) {
+            sched_yield();
+            continue;
+        }
+        cmd->type = DISPLAY_CMD_SET_BG_RGB888;
+        cmd->rgb888 = seq++;
+        display_cmd_queue_commit(&queue);
+    }
+    pthread_join(consumer, NULL);
+    int64_t elapsed = now_ns() - start;
+
+    display_cmd_queue_stats_t stats;
+    display_cmd_queue_get_stats(&queue, &stats);
+    printf("%-24s %8.2f M commands/s, %u full rejections, high water %u\n", "cross-thread burst",
+           BURST_COMMANDS / (elapsed / 1e9) / 1e6, (unsigned int)stats.dropped, (unsigned int)stats.high_water);
+}
+
+int main(void)
+{
+    printf("display_cmd_t is %zu bytes, ring of %d\n", sizeof(display_cmd_t), DISPLAY_CMD_QUEUE_LEN);
+    bench_single_thread();
+    bench_handoff_latency();
+    bench_burst();
+    return 0;
+}
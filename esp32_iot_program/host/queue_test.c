@@ -0,0 +1,204 @@
+/*
+ * Host unit test for the display command queue
+ * Covers FIFO order across the ring and 32-bit index wraparound, the
+ * full/overflow counters, and a two-thread SPSC stress run in which the
+ * consumer checks that every accepted command arrives once, in order, with
+ * the contents the producer wrote.
+ */
+
+#define _POSIX_C_SOURCE 199309L  // sched_yield
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include "display_cmd_queue.h"
+
+#define STRESS_COMMANDS 1000000u
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static display_cmd_t make_cmd(uint32_t seq)
+{
+    display_cmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.type = DISPLAY_CMD_SET_BG_RGB888;
+    cmd.rgb888 = seq;
+    cmd.rx_us = ~seq;  // a second field, so torn slots show up
+    return cmd;
+}
+
+static bool pop_expect(display_cmd_queue_t *q, uint32_t seq)
+{
+    const display_cmd_t *cmd = display_cmd_queue_peek(q);
+    if (cmd == NULL || cmd->rgb888 != seq || cmd->rx_us != ~seq) {
+        return false;
+    }
+    display_cmd_queue_pop(q);
+    return true;
+}
+
+static void test_fifo_wraparound(void)
+{
+    static display_cmd_queue_t q;
+    display_cmd_queue_init(&q);
+
+    // Fill levels that do not divide the ring length walk the slots across the array boundary
+    uint32_t next_push = 0;
+    uint32_t next_pop = 0;
+    for (int round = 0; round < 100; round++) {
+        int burst = 1 + round % (DISPLAY_CMD_QUEUE_LEN - 1);
+        for (int i = 0; i < burst; i++) {
+            display_cmd_t cmd = make_cmd(next_push++);
+            CHECK(display_cmd_queue_push(&q, &cmd));
+        }
+        CHECK(display_cmd_queue_count(&q) == (uint32_t)burst);
+        for (int i = 0; i < burst; i++) {
+            CHECK(pop_expect(&q, next_pop++));
+        }
+        CHECK(display_cmd_queue_peek(&q) == NULL);
+    }
+
+    // Indices overflowing 32 bits: count and full detection use unsigned differences
+    display_cmd_queue_init(&q);
+    atomic_store(&q.head, UINT32_MAX - 3);
+    atomic_store(&q.tail, UINT32_MAX - 3);
+    for (uint32_t i = 0; i < DISPLAY_CMD_QUEUE_LEN; i++) {
+        display_cmd_t cmd = make_cmd(i);
+        CHECK(display_cmd_queue_push(&q, &cmd));
+    }
+    CHECK(atomic_load(&q.head) < DISPLAY_CMD_QUEUE_LEN);
+    CHECK(display_cmd_queue_count(&q) == DISPLAY_CMD_QUEUE_LEN);
+    CHECK(display_cmd_queue_reserve(&q) == NULL);
+    for (uint32_t i = 0; i < DISPLAY_CMD_QUEUE_LEN; i++) {
+        CHECK(pop_expect(&q, i));
+    }
+    CHECK(display_cmd_queue_count(&q) == 0);
+}
+
+static void test_overflow_counters(void)
+{
+    static display_cmd_queue_t q;
+    display_cmd_queue_init(&q);
+
+    for (uint32_t i = 0; i < DISPLAY_CMD_QUEUE_LEN; i++) {
+        display_cmd_t cmd = make_cmd(i);
+        CHECK(display_cmd_queue_push(&q, &cmd));
+    }
+    // Full: the newest command is rejected, queued ones are untouched
+    for (uint32_t i = 0; i < 3; i++) {
+        display_cmd_t cmd = make_cmd(1000 + i);
+        CHECK(!display_cmd_queue_push(&q, &cmd));
+    }
+    CHECK(display_cmd_queue_reserve(&q) == NULL);
+
+    display_cmd_queue_stats_t stats;
+    display_cmd_queue_get_stats(&q, &stats);
+    CHECK(stats.enqueued == DISPLAY_CMD_QUEUE_LEN);
+    CHECK(stats.dropped == 4);
+    CHECK(stats.dequeued == 0);
+    CHECK(stats.high_water == DISPLAY_CMD_QUEUE_LEN);
+
+    // One slot freed: exactly one more fits
+    CHECK(pop_expect(&q, 0));
+    display_cmd_t cmd = make_cmd(DISPLAY_CMD_QUEUE_LEN);
+    CHECK(display_cmd_queue_push(&q, &cmd));
+    CHECK(!display_cmd_queue_push(&q, &cmd));
+    for (uint32_t i = 1; i <= DISPLAY_CMD_QUEUE_LEN; i++) {
+        CHECK(pop_expect(&q, i));
+    }
+
+    display_cmd_queue_get_stats(&q, &stats);
+    CHECK(stats.enqueued == DISPLAY_CMD_QUEUE_LEN + 1);
+    CHECK(stats.dropped == 5);
+    CHECK(stats.dequeued == DISPLAY_CMD_QUEUE_LEN + 1);
+    CHECK(stats.high_water == DISPLAY_CMD_QUEUE_LEN);
+}
+
+typedef struct {
+    display_cmd_queue_t q;
+    uint32_t rejected;  // producer: reserve calls that found the ring full
+    uint32_t errors;    // consumer: commands out of order or torn
+} stress_t;
+
+static void *stress_producer(void *arg)
+{
+    stress_t *s = arg;
+    for (uint32_t seq = 0; seq < STRESS_COMMANDS;) {
+        // Reserve and fill in place, the way the BLE callbacks publish commands
+        display_cmd_t *cmd = display_cmd_queue_reserve(&s->q);
+        if (cmd == NULL) {
+            s->rejected++;
+            sched_yield();  // let the consumer run on a single core
+            continue;
+        }
+        *cmd = make_cmd(seq);
+        display_cmd_queue_commit(&s->q);
+        seq++;
+    }
+    return NULL;
+}
+
+static void *stress_consumer(void *arg)
+{
+    stress_t *s = arg;
+    for (uint32_t seq = 0; seq < STRESS_COMMANDS;) {
+        const display_cmd_t *cmd = display_cmd_queue_peek(&s->q);
+        if (cmd == NULL) {
+            sched_yield();
+            continue;
+        }
+        if (cmd->rgb888 != seq || cmd->rx_us != ~seq) {
+            s->errors++;
+        }
+        display_cmd_queue_pop(&s->q);
+        seq++;
+    }
+    return NULL;
+}
+
+static void test_spsc_stress(void)
+{
+    static stress_t s;
+    memset(&s, 0, sizeof(s));
+    display_cmd_queue_init(&s.q);
+
+    pthread_t producer;
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, stress_consumer, &s);
+    pthread_create(&producer, NULL, stress_producer, &s);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    display_cmd_queue_stats_t stats;
+    display_cmd_queue_get_stats(&s.q, &stats);
+    CHECK(s.errors == 0);
+    CHECK(stats.enqueued == STRESS_COMMANDS);
+    CHECK(stats.dequeued == STRESS_COMMANDS);
+    CHECK(stats.dropped == s.rejected);
+    CHECK(stats.high_water <= DISPLAY_CMD_QUEUE_LEN);
+    CHECK(display_cmd_queue_count(&s.q) == 0);
+    printf("stress: %u commands, %u rejected while full, high water %u\n", STRESS_COMMANDS,
+           (unsigned int)s.rejected, (unsigned int)stats.high_water);
+}
+
+int main(void)
+{
+    test_fifo_wraparound();
+    test_overflow_counters();
+    test_spsc_stress();
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("queue_test passed\n");
+    return 0;
+}
@@ -0,0 +1,490 @@
+/*
+ * Host benchmark for the display scene
+ * Replays recorded BLE write streams through the firmware's protocol
+ * decoding and LVGL scene, rendered into an in-memory framebuffer in place
+ * of the panel, and reports per command type the render time, the pixels
+ * touched and the bytes that would go over SPI.
+ *
+ * A stream file is a sequence of records, one per characteristic write:
+ *   uint16 characteristic UUID (LE), uint16 length (LE), payload
+ * for the color (0xFF01), text (0xFF02), command (0xFF03) and stream
+ * (0xFF04) characteristics; other records are skipped. Without arguments a
+ * built-in corpus of synthetic streams is used; --write-corpus <dir> saves
+ * it as stream files.
+ *
+ * Each command is applied and rendered on its own (lv_refr_now), so the
+ * numbers are per command rather than per coalesced frame. --direct renders
+ * like CONFIG_DISPLAY_RENDER_DIRECT: one full-screen buffer of which only
+ * the invalidated areas are flushed, instead of two striped buffers.
+ *
+ * Commands that showed text are also reported as label cache hits (warm:
+ * a stored rendering is blitted) or misses (cold: the label is laid out,
+ * rasterized and snapshotted into the cache). --no-label-cache disables
+ * the cache for a baseline.
+ */
+
+#define _POSIX_C_SOURCE 199309L  // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lvgl.h"
+#include "display_protocol.h"
+#include "display_scene.h"
+
+#define PANEL_W 320
+#define PANEL_H 172
+#define DRAW_BUF_LINES 43  // CONFIG_DISPLAY_DRAW_BUF_LINES default
+
+#define UUID_COLOR   0xFF01
+#define UUID_TEXT    0xFF02
+#define UUID_COMMAND 0xFF03
+#define UUID_STREAM  0xFF04
+
+#define CMD_TYPES (DISPLAY_CMD_SET_TEXT_REF + 1)
+#define ROW_LABEL_HIT  CMD_TYPES
+#define ROW_LABEL_MISS (CMD_TYPES + 1)
+#define ROWS           (CMD_TYPES + 2)
+#define LABEL_CACHE_BUDGET (96 * 1024)  // CONFIG_DISPLAY_LABEL_CACHE_KB default
+#define CORPUS_MAX 16384
+
+typedef struct {
+    uint32_t count;
+    int64_t total_ns;
+    int64_t max_ns;
+    uint64_t pixels;       // pixels written by fills and flushes
+    uint64_t flush_bytes;  // bytes sent to the panel by LVGL flushes and direct fills
+} type_stats_t;
+
+typedef struct {
+    const char *name;
+    uint8_t data[CORPUS_MAX];
+    size_t len;
+} stream_t;
+
+// Framebuffer driver: the panel, in wire order
+static uint16_t framebuffer[PANEL_W * PANEL_H];
+static uint64_t pixels_touched = 0;
+static uint64_t bytes_flushed = 0;
+static char text_ref[512 + 1];  // stands in for the long-write arena
+static bool direct_mode = false;
+static uint32_t label_cache_budget = LABEL_CACHE_BUDGET;
+
+static const char *type_names[ROWS] = {
+    "color565", "color888", "text", "status", "frame", "text_ref", "label hit", "label miss",
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void fb_copy_area(const lv_area_t *area, const lv_color_t *src, int src_stride)
+{
+    int w = area->x2 - area->x1 + 1;
+    for (int y = area->y1; y <= area->y2; y++) {
+        memcpy(&framebuffer[y * PANEL_W + area->x1], &src[y * src_stride + area->x1], (size_t)w * 2);
+    }
+    pixels_touched += (uint64_t)w * (area->y2 - area->y1 + 1);
+    bytes_flushed += (uint64_t)w * (area->y2 - area->y1 + 1) * 2;
+}
+
+// Direct mode: the draw buffer is the whole screen; the last flush sends the invalidated areas
+static void fb_flush_direct_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    if (lv_disp_flush_is_last(drv)) {
+        lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+        for (int i = 0; i < disp->inv_p; i++) {
+            if (!disp->inv_area_joined[i]) {
+                fb_copy_area(&disp->inv_areas[i], drv->draw_buf->buf1, PANEL_W);
+            }
+        }
+    }
+    lv_disp_flush_ready(drv);
+}
+
+static void fb_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    int w = area->x2 - area->x1 + 1;
+    for (int y = area->y1; y <= area->y2; y++) {
+        memcpy(&framebuffer[y * PANEL_W + area->x1], &color_map[(y - area->y1) * w], (size_t)w * 2);
+    }
+    pixels_touched += (uint64_t)w * (area->y2 - area->y1 + 1);
+    bytes_flushed += (uint64_t)w * (area->y2 - area->y1 + 1) * 2;
+    lv_disp_flush_ready(drv);
+}
+
+static void fb_fill_rect(int x, int y, int width, int height, lv_color_t color, void *ctx)
+{
+    for (int j = y; j < y + height; j++) {
+        for (int i = x; i < x + width; i++) {
+            framebuffer[j * PANEL_W + i] = color.full;
+        }
+    }
+    pixels_touched += (uint64_t)width * height;
+    bytes_flushed += (uint64_t)width * height * 2;
+}
+
+static void fb_fill_wait(void *ctx)
+{
+}
+
+// Backlight only, no pixels change
+static void fb_set_brightness(uint8_t level, void *ctx)
+{
+}
+
+static void display_init(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_disp_drv_t disp_drv;
+    static lv_color_t buf1[PANEL_W * DRAW_BUF_LINES];
+    static lv_color_t buf2[PANEL_W * DRAW_BUF_LINES];
+    static lv_color_t direct_buf[PANEL_W * PANEL_H];
+
+    lv_init();
+    lv_disp_drv_init(&disp_drv);
+    if (direct_mode) {
+        lv_disp_draw_buf_init(&draw_buf, direct_buf, NULL, PANEL_W * PANEL_H);
+        disp_drv.direct_mode = 1;
+        disp_drv.flush_cb = fb_flush_direct_cb;
+    } else {
+        lv_disp_draw_buf_init(&draw_buf, buf1, buf2, PANEL_W * DRAW_BUF_LINES);
+        disp_drv.flush_cb = fb_flush_cb;
+    }
+    disp_drv.hor_res = PANEL_W;
+    disp_drv.ver_res = PANEL_H;
+    disp_drv.draw_buf = &draw_buf;
+    lv_disp_drv_register(&disp_drv);
+
+    static const display_scene_hooks_t hooks = {
+        .fill_rect = fb_fill_rect,
+        .fill_wait = fb_fill_wait,
+        .set_brightness = fb_set_brightness,
+    };
+    display_scene_create(&hooks, label_cache_budget);
+    lv_refr_now(NULL);
+}
+
+// Decode one write the way gatts_dispatch_write does; false when it carries no display command
+static bool decode_write(uint16_t uuid, const uint8_t *value, uint16_t len, display_cmd_t *cmd)
+{
+    switch (uuid) {
+    case UUID_COLOR:
+        return display_protocol_color(value, len, cmd);
+    case UUID_TEXT:
+        if (display_protocol_text(value, len, cmd)) {
+            return true;
+        }
+        // Longer text goes through the long-write arena on the device
+        if (len >= sizeof(text_ref)) {
+            return false;
+        }
+        memcpy(text_ref, value, len);
+        text_ref[len] = '\0';
+        cmd->type = DISPLAY_CMD_SET_TEXT_REF;
+        cmd->flags = 0;
+        cmd->text_ref.str = text_ref;
+        cmd->text_ref.len = len;
+        return true;
+    case UUID_COMMAND:
+        return display_protocol_frame(value, len, 0, cmd) == CMD_FRAME_OK;
+    case UUID_STREAM:
+        return display_protocol_frame(value, len, DISPLAY_CMD_FLAG_STREAM, cmd) == CMD_FRAME_OK;
+    default:
+        return false;
+    }
+}
+
+static void account(type_stats_t *s, int64_t elapsed, uint64_t pixels, uint64_t bytes)
+{
+    s->count++;
+    s->total_ns += elapsed;
+    if (elapsed > s->max_ns) {
+        s->max_ns = elapsed;
+    }
+    s->pixels += pixels;
+    s->flush_bytes += bytes;
+}
+
+// Replay one stream; returns the number of records that were rejected
+static int replay(const stream_t *stream, type_stats_t *stats)
+{
+    static display_cmd_t cmd;
+    int rejected = 0;
+    size_t pos = 0;
+
+    while (pos + 4 <= stream->len) {
+        uint16_t uuid = (uint16_t)(stream->data[pos] | (stream->data[pos + 1] << 8));
+        uint16_t len = (uint16_t)(stream->data[pos + 2] | (stream->data[pos + 3] << 8));
+        if (pos + 4 + len > stream->len) {
+            fprintf(stderr, "%s: truncated record at offset %zu\n", stream->name, pos);
+            return rejected + 1;
+        }
+        const uint8_t *value = &stream->data[pos + 4];
+        pos += 4 + (size_t)len;
+
+        if (uuid < UUID_COLOR || uuid > UUID_STREAM) {
+            continue;
+        }
+        if (!decode_write(uuid, value, len, &cmd)) {
+            rejected++;
+            continue;
+        }
+
+        label_cache_stats_t cache_before;
+        display_scene_get_label_cache_stats(&cache_before);
+        uint64_t pixels_start = pixels_touched;
+        uint64_t bytes_start = bytes_flushed;
+        int64_t start = now_ns();
+        display_scene_apply(&cmd);
+        lv_refr_now(NULL);
+        int64_t elapsed = now_ns() - start;
+
+        uint64_t pixels = pixels_touched - pixels_start;
+        uint64_t bytes = bytes_flushed - bytes_start;
+        account(&stats[cmd.type], elapsed, pixels, bytes);
+
+        label_cache_stats_t cache_after;
+        display_scene_get_label_cache_stats(&cache_after);
+        if (cache_after.hits != cache_before.hits) {
+            account(&stats[ROW_LABEL_HIT], elapsed, pixels, bytes);
+        } else if (cache_after.misses != cache_before.misses) {
+            account(&stats[ROW_LABEL_MISS], elapsed, pixels, bytes);
+        }
+    }
+    return rejected;
+}
+
+static void print_stats(const char *name, const type_stats_t *stats)
+{
+    for (int t = 0; t < ROWS; t++) {
+        const type_stats_t *s = &stats[t];
+        if (s->count == 0) {
+            continue;
+        }
+        printf("%-14s %-10s %6u %10.1f %10.1f %12.0f %12.0f\n", name, type_names[t], (unsigned)s->count,
+               s->total_ns / 1000.0 / s->count, s->max_ns / 1000.0,
+               (double)s->pixels / s->count, (double)s->flush_bytes / s->count);
+    }
+}
+
+static void put_record(stream_t *stream, uint16_t uuid, const void *value, uint16_t len)
+{
+    if (stream->len + 4 + len > CORPUS_MAX) {
+        return;
+    }
+    uint8_t *p = &stream->data[stream->len];
+    p[0] = uuid & 0xFF;
+    p[1] = uuid >> 8;
+    p[2] = len & 0xFF;
+    p[3] = len >> 8;
+    memcpy(p + 4, value, len);
+    stream->len += 4 + (size_t)len;
+}
+
+// Command frame builder, see cmd_frame.h
+static size_t frame_op(uint8_t *frame, size_t pos, uint8_t type, const void *value, uint8_t len)
+{
+    frame[pos] = type;
+    frame[pos + 1] = len;
+    memcpy(&frame[pos + 2], value, len);
+    return pos + 2 + len;
+}
+
+static size_t frame_commit(uint8_t *frame, size_t pos)
+{
+    frame[pos] = CMD_OP_COMMIT;
+    frame[pos + 1] = 0;
+    return pos + 2;
+}
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// The app's color picker: RGB565 and hex writes
+static void make_color_cycle(stream_t *stream)
+{
+    stream->name = "color_cycle";
+    for (int i = 0; i < 48; i++) {
+        uint32_t rgb = rng() & 0xFFFFFF;
+        if (i & 1) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "#%06X", (unsigned)rgb);
+            put_record(stream, UUID_COLOR, hex, 7);
+        } else {
+            uint8_t rgb565[2] = {(uint8_t)(rgb >> 16), (uint8_t)rgb};
+            put_record(stream, UUID_COLOR, rgb565, 2);
+        }
+    }
+}
+
+// Typing into the text field: growing text, then a long paste
+static void make_text_updates(stream_t *stream)
+{
+    static const char sentence[] =
+        "The quick brown fox jumps over the lazy dog while the display keeps up with every keystroke";
+    stream->name = "text_updates";
+    for (uint16_t len = 1; len < sizeof(sentence) - 1; len += 3) {
+        put_record(stream, UUID_TEXT, sentence, len);
+    }
+    char paste[300];
+    for (size_t i = 0; i < sizeof(paste); i++) {
+        paste[i] = sentence[i % (sizeof(sentence) - 1)];
+    }
+    put_record(stream, UUID_TEXT, paste, sizeof(paste));
+}
+
+// A deployment cycling through a few status strings, the case the label cache is for
+static void make_status_cycle(stream_t *stream)
+{
+    static const char *const statuses[] = {"Ready", "Printing...", "Paper low", "Door open"};
+    stream->name = "status_cycle";
+    for (int i = 0; i < 48; i++) {
+        const char *text = statuses[i % 4];
+        put_record(stream, UUID_TEXT, text, (uint16_t)strlen(text));
+    }
+}
+
+// Full command frames: background, text, text color and font together
+static void make_frames(stream_t *stream)
+{
+    static const uint8_t fonts[] = {16, 20, 24, 28};
+    stream->name = "frames";
+    for (int i = 0; i < 32; i++) {
+        uint8_t frame[CMD_FRAME_TEXT_MAX + 32];
+        char text[32];
+        uint32_t bg = rng();
+        uint32_t fg = ~bg;
+        uint8_t bg_rgb[3] = {(uint8_t)(bg >> 16), (uint8_t)(bg >> 8), (uint8_t)bg};
+        uint8_t fg_rgb[3] = {(uint8_t)(fg >> 16), (uint8_t)(fg >> 8), (uint8_t)fg};
+        int text_len = snprintf(text, sizeof(text), "Frame %d", i);
+        size_t pos = 0;
+        pos = frame_op(frame, pos, CMD_OP_SET_BG, bg_rgb, 3);
+        pos = frame_op(frame, pos, CMD_OP_SET_TEXT, text, (uint8_t)text_len);
+        pos = frame_op(frame, pos, CMD_OP_SET_TEXT_COLOR, fg_rgb, 3);
+        pos = frame_op(frame, pos, CMD_OP_SET_FONT, &fonts[i % 4], 1);
+        pos = frame_commit(frame, pos);
+        put_record(stream, UUID_COMMAND, frame, (uint16_t)pos);
+    }
+}
+
+// Brightness slider on the stream characteristic: no pixels should change
+static void make_brightness(stream_t *stream)
+{
+    stream->name = "brightness";
+    for (int i = 0; i < 64; i++) {
+        uint8_t frame[8];
+        uint8_t level = (uint8_t)(i * 4);
+        size_t pos = frame_op(frame, 0, CMD_OP_SET_BRIGHTNESS, &level, 1);
+        pos = frame_commit(frame, pos);
+        put_record(stream, UUID_STREAM, frame, (uint16_t)pos);
+    }
+}
+
+static int load_stream(const char *path, stream_t *stream)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    stream->name = path;
+    stream->len = fread(stream->data, 1, sizeof(stream->data), f);
+    int truncated = !feof(f) && fgetc(f) != EOF;
+    fclose(f);
+    return truncated ? -1 : 0;
+}
+
+static int write_corpus(const char *dir, stream_t *streams, int count)
+{
+    for (int i = 0; i < count; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.bin", dir, streams[i].name);
+        FILE *f = fopen(path, "wb");
+        if (f == NULL || fwrite(streams[i].data, 1, streams[i].len, f) != streams[i].len) {
+            fprintf(stderr, "Cannot write %s\n", path);
+            if (f != NULL) {
+                fclose(f);
+            }
+            return 1;
+        }
+        fclose(f);
+        printf("%s: %zu bytes\n", path, streams[i].len);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static stream_t streams[16];
+    int stream_count = 0;
+    int failures = 0;
+    int first_arg = 1;
+
+    for (; first_arg < argc; first_arg++) {
+        if (strcmp(argv[first_arg], "--direct") == 0) {
+            direct_mode = true;
+        } else if (strcmp(argv[first_arg], "--no-label-cache") == 0) {
+            label_cache_budget = 0;
+        } else {
+            break;
+        }
+    }
+
+    if (argc > first_arg && strcmp(argv[first_arg], "--write-corpus") != 0) {
+        for (int i = first_arg; i < argc && stream_count < 16; i++) {
+            if (load_stream(argv[i], &streams[stream_count]) == 0) {
+                stream_count++;
+            } else {
+                fprintf(stderr, "Skipping %s: unreadable or larger than %d bytes\n", argv[i], CORPUS_MAX);
+                failures++;
+            }
+        }
+    } else {
+        make_color_cycle(&streams[stream_count++]);
+        make_text_updates(&streams[stream_count++]);
+        make_status_cycle(&streams[stream_count++]);
+        make_frames(&streams[stream_count++]);
+        make_brightness(&streams[stream_count++]);
+        if (argc > first_arg) {
+            return write_corpus(argc > first_arg + 1 ? argv[first_arg + 1] : ".", streams, stream_count);
+        }
+    }
+
+    display_init();
+    printf("render mode: %s, label cache %u KB\n",
+           direct_mode ? "direct (full-screen buffer)" : "partial (2 x 43-line buffers)",
+           (unsigned)(label_cache_budget / 1024));
+
+    type_stats_t total[ROWS] = {0};
+    printf("%-14s %-10s %6s %10s %10s %12s %12s\n", "stream", "command", "count", "mean us", "max us",
+           "pixels/cmd", "bytes/cmd");
+    for (int i = 0; i < stream_count; i++) {
+        type_stats_t stats[ROWS] = {0};
+        int rejected = replay(&streams[i], stats);
+        if (rejected > 0) {
+            fprintf(stderr, "%s: %d records rejected\n", streams[i].name, rejected);
+            failures++;
+        }
+        print_stats(streams[i].name, stats);
+        for (int t = 0; t < ROWS; t++) {
+            total[t].count += stats[t].count;
+            total[t].total_ns += stats[t].total_ns;
+            total[t].max_ns = stats[t].max_ns > total[t].max_ns ? stats[t].max_ns : total[t].max_ns;
+            total[t].pixels += stats[t].pixels;
+            total[t].flush_bytes += stats[t].flush_bytes;
+        }
+    }
+    print_stats("total", total);
+    return failures ? 1 : 0;
+}
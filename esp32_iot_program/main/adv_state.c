@@ -0,0 +1,34 @@
+/*
+ * Display state in the advertisement, see adv_state.h
+ */
+
+#include "adv_state.h"
+
+uint32_t adv_state_hash(const uint8_t *data, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+size_t adv_state_encode(const display_state_t *s, uint8_t firmware_version, uint8_t out[ADV_STATE_LEN])
+{
+    uint8_t frame[CMD_FRAME_ENCODED_MAX];
+    size_t frame_len = display_state_encode(s, frame, sizeof(frame));
+    uint32_t hash = adv_state_hash(frame, frame_len);
+
+    out[0] = ADV_STATE_COMPANY_ID & 0xFF;
+    out[1] = ADV_STATE_COMPANY_ID >> 8;
+    out[2] = ADV_STATE_VERSION;
+    out[3] = firmware_version;
+    out[4] = (s->frame.bg_rgb888 >> 16) & 0xFF;
+    out[5] = (s->frame.bg_rgb888 >> 8) & 0xFF;
+    out[6] = s->frame.bg_rgb888 & 0xFF;
+    for (int i = 0; i < 4; i++) {
+        out[7 + i] = (hash >> (8 * i)) & 0xFF;
+    }
+    return ADV_STATE_LEN;
+}
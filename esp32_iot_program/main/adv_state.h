@@ -0,0 +1,40 @@
+/*
+ * Display state in the advertisement
+ * A manufacturer-specific data field that lets a scanning app see what the
+ * screen shows without connecting, little-endian:
+ *
+ *   uint16 company id, uint8 layout version, uint8 firmware version,
+ *   uint8 R, G, B of the background, uint32 state hash
+ *
+ * The state hash is the 32-bit FNV-1a of the encoded state frame
+ * (display_state_encode): every field, in operation order, ending with
+ * COMMIT. An app that builds the same frame for the state it wants to show
+ * knows from the hash alone whether the device needs an update.
+ *
+ * Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "display_state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bluetooth SIG id reserved for testing; replace with an assigned company id in a product
+#define ADV_STATE_COMPANY_ID  0xFFFF
+#define ADV_STATE_VERSION     1
+#define ADV_STATE_LEN         11
+
+// 32-bit FNV-1a of data
+uint32_t adv_state_hash(const uint8_t *data, size_t len);
+
+// Manufacturer data for the state s, ADV_STATE_LEN bytes including the company id; returns the length
+size_t adv_state_encode(const display_state_t *s, uint8_t firmware_version, uint8_t out[ADV_STATE_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
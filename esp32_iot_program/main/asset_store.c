@@ -0,0 +1,225 @@
+/*
+ * Asset store, see asset_store.h
+ */
+
+#include <string.h>
+#include "asset_store.h"
+
+#define RECORD_MAGIC  0x32545341u  // "AST2"
+
+// Header state word; each step only clears bits
+#define STATE_PENDING  0xFFFFFFFFu
+#define STATE_VALID    0x0000FFFFu
+
+#define HEADER_KEY_OFFSET   4
+#define HEADER_TYPE_OFFSET  12
+#define HEADER_SIZE_OFFSET  16
+#define HEADER_STATE_OFFSET 20
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_le32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+// Bytes a record of size data bytes takes in the partition
+static uint32_t record_span(uint32_t size)
+{
+    return (ASSET_STORE_HEADER_SIZE + size + ASSET_STORE_SECTOR - 1) & ~(uint32_t)(ASSET_STORE_SECTOR - 1);
+}
+
+static const asset_store_entry_t *entry_by_key(const asset_store_t *s, const uint8_t key[ASSET_KEY_LEN])
+{
+    for (uint32_t i = 0; i < s->count; i++) {
+        if (memcmp(s->entries[i].key, key, ASSET_KEY_LEN) == 0) {
+            return &s->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static bool write_state(asset_store_t *s, uint32_t record_offset, uint32_t state)
+{
+    uint8_t value[4];
+    write_le32(value, state);
+    return s->io.write(record_offset + HEADER_STATE_OFFSET, value, sizeof(value), s->io.ctx);
+}
+
+static asset_store_status_t upload_fail(asset_store_t *s, asset_store_status_t status)
+{
+    s->open = false;
+    s->failures++;
+    return status;
+}
+
+void asset_store_init(asset_store_t *s, const uint8_t *base, uint32_t capacity, const asset_store_io_t *io)
+{
+    memset(s, 0, sizeof(*s));
+    s->base = base;
+    s->capacity = capacity & ~(uint32_t)(ASSET_STORE_SECTOR - 1);
+    s->io = *io;
+
+    uint32_t offset = 0;
+    while (s->capacity - offset >= ASSET_STORE_SECTOR) {
+        const uint8_t *header = base + offset;
+        uint32_t size = read_le32(header + HEADER_SIZE_OFFSET);
+        uint32_t state = read_le32(header + HEADER_STATE_OFFSET);
+        if (read_le32(header) != RECORD_MAGIC || state == STATE_PENDING ||
+            size > s->capacity - offset - ASSET_STORE_HEADER_SIZE) {
+            break;
+        }
+        if (state == STATE_VALID && s->count < ASSET_STORE_MAX_ASSETS) {
+            asset_store_entry_t *entry = &s->entries[s->count++];
+            memcpy(entry->key, header + HEADER_KEY_OFFSET, ASSET_KEY_LEN);
+            entry->type = header[HEADER_TYPE_OFFSET];
+            entry->offset = offset;
+            entry->size = size;
+        }
+        offset += record_span(size);
+    }
+    s->end = offset;
+}
+
+asset_store_status_t asset_store_begin(asset_store_t *s, const uint8_t key[ASSET_KEY_LEN], uint8_t type,
+                                       uint32_t size)
+{
+    s->open = false;
+    if (entry_by_key(s, key) != NULL) {
+        return ASSET_STORE_ERR_DUPLICATE;
+    }
+    if (s->count >= ASSET_STORE_MAX_ASSETS) {
+        return upload_fail(s, ASSET_STORE_ERR_FULL);
+    }
+    if (size > s->capacity - s->end || record_span(size) > s->capacity - s->end) {
+        return upload_fail(s, ASSET_STORE_ERR_FULL);
+    }
+
+    uint32_t span = record_span(size);
+    if (!s->io.erase(s->end, span, s->io.ctx)) {
+        return upload_fail(s, ASSET_STORE_ERR_IO);
+    }
+    uint8_t header[ASSET_STORE_HEADER_SIZE];
+    memset(header, 0xFF, sizeof(header));
+    write_le32(header, RECORD_MAGIC);
+    memcpy(header + HEADER_KEY_OFFSET, key, ASSET_KEY_LEN);
+    header[HEADER_TYPE_OFFSET] = type;
+    write_le32(header + HEADER_SIZE_OFFSET, size);
+    if (!s->io.write(s->end, header, sizeof(header), s->io.ctx)) {
+        return upload_fail(s, ASSET_STORE_ERR_IO);
+    }
+
+    s->open = true;
+    memcpy(s->upload.key, key, ASSET_KEY_LEN);
+    s->upload.type = type;
+    s->upload.offset = s->end;
+    s->upload.size = size;
+    s->received = 0;
+    return ASSET_STORE_OK;
+}
+
+asset_store_status_t asset_store_write(asset_store_t *s, uint32_t offset, const uint8_t *data, size_t len)
+{
+    if (!s->open) {
+        return ASSET_STORE_ERR_NOT_OPEN;
+    }
+    if (offset != s->received) {
+        return upload_fail(s, ASSET_STORE_ERR_OFFSET);
+    }
+    if (len > s->upload.size - s->received) {
+        return upload_fail(s, ASSET_STORE_ERR_TOO_LONG);
+    }
+    uint32_t at = s->upload.offset + ASSET_STORE_HEADER_SIZE + s->received;
+    if (len > 0 && !s->io.write(at, data, len, s->io.ctx)) {
+        return upload_fail(s, ASSET_STORE_ERR_IO);
+    }
+    s->received += len;
+    return ASSET_STORE_OK;
+}
+
+asset_store_status_t asset_store_finish(asset_store_t *s)
+{
+    if (!s->open) {
+        return ASSET_STORE_ERR_NOT_OPEN;
+    }
+    if (s->received != s->upload.size) {
+        return upload_fail(s, ASSET_STORE_ERR_INCOMPLETE);
+    }
+    // Verify what actually landed in flash, not what was sent
+    const uint8_t *data = s->base + s->upload.offset + ASSET_STORE_HEADER_SIZE;
+    uint8_t key[ASSET_KEY_LEN];
+    s->io.hash(data, s->upload.size, key, s->io.ctx);
+    if (memcmp(key, s->upload.key, ASSET_KEY_LEN) != 0) {
+        return upload_fail(s, ASSET_STORE_ERR_HASH);
+    }
+    if (!write_state(s, s->upload.offset, STATE_VALID)) {
+        return upload_fail(s, ASSET_STORE_ERR_IO);
+    }
+
+    s->entries[s->count++] = s->upload;
+    s->end += record_span(s->upload.size);
+    s->open = false;
+    s->uploads++;
+    return ASSET_STORE_OK;
+}
+
+void asset_store_abort(asset_store_t *s)
+{
+    s->open = false;
+}
+
+asset_store_status_t asset_store_erase_all(asset_store_t *s)
+{
+    s->open = false;
+    s->count = 0;
+    s->end = 0;
+    return s->io.erase(0, s->capacity, s->io.ctx) ? ASSET_STORE_OK : ASSET_STORE_ERR_IO;
+}
+
+const uint8_t *asset_store_find(const asset_store_t *s, const uint8_t key[ASSET_KEY_LEN], uint8_t *type,
+                                uint32_t *size)
+{
+    const asset_store_entry_t *entry = entry_by_key(s, key);
+    if (entry == NULL) {
+        return NULL;
+    }
+    *type = entry->type;
+    *size = entry->size;
+    return s->base + entry->offset + ASSET_STORE_HEADER_SIZE;
+}
+
+uint32_t asset_store_received(const asset_store_t *s)
+{
+    return s->received;
+}
+
+void asset_store_get_stats(const asset_store_t *s, asset_store_stats_t *stats)
+{
+    stats->assets = s->count;
+    stats->used = s->end;
+    stats->capacity = s->capacity;
+    stats->uploads = s->uploads;
+    stats->failures = s->failures;
+}
+
+const char *asset_store_status_str(asset_store_status_t status)
+{
+    switch (status) {
+    case ASSET_STORE_OK:             return "ok";
+    case ASSET_STORE_ERR_FULL:       return "store full";
+    case ASSET_STORE_ERR_NOT_OPEN:   return "no upload in progress";
+    case ASSET_STORE_ERR_OFFSET:     return "non-contiguous data";
+    case ASSET_STORE_ERR_TOO_LONG:   return "more data than announced";
+    case ASSET_STORE_ERR_INCOMPLETE: return "incomplete";
+    case ASSET_STORE_ERR_HASH:       return "hash mismatch";
+    case ASSET_STORE_ERR_IO:         return "flash error";
+    case ASSET_STORE_ERR_DUPLICATE:  return "already stored";
+    case ASSET_STORE_ERR_BUSY:       return "busy";
+    default:                         return "?";
+    }
+}
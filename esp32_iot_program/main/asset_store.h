@@ -0,0 +1,132 @@
+/*
+ * Asset store
+ * Uploaded assets (LVGL binary images, or any other blob) live in a
+ * dedicated data partition that is memory-mapped, so they are read in place
+ * and never copied to RAM. Assets are content-addressed: the key is the
+ * first ASSET_KEY_LEN bytes of the SHA-256 of the data, so a client that
+ * knows which keys the device holds never sends the same bytes twice.
+ *
+ * The partition is a log of records, each starting on a sector boundary:
+ *
+ *   record := header(32) data(size) padding to the next sector
+ *   header := magic(4) key(8) type(1) reserved(3) size(4) state(4) reserved(8)
+ *
+ * all little-endian. A record is written in three steps: its sectors are
+ * erased and the header is written with state PENDING, the data follows in
+ * order, and once the hash of the data in flash matches the key the state
+ * is cleared to VALID. Only state bits are ever cleared, and a PENDING
+ * record ends the log, so a power loss in the middle of an upload leaves
+ * the store as it was before. Uploading a key that is already stored is
+ * refused as a duplicate before anything is erased.
+ *
+ * Space is only reclaimed by asset_store_erase_all.
+ *
+ * Reads go through the mapping; writes, erases and hashing go through the
+ * io hooks. Portable C11, no ESP-IDF dependencies. Not thread safe.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASSET_STORE_SECTOR       4096
+#define ASSET_STORE_HEADER_SIZE  32
+#define ASSET_STORE_MAX_ASSETS   32     // valid records tracked in RAM
+#define ASSET_KEY_LEN            8      // truncated SHA-256 of the data
+
+// Asset types
+#define ASSET_TYPE_BLOB   0x00  // stored as is
+#define ASSET_TYPE_IMAGE  0x01  // LVGL binary image: 4-byte lv_img_header_t, then the pixel data
+
+typedef enum {
+    ASSET_STORE_OK = 0,
+    ASSET_STORE_ERR_FULL,        // not enough free space or index entries for the record
+    ASSET_STORE_ERR_NOT_OPEN,    // data or finish without an upload in progress
+    ASSET_STORE_ERR_OFFSET,      // data not contiguous with what was written so far
+    ASSET_STORE_ERR_TOO_LONG,    // more data than announced
+    ASSET_STORE_ERR_INCOMPLETE,  // finish before all data arrived
+    ASSET_STORE_ERR_HASH,        // the data does not hash to its key
+    ASSET_STORE_ERR_IO,          // a flash write or erase failed
+    ASSET_STORE_ERR_DUPLICATE,   // the key is already stored
+    ASSET_STORE_ERR_BUSY,        // another client's upload is in progress (reported by the caller)
+} asset_store_status_t;
+
+typedef struct {
+    // Both return false on failure. Erase ranges are sector aligned.
+    bool (*write)(uint32_t offset, const void *data, size_t len, void *ctx);
+    bool (*erase)(uint32_t offset, size_t len, void *ctx);
+    // First ASSET_KEY_LEN bytes of the SHA-256 of data
+    void (*hash)(const uint8_t *data, size_t len, uint8_t key[ASSET_KEY_LEN], void *ctx);
+    void *ctx;
+} asset_store_io_t;
+
+typedef struct {
+    uint8_t key[ASSET_KEY_LEN];
+    uint8_t type;
+    uint32_t offset;  // of the record header in the partition
+    uint32_t size;
+} asset_store_entry_t;
+
+typedef struct {
+    uint32_t assets;
+    uint32_t used;       // bytes of the partition taken by records
+    uint32_t capacity;
+    uint32_t uploads;    // completed uploads since boot
+    uint32_t failures;   // uploads that ended in an error
+} asset_store_stats_t;
+
+typedef struct {
+    const uint8_t *base;  // mapped partition
+    uint32_t capacity;
+    asset_store_io_t io;
+    asset_store_entry_t entries[ASSET_STORE_MAX_ASSETS];
+    uint32_t count;
+    uint32_t end;         // first free sector, where the next record goes
+    // Upload in progress
+    bool open;
+    asset_store_entry_t upload;
+    uint32_t received;
+    uint32_t uploads;
+    uint32_t failures;
+} asset_store_t;
+
+// Scan the mapped partition and index its valid records
+void asset_store_init(asset_store_t *s, const uint8_t *base, uint32_t capacity, const asset_store_io_t *io);
+
+// Start an upload: erase room for the record at the end of the log and write its header.
+// An upload already in progress is abandoned.
+asset_store_status_t asset_store_begin(asset_store_t *s, const uint8_t key[ASSET_KEY_LEN], uint8_t type,
+                                       uint32_t size);
+
+// Append data at offset, which must equal the bytes received so far
+asset_store_status_t asset_store_write(asset_store_t *s, uint32_t offset, const uint8_t *data, size_t len);
+
+// Check the data against its key and publish the record
+asset_store_status_t asset_store_finish(asset_store_t *s);
+
+void asset_store_abort(asset_store_t *s);
+
+// Erase the whole partition. Pointers returned by asset_store_find become invalid.
+asset_store_status_t asset_store_erase_all(asset_store_t *s);
+
+// Data of a valid asset in the mapping, NULL when the key is unknown.
+// The pointer stays valid until asset_store_erase_all.
+const uint8_t *asset_store_find(const asset_store_t *s, const uint8_t key[ASSET_KEY_LEN], uint8_t *type,
+                                uint32_t *size);
+
+// Bytes of an upload received so far
+uint32_t asset_store_received(const asset_store_t *s);
+
+void asset_store_get_stats(const asset_store_t *s, asset_store_stats_t *stats);
+
+const char *asset_store_status_str(asset_store_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
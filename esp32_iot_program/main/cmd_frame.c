@@ -0,0 +1,182 @@
+/*
+ * Binary command frame (TLV) parser and encoder, see cmd_frame.h
+ */
+
+#include <string.h>
+#include "cmd_frame.h"
+
+static uint32_t read_rgb888(const uint8_t *value)
+{
+    return ((uint32_t)value[0] << 16) | ((uint32_t)value[1] << 8) | value[2];
+}
+
+bool cmd_frame_font_supported(uint8_t size)
+{
+    return size == 16 || size == 20 || size == 24 || size == 28;
+}
+
+cmd_frame_status_t cmd_frame_parse(const uint8_t *data, size_t len, cmd_frame_t *frame)
+{
+    size_t pos = 0;
+
+    frame->fields = 0;
+    frame->text_len = 0;
+    frame->text[0] = '\0';
+
+    while (pos < len) {
+        if (len - pos < 2) {
+            return CMD_FRAME_ERR_TRUNCATED;
+        }
+        uint8_t type = data[pos];
+        uint8_t value_len = data[pos + 1];
+        const uint8_t *value = &data[pos + 2];
+        pos += 2;
+
+        if (len - pos < value_len) {
+            return CMD_FRAME_ERR_TRUNCATED;
+        }
+        pos += value_len;
+
+        switch (type) {
+        case CMD_OP_SET_BG:
+            if (value_len != 3) {
+                return CMD_FRAME_ERR_BAD_LENGTH;
+            }
+            frame->bg_rgb888 = read_rgb888(value);
+            frame->fields |= CMD_FIELD_BG;
+            break;
+        case CMD_OP_SET_TEXT:
+            if (value_len > CMD_FRAME_TEXT_MAX) {
+                return CMD_FRAME_ERR_BAD_LENGTH;
+            }
+            memcpy(frame->text, value, value_len);
+            frame->text[value_len] = '\0';
+            frame->text_len = value_len;
+            frame->fields |= CMD_FIELD_TEXT;
+            break;
+        case CMD_OP_SET_TEXT_COLOR:
+            if (value_len != 3) {
+                return CMD_FRAME_ERR_BAD_LENGTH;
+            }
+            frame->text_rgb888 = read_rgb888(value);
+            frame->fields |= CMD_FIELD_TEXT_COLOR;
+            break;
+        case CMD_OP_SET_FONT:
+            if (value_len != 1) {
+                return CMD_FRAME_ERR_BAD_LENGTH;
+            }
+            if (!cmd_frame_font_supported(value[0])) {
+                return CMD_FRAME_ERR_BAD_VALUE;
+            }
+            frame->font_size = value[0];
+            frame->fields |= CMD_FIELD_FONT;
+            break;
+        case CMD_OP_SET_BRIGHTNESS:
+            if (value_len != 1) {
+                return CMD_FRAME_ERR_BAD_LENGTH;
+            }
+            frame->brightness = value[0];
+            frame->fields |= CMD_FIELD_BRIGHTNESS;
+            break;
+        case CMD_OP_SHOW_ASSET:
+            if (value_len != 0 && value_len != CMD_FRAME_ASSET_KEY_LEN + 4) {
+                return CMD_FRAME_ERR_BAD_LENGTH;
+            }
+            frame->asset_visible = value_len != 0;
+            if (frame->asset_visible) {
+                memcpy(frame->asset_key, value, CMD_FRAME_ASSET_KEY_LEN);
+                value += CMD_FRAME_ASSET_KEY_LEN;
+                frame->asset_x = value[0] | (value[1] << 8);
+                frame->asset_y = value[2] | (value[3] << 8);
+            }
+            frame->fields |= CMD_FIELD_ASSET;
+            break;
+        case CMD_OP_COMMIT:
+            if (value_len != 0) {
+                return CMD_FRAME_ERR_BAD_LENGTH;
+            }
+            return (pos == len) ? CMD_FRAME_OK : CMD_FRAME_ERR_TRAILING;
+        default:
+            return CMD_FRAME_ERR_UNKNOWN_OP;
+        }
+    }
+
+    return CMD_FRAME_ERR_NO_COMMIT;
+}
+
+static uint8_t *write_op(uint8_t *out, uint8_t type, uint8_t value_len)
+{
+    out[0] = type;
+    out[1] = value_len;
+    return out + 2;
+}
+
+static uint8_t *write_rgb888(uint8_t *out, uint32_t rgb)
+{
+    out[0] = (rgb >> 16) & 0xFF;
+    out[1] = (rgb >> 8) & 0xFF;
+    out[2] = rgb & 0xFF;
+    return out + 3;
+}
+
+size_t cmd_frame_encode(const cmd_frame_t *frame, uint8_t *out, size_t max_len)
+{
+    uint8_t buf[CMD_FRAME_ENCODED_MAX];
+    uint8_t *p = buf;
+
+    if (frame->fields & CMD_FIELD_BG) {
+        p = write_rgb888(write_op(p, CMD_OP_SET_BG, 3), frame->bg_rgb888);
+    }
+    if (frame->fields & CMD_FIELD_TEXT) {
+        uint8_t len = frame->text_len <= CMD_FRAME_TEXT_MAX ? frame->text_len : CMD_FRAME_TEXT_MAX;
+        p = write_op(p, CMD_OP_SET_TEXT, len);
+        memcpy(p, frame->text, len);
+        p += len;
+    }
+    if (frame->fields & CMD_FIELD_TEXT_COLOR) {
+        p = write_rgb888(write_op(p, CMD_OP_SET_TEXT_COLOR, 3), frame->text_rgb888);
+    }
+    if (frame->fields & CMD_FIELD_FONT) {
+        p = write_op(p, CMD_OP_SET_FONT, 1);
+        *p++ = frame->font_size;
+    }
+    if (frame->fields & CMD_FIELD_BRIGHTNESS) {
+        p = write_op(p, CMD_OP_SET_BRIGHTNESS, 1);
+        *p++ = frame->brightness;
+    }
+    if (frame->fields & CMD_FIELD_ASSET) {
+        if (frame->asset_visible) {
+            p = write_op(p, CMD_OP_SHOW_ASSET, CMD_FRAME_ASSET_KEY_LEN + 4);
+            memcpy(p, frame->asset_key, CMD_FRAME_ASSET_KEY_LEN);
+            p += CMD_FRAME_ASSET_KEY_LEN;
+            *p++ = frame->asset_x & 0xFF;
+            *p++ = frame->asset_x >> 8;
+            *p++ = frame->asset_y & 0xFF;
+            *p++ = frame->asset_y >> 8;
+        } else {
+            p = write_op(p, CMD_OP_SHOW_ASSET, 0);
+        }
+    }
+    p = write_op(p, CMD_OP_COMMIT, 0);
+
+    size_t len = (size_t)(p - buf);
+    if (len > max_len) {
+        return 0;
+    }
+    memcpy(out, buf, len);
+    return len;
+}
+
+const char *cmd_frame_status_str(cmd_frame_status_t status)
+{
+    switch (status) {
+    case CMD_FRAME_OK:             return "ok";
+    case CMD_FRAME_ERR_TRUNCATED:  return "truncated";
+    case CMD_FRAME_ERR_BAD_LENGTH: return "bad length";
+    case CMD_FRAME_ERR_UNKNOWN_OP: return "unknown op";
+    case CMD_FRAME_ERR_NO_COMMIT:  return "no commit";
+    case CMD_FRAME_ERR_TRAILING:   return "trailing bytes";
+    case CMD_FRAME_ERR_BAD_VALUE:  return "bad value";
+    default:                       return "?";
+    }
+}
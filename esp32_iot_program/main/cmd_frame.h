@@ -0,0 +1,87 @@
+/*
+ * Binary command frame (TLV) parser and encoder
+ * A frame written to the command characteristic carries several display
+ * operations that are applied together in one render:
+ *
+ *   frame := op* COMMIT
+ *   op    := type(1) length(1) value(length)
+ *
+ * Repeated operations in one frame overwrite earlier ones. A frame is only
+ * accepted when it ends with a COMMIT operation, so a truncated write never
+ * reaches the display.
+ *
+ * Portable C, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CMD_FRAME_TEXT_MAX 128
+
+// Operation types
+#define CMD_OP_SET_BG          0x01  // 3 bytes: R, G, B
+#define CMD_OP_SET_TEXT        0x02  // 0..CMD_FRAME_TEXT_MAX bytes of UTF-8
+#define CMD_OP_SET_TEXT_COLOR  0x03  // 3 bytes: R, G, B
+#define CMD_OP_SET_FONT        0x04  // 1 byte: font size in px (16, 20, 24, 28)
+#define CMD_OP_SET_BRIGHTNESS  0x05  // 1 byte: backlight level 0..255
+#define CMD_OP_SHOW_ASSET      0x06  // 12 bytes: asset key, x, y as uint16 little-endian; empty hides it
+#define CMD_OP_COMMIT          0xFF  // 0 bytes: end of frame
+
+// Bits in cmd_frame_t.fields for the operations present in a frame
+#define CMD_FIELD_BG          (1 << 0)
+#define CMD_FIELD_TEXT        (1 << 1)
+#define CMD_FIELD_TEXT_COLOR  (1 << 2)
+#define CMD_FIELD_FONT        (1 << 3)
+#define CMD_FIELD_BRIGHTNESS  (1 << 4)
+#define CMD_FIELD_ASSET       (1 << 5)
+
+#define CMD_FRAME_ASSET_KEY_LEN 8  // ASSET_KEY_LEN
+
+// Longest frame cmd_frame_encode produces: every operation once, the longest text, and COMMIT
+#define CMD_FRAME_ENCODED_MAX (5 + 2 + CMD_FRAME_TEXT_MAX + 5 + 3 + 3 + 2 + CMD_FRAME_ASSET_KEY_LEN + 4 + 2)
+
+typedef enum {
+    CMD_FRAME_OK = 0,
+    CMD_FRAME_ERR_TRUNCATED,    // an operation runs past the end of the frame
+    CMD_FRAME_ERR_BAD_LENGTH,   // an operation has the wrong value length
+    CMD_FRAME_ERR_UNKNOWN_OP,   // unsupported operation type
+    CMD_FRAME_ERR_NO_COMMIT,    // frame does not end with COMMIT
+    CMD_FRAME_ERR_TRAILING,     // bytes after COMMIT
+    CMD_FRAME_ERR_BAD_VALUE,    // a value the display cannot show (font size)
+} cmd_frame_status_t;
+
+typedef struct {
+    uint8_t fields;        // CMD_FIELD_* bitmask
+    uint8_t font_size;
+    uint8_t brightness;
+    uint8_t text_len;
+    uint32_t bg_rgb888;
+    uint32_t text_rgb888;
+    uint8_t asset_key[CMD_FRAME_ASSET_KEY_LEN];
+    uint8_t asset_visible;  // 0 when SHOW_ASSET was empty
+    uint16_t asset_x;
+    uint16_t asset_y;
+    char text[CMD_FRAME_TEXT_MAX + 1];  // NUL terminated
+} cmd_frame_t;
+
+cmd_frame_status_t cmd_frame_parse(const uint8_t *data, size_t len, cmd_frame_t *frame);
+
+// Font sizes the display has compiled in, see CMD_OP_SET_FONT
+bool cmd_frame_font_supported(uint8_t size);
+
+// Encode the operations present in frame->fields, followed by COMMIT, so that cmd_frame_parse
+// gives back the same frame. Returns the length, 0 when it does not fit in max_len.
+size_t cmd_frame_encode(const cmd_frame_t *frame, uint8_t *out, size_t max_len);
+
+const char *cmd_frame_status_str(cmd_frame_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
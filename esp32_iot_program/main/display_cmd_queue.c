@@ -0,0 +1,90 @@
+/*
+ * Display command queue
+ * Lock-free SPSC ring, see display_cmd_queue.h
+ */
+
+#include <string.h>
+#include "display_cmd_queue.h"
+
+#define QUEUE_MASK (DISPLAY_CMD_QUEUE_LEN - 1)
+
+_Static_assert((DISPLAY_CMD_QUEUE_LEN & QUEUE_MASK) == 0, "DISPLAY_CMD_QUEUE_LEN must be a power of two");
+
+void display_cmd_queue_init(display_cmd_queue_t *q)
+{
+    memset(q, 0, sizeof(*q));
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+display_cmd_t *display_cmd_queue_reserve(display_cmd_queue_t *q)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+    if (head - tail >= DISPLAY_CMD_QUEUE_LEN) {
+        q->dropped++;
+        return NULL;
+    }
+    return &q->slots[head & QUEUE_MASK];
+}
+
+void display_cmd_queue_commit(display_cmd_queue_t *q)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed) + 1;
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    // Release publishes the slot contents before the new head becomes visible
+    atomic_store_explicit(&q->head, head, memory_order_release);
+
+    q->enqueued++;
+    if (head - tail > q->high_water) {
+        q->high_water = head - tail;
+    }
+}
+
+bool display_cmd_queue_push(display_cmd_queue_t *q, const display_cmd_t *cmd)
+{
+    display_cmd_t *slot = display_cmd_queue_reserve(q);
+    if (slot == NULL) {
+        return false;
+    }
+    memcpy(slot, cmd, sizeof(*slot));
+    display_cmd_queue_commit(q);
+    return true;
+}
+
+const display_cmd_t *display_cmd_queue_peek(display_cmd_queue_t *q)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+    if (tail == head) {
+        return NULL;
+    }
+    return &q->slots[tail & QUEUE_MASK];
+}
+
+void display_cmd_queue_pop(display_cmd_queue_t *q)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    // Release hands the slot back to the producer only after it has been read
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    q->dequeued++;
+}
+
+uint32_t display_cmd_queue_count(display_cmd_queue_t *q)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return head - tail;
+}
+
+void display_cmd_queue_get_stats(display_cmd_queue_t *q, display_cmd_queue_stats_t *stats)
+{
+    stats->enqueued = q->enqueued;
+    stats->dropped = q->dropped;
+    stats->dequeued = q->dequeued;
+    stats->high_water = q->high_water;
+}
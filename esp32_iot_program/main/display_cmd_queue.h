@@ -0,0 +1,100 @@
+/*
+ * Display command queue
+ * Lock-free single-producer/single-consumer ring of typed display commands.
+ * The producer is the Bluedroid callback context (GAP and GATTS handlers),
+ * the consumer is lvgl_task, which is the only code allowed to touch LVGL.
+ *
+ * Overflow policy: when the ring is full the newest command is rejected and
+ * counted as dropped; commands already queued are never overwritten.
+ *
+ * Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "cmd_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISPLAY_CMD_QUEUE_LEN  16   // must be a power of two
+#define DISPLAY_CMD_TEXT_MAX   128  // longest text carried inline in a command
+
+typedef enum {
+    DISPLAY_CMD_SET_BG_RGB565,  // Background color, RGB565
+    DISPLAY_CMD_SET_BG_RGB888,  // Background color, RGB888
+    DISPLAY_CMD_SET_TEXT,       // Label text
+    DISPLAY_CMD_SET_STATUS,     // Connection status indicator
+    DISPLAY_CMD_APPLY_FRAME,    // Several operations from one command frame, applied atomically
+    DISPLAY_CMD_SET_TEXT_REF,   // Label text by reference (long-write arena), released after use
+} display_cmd_type_t;
+
+// display_cmd_t.flags
+#define DISPLAY_CMD_FLAG_STREAM  (1 << 0)  // arrived on the credit-based stream characteristic
+#define DISPLAY_CMD_FLAG_FENCE   (1 << 1)  // someone waits until the consumer has applied it
+
+typedef struct {
+    uint8_t type;     // display_cmd_type_t
+    uint8_t flags;    // DISPLAY_CMD_FLAG_*
+    uint16_t conn;    // stream commands: the producer's tag for the connection that wrote it
+    uint32_t rx_us;   // when the write carrying the command arrived (low 32 bits of the us clock)
+    uint32_t enq_us;  // when it was published to the queue
+    union {
+        uint16_t rgb565;
+        uint32_t rgb888;
+        uint8_t status;
+        struct {
+            uint16_t len;
+            char str[DISPLAY_CMD_TEXT_MAX + 1];
+        } text;
+        struct {
+            const char *str;  // NUL terminated, owned by the producer until the command is applied
+            uint16_t len;
+        } text_ref;
+        cmd_frame_t frame;
+    };
+} display_cmd_t;
+
+typedef struct {
+    uint32_t enqueued;    // commands accepted by push
+    uint32_t dropped;     // commands rejected because the ring was full
+    uint32_t dequeued;    // commands consumed by pop
+    uint32_t high_water;  // highest fill level observed by the producer
+} display_cmd_queue_stats_t;
+
+typedef struct {
+    display_cmd_t slots[DISPLAY_CMD_QUEUE_LEN];
+    _Atomic uint32_t head;  // next slot to write, owned by the producer
+    _Atomic uint32_t tail;  // next slot to read, owned by the consumer
+    // Producer-owned counters
+    uint32_t enqueued;
+    uint32_t dropped;
+    uint32_t high_water;
+    // Consumer-owned counters
+    uint32_t dequeued;
+} display_cmd_queue_t;
+
+void display_cmd_queue_init(display_cmd_queue_t *q);
+
+// Producer side: reserve the next free slot (NULL and counted as dropped when full),
+// fill it in place, then publish it with commit.
+display_cmd_t *display_cmd_queue_reserve(display_cmd_queue_t *q);
+void display_cmd_queue_commit(display_cmd_queue_t *q);
+
+// Producer side convenience wrapper: copy a command into the ring.
+bool display_cmd_queue_push(display_cmd_queue_t *q, const display_cmd_t *cmd);
+
+// Consumer side: peek at the oldest command (NULL when empty), then release it with pop.
+const display_cmd_t *display_cmd_queue_peek(display_cmd_queue_t *q);
+void display_cmd_queue_pop(display_cmd_queue_t *q);
+
+uint32_t display_cmd_queue_count(display_cmd_queue_t *q);
+void display_cmd_queue_get_stats(display_cmd_queue_t *q, display_cmd_queue_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Display write protocol, see display_protocol.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "display_protocol.h"
+
+bool display_protocol_color(const uint8_t *value, uint16_t len, display_cmd_t *cmd)
+{
+    if (len == 2) {
+        // RGB565 format (2 bytes)
+        cmd->type = DISPLAY_CMD_SET_BG_RGB565;
+        cmd->flags = 0;
+        cmd->rgb565 = (uint16_t)((value[0] << 8) | value[1]);
+        return true;
+    }
+    if (len == 6 || len == 7) {
+        // Hex string format: "RRGGBB" or "#RRGGBB", used as RGB888 without going through RGB565
+        char hex_str[8] = {0};
+        memcpy(hex_str, value, len);
+        const char *hex_start = (hex_str[0] == '#') ? hex_str + 1 : hex_str;
+        cmd->type = DISPLAY_CMD_SET_BG_RGB888;
+        cmd->flags = 0;
+        cmd->rgb888 = (uint32_t)strtol(hex_start, NULL, 16);
+        return true;
+    }
+    return false;
+}
+
+bool display_protocol_text(const uint8_t *value, uint16_t len, display_cmd_t *cmd)
+{
+    if (len > DISPLAY_CMD_TEXT_MAX) {
+        return false;
+    }
+    cmd->type = DISPLAY_CMD_SET_TEXT;
+    cmd->flags = 0;
+    cmd->text.len = len;
+    memcpy(cmd->text.str, value, len);
+    cmd->text.str[len] = '\0';
+    return true;
+}
+
+cmd_frame_status_t display_protocol_frame(const uint8_t *value, uint16_t len, uint8_t flags, display_cmd_t *cmd)
+{
+    cmd_frame_status_t status = cmd_frame_parse(value, len, &cmd->frame);
+    if (status == CMD_FRAME_OK) {
+        cmd->type = DISPLAY_CMD_APPLY_FRAME;
+        cmd->flags = flags;
+    }
+    return status;
+}
@@ -0,0 +1,35 @@
+/*
+ * Display write protocol
+ * Decodes writes to the color, text and command characteristics into
+ * display commands, in place in a queue slot. Shared by the GATT handler
+ * and the host replay benchmark.
+ *
+ *   color:   2 bytes RGB565 (big-endian), or "RRGGBB" / "#RRGGBB"
+ *   text:    UTF-8, up to DISPLAY_CMD_TEXT_MAX bytes inline
+ *   command: a cmd_frame.h frame
+ *
+ * Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "display_cmd_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fill cmd from a color write; false for an unsupported length
+bool display_protocol_color(const uint8_t *value, uint16_t len, display_cmd_t *cmd);
+
+// Fill cmd from a text write of at most DISPLAY_CMD_TEXT_MAX bytes; false when longer
+bool display_protocol_text(const uint8_t *value, uint16_t len, display_cmd_t *cmd);
+
+// Parse a command frame into cmd
+cmd_frame_status_t display_protocol_frame(const uint8_t *value, uint16_t len, uint8_t flags, display_cmd_t *cmd);
+
+#ifdef __cplusplus
+}
+#endif
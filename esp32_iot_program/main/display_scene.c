@@ -0,0 +1,464 @@
+/*
+ * Display scene, see display_scene.h
+ */
+
+#include <string.h>
+#include "display_scene.h"
+
+static display_scene_hooks_t hooks;
+static lv_obj_t *screen_obj = NULL;
+static lv_obj_t *text_label = NULL;
+static lv_obj_t *status_indicator = NULL;
+static lv_timer_t *blink_timer = NULL;
+
+// Label cache: repeated texts are shown as a stored rendering through text_image instead of
+// being laid out and rasterized again by text_label. Only one of the two is visible.
+static label_cache_t label_cache;
+static lv_obj_t *text_image = NULL;
+static lv_img_dsc_t text_image_dsc;
+static uint8_t text_font_size = 24;
+static lv_color_t text_color;
+static char text_shown[LABEL_CACHE_TEXT_MAX + 1];  // text of text_image
+static bool label_stale = false;                    // text_label does not hold the shown text
+#define TEXT_MARGIN 40                              // horizontal space left around wrapped text
+
+// Uploaded image shown by CMD_OP_SHOW_ASSET, read in place through find_image
+static lv_obj_t *asset_image = NULL;
+static lv_img_dsc_t asset_image_dsc;
+
+static connection_status_t current_status = STATUS_DISCONNECTED;
+static bool indicator_flash_state = false;
+
+static void request_refresh(void)
+{
+    if (hooks.request_refresh != NULL) {
+        hooks.request_refresh(hooks.ctx);
+    }
+}
+
+// Fill the whole screen except the given areas (inclusive coordinates, may overlap).
+// The screen is split into horizontal bands at the hole edges and the gaps in each band are filled.
+static void fill_screen_except(const lv_area_t *holes, int hole_count, lv_color_t color)
+{
+    const int hor_res = lv_disp_get_hor_res(NULL);
+    const int ver_res = lv_disp_get_ver_res(NULL);
+    int ys[2 * DISPLAY_SCENE_MAX_HOLES + 2];
+    int ys_count = 0;
+
+    ys[ys_count++] = 0;
+    ys[ys_count++] = ver_res;
+    for (int i = 0; i < hole_count; i++) {
+        ys[ys_count++] = LV_CLAMP(0, holes[i].y1, ver_res);
+        ys[ys_count++] = LV_CLAMP(0, holes[i].y2 + 1, ver_res);
+    }
+    // Insertion sort, at most ten entries
+    for (int i = 1; i < ys_count; i++) {
+        for (int j = i; j > 0 && ys[j - 1] > ys[j]; j--) {
+            int tmp = ys[j];
+            ys[j] = ys[j - 1];
+            ys[j - 1] = tmp;
+        }
+    }
+
+    for (int b = 0; b + 1 < ys_count; b++) {
+        int band_y1 = ys[b];
+        int band_y2 = ys[b + 1];  // exclusive
+        if (band_y1 == band_y2) {
+            continue;
+        }
+
+        // Holes spanning this band, sorted by x
+        lv_area_t band_holes[DISPLAY_SCENE_MAX_HOLES];
+        int band_hole_count = 0;
+        for (int i = 0; i < hole_count; i++) {
+            if (holes[i].y1 <= band_y1 && holes[i].y2 >= band_y2 - 1) {
+                int j = band_hole_count++;
+                while (j > 0 && band_holes[j - 1].x1 > holes[i].x1) {
+                    band_holes[j] = band_holes[j - 1];
+                    j--;
+                }
+                band_holes[j] = holes[i];
+            }
+        }
+
+        int x = 0;
+        for (int i = 0; i < band_hole_count; i++) {
+            int hole_x1 = LV_CLAMP(0, band_holes[i].x1, hor_res);
+            if (hole_x1 > x) {
+                hooks.fill_rect(x, band_y1, hole_x1 - x, band_y2 - band_y1, color, hooks.ctx);
+            }
+            x = LV_MAX(x, LV_CLAMP(0, band_holes[i].x2 + 1, hor_res));
+        }
+        if (hor_res > x) {
+            hooks.fill_rect(x, band_y1, hor_res - x, band_y2 - band_y1, color, hooks.ctx);
+        }
+    }
+    hooks.fill_wait(hooks.ctx);
+}
+
+// True when the whole screen is already waiting to be rendered, as before the first frame
+static bool screen_invalidated(lv_disp_t *disp)
+{
+    lv_area_t screen;
+    lv_area_set(&screen, 0, 0, lv_disp_get_hor_res(disp) - 1, lv_disp_get_ver_res(disp) - 1);
+    for (int i = 0; i < disp->inv_p; i++) {
+        if (!disp->inv_area_joined[i] && _lv_area_is_in(&screen, &disp->inv_areas[i], 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Change the screen background without LVGL rasterizing it: the fill hook paints
+// everything around the visible children and only the children are re-rendered
+void display_scene_set_background(lv_color_t color)
+{
+    lv_disp_t *disp = lv_disp_get_default();
+
+    // LVGL paints every pixel with the next frame anyway, a fill first would paint them twice
+    if (screen_invalidated(disp)) {
+        lv_obj_set_style_bg_color(screen_obj, color, 0);
+        request_refresh();
+        return;
+    }
+
+    lv_disp_enable_invalidation(disp, false);
+    lv_obj_set_style_bg_color(screen_obj, color, 0);
+    lv_disp_enable_invalidation(disp, true);
+
+    // Child coordinates must reflect any text change applied in the same batch
+    lv_obj_update_layout(screen_obj);
+
+    lv_area_t holes[DISPLAY_SCENE_MAX_HOLES];
+    int hole_count = 0;
+    uint32_t child_count = lv_obj_get_child_cnt(screen_obj);
+    for (uint32_t i = 0; i < child_count && hole_count < DISPLAY_SCENE_MAX_HOLES; i++) {
+        lv_obj_t *child = lv_obj_get_child(screen_obj, i);
+        if (!lv_obj_has_flag(child, LV_OBJ_FLAG_HIDDEN)) {
+            lv_obj_get_coords(child, &holes[hole_count++]);
+            lv_obj_invalidate(child);
+        }
+    }
+
+    // With LV_COLOR_16_SWAP lv_color_t is already in panel wire order
+    fill_screen_except(holes, hole_count, color);
+
+    // Only the children were invalidated; they are rendered with the next frame
+    request_refresh();
+}
+
+static void set_background_rgb565(uint16_t color)
+{
+    // Expand RGB565 to RGB888 by replicating the top bits
+    uint8_t r5 = (color >> 11) & 0x1F;
+    uint8_t g6 = (color >> 5) & 0x3F;
+    uint8_t b5 = color & 0x1F;
+    uint8_t r8 = (r5 << 3) | (r5 >> 2);
+    uint8_t g8 = (g6 << 2) | (g6 >> 4);
+    uint8_t b8 = (b5 << 3) | (b5 >> 2);
+    display_scene_set_background(lv_color_hex((r8 << 16) | (g8 << 8) | b8));
+}
+
+static uint32_t text_style(void)
+{
+    return ((uint32_t)text_font_size << 16) | text_color.full;
+}
+
+// Shrink the label to its text: as wide as the longest line, wrapped at the margin. A snapshot
+// then covers the glyphs only, and the image, centered like the label, lands where it drew them.
+static void label_fit_width(const char *text)
+{
+    lv_point_t size;
+    lv_txt_get_size(&size, text, lv_obj_get_style_text_font(text_label, 0),
+                    lv_obj_get_style_text_letter_space(text_label, 0),
+                    lv_obj_get_style_text_line_space(text_label, 0),
+                    lv_disp_get_hor_res(NULL) - TEXT_MARGIN, LV_TEXT_FLAG_NONE);
+    lv_obj_set_width(text_label, LV_MAX(size.x, 1));
+}
+
+#if LV_USE_SNAPSHOT
+// Store a rendering of the label as it is now (text, font, color); the label box is fitted to the
+// text and has a transparent background, so the snapshot keeps an alpha channel and blends over
+// any screen color
+static void label_cache_store(const char *text, size_t len)
+{
+    lv_obj_update_layout(text_label);
+    uint32_t size = lv_snapshot_buf_size_needed(text_label, LV_IMG_CF_TRUE_COLOR_ALPHA);
+    label_cache_entry_t *entry = label_cache_insert(&label_cache, text, len, text_style(), size);
+    if (entry == NULL) {
+        return;
+    }
+    lv_img_dsc_t dsc;
+    if (lv_snapshot_take_to_buf(text_label, LV_IMG_CF_TRUE_COLOR_ALPHA, &dsc, entry->pixels, size) != LV_RES_OK) {
+        label_cache_drop(&label_cache, entry);
+        return;
+    }
+    entry->width = dsc.header.w;
+    entry->height = dsc.header.h;
+}
+#endif
+
+// Show text in the current font and color: a cached rendering is blitted as an image,
+// anything else goes through the label and is added to the cache
+static void show_text(const char *text)
+{
+    size_t len = strlen(text);
+#if LV_USE_SNAPSHOT
+    const label_cache_entry_t *entry = label_cache_get(&label_cache, text, len, text_style());
+    if (entry != NULL) {
+        memmove(text_shown, text, len);
+        text_shown[len] = '\0';
+        label_stale = true;
+
+        text_image_dsc.header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+        text_image_dsc.header.w = entry->width;
+        text_image_dsc.header.h = entry->height;
+        text_image_dsc.data_size = entry->size;
+        text_image_dsc.data = entry->pixels;
+        // The descriptor is reused, so LVGL must not keep decoder state for the previous entry
+        lv_img_cache_invalidate_src(&text_image_dsc);
+        lv_img_set_src(text_image, &text_image_dsc);
+        lv_obj_center(text_image);
+        lv_obj_clear_flag(text_image, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(text_label, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+#endif
+
+    lv_label_set_text(text_label, text);
+    label_fit_width(text);
+    label_stale = false;
+
+    // Make sure label is visible and centered
+    lv_obj_add_flag(text_image, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_clear_flag(text_label, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_center(text_label);
+
+#if LV_USE_SNAPSHOT
+    if (len <= LABEL_CACHE_TEXT_MAX) {
+        label_cache_store(text, len);
+    }
+#endif
+}
+
+void display_scene_set_text(const char *text)
+{
+    show_text(text);
+
+    // Only the label (or image) area is invalidated
+    request_refresh();
+}
+
+void display_scene_set_status(connection_status_t status)
+{
+    current_status = status;
+    indicator_flash_state = false;
+
+    switch (status) {
+        case STATUS_DISCONNECTED:
+            lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0xFF0000), 0);  // Red
+            break;
+        case STATUS_ADVERTISING:
+            lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x0000FF), 0);  // Blue
+            break;
+        case STATUS_CONNECTED:
+            lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x00FF00), 0);  // Green
+            break;
+    }
+
+    // The blink timer only runs while advertising, so other states cost no wakeups
+    if (status == STATUS_ADVERTISING) {
+        lv_timer_reset(blink_timer);
+        lv_timer_resume(blink_timer);
+    } else {
+        lv_timer_pause(blink_timer);
+    }
+    request_refresh();
+}
+
+// LVGL timer to handle indicator flashing, resumed only while advertising.
+// Changing the style invalidates just the indicator's bounding box.
+static void status_indicator_timer_cb(lv_timer_t *timer)
+{
+    if (current_status != STATUS_ADVERTISING) {
+        lv_timer_pause(timer);
+        return;
+    }
+    // Flash blue when advertising
+    if (indicator_flash_state) {
+        lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x0000FF), 0);  // Blue
+    } else {
+        lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x000000), 0);  // Black (off)
+    }
+    indicator_flash_state = !indicator_flash_state;
+    request_refresh();
+}
+
+// Place a stored image at (x, y), or hide it when the frame asks to or the asset is unknown or malformed
+static void show_asset(const cmd_frame_t *frame)
+{
+    uint32_t size = 0;
+    const uint8_t *data = NULL;
+    if (frame->asset_visible && hooks.find_image != NULL) {
+        data = hooks.find_image(frame->asset_key, &size, hooks.ctx);
+    }
+    lv_img_header_t header;
+    if (data != NULL && size >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+        uint32_t needed = lv_img_buf_get_img_size(header.w, header.h, header.cf);
+        if (header.always_zero != 0 || needed == 0 || needed > size - sizeof(header)) {
+            LV_LOG_WARN("Asset is not an LVGL image");
+            data = NULL;
+        }
+    } else if (frame->asset_visible) {
+        LV_LOG_WARN("Asset not found");
+        data = NULL;
+    }
+    if (data == NULL) {
+        lv_obj_add_flag(asset_image, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+
+    asset_image_dsc.header = header;
+    asset_image_dsc.data_size = size - sizeof(header);
+    asset_image_dsc.data = data + sizeof(header);
+    lv_img_cache_invalidate_src(&asset_image_dsc);
+    lv_img_set_src(asset_image, &asset_image_dsc);
+    lv_obj_set_pos(asset_image, frame->asset_x, frame->asset_y);
+    lv_obj_clear_flag(asset_image, LV_OBJ_FLAG_HIDDEN);
+}
+
+static const lv_font_t *font_for_size(uint8_t size)
+{
+    switch (size) {
+    case 16: return &lv_font_montserrat_16;
+    case 20: return &lv_font_montserrat_20;
+    case 24: return &lv_font_montserrat_24;
+    case 28: return &lv_font_montserrat_28;
+    default: return NULL;
+    }
+}
+
+// Apply all operations of a command frame; they land in the same render pass.
+// Text, font and image go first so the background fill sees the final geometry.
+static void apply_frame(const cmd_frame_t *frame)
+{
+    bool restyled = false;
+    if (frame->fields & CMD_FIELD_FONT) {
+        const lv_font_t *font = font_for_size(frame->font_size);
+        if (font != NULL) {
+            lv_obj_set_style_text_font(text_label, font, 0);
+            text_font_size = frame->font_size;
+            restyled = true;
+        } else {
+            LV_LOG_WARN("Unsupported font size %d", frame->font_size);
+        }
+    }
+    if (frame->fields & CMD_FIELD_TEXT_COLOR) {
+        text_color = lv_color_hex(frame->text_rgb888);
+        lv_obj_set_style_text_color(text_label, text_color, 0);
+        restyled = true;
+    }
+    if (frame->fields & CMD_FIELD_TEXT) {
+        show_text(frame->text);
+    } else if (restyled) {
+        // Same text in the new style, which may be cached as well
+        show_text(label_stale ? text_shown : lv_label_get_text(text_label));
+    }
+    if (frame->fields & CMD_FIELD_ASSET) {
+        show_asset(frame);
+    }
+    if (frame->fields & CMD_FIELD_BG) {
+        display_scene_set_background(lv_color_hex(frame->bg_rgb888));
+    }
+    if ((frame->fields & CMD_FIELD_BRIGHTNESS) && hooks.set_brightness != NULL) {
+        hooks.set_brightness(frame->brightness, hooks.ctx);
+    }
+    request_refresh();
+}
+
+void display_scene_apply(const display_cmd_t *cmd)
+{
+    switch (cmd->type) {
+    case DISPLAY_CMD_SET_BG_RGB565:
+        set_background_rgb565(cmd->rgb565);
+        break;
+    case DISPLAY_CMD_SET_BG_RGB888:
+        display_scene_set_background(lv_color_hex(cmd->rgb888));
+        break;
+    case DISPLAY_CMD_SET_TEXT:
+        display_scene_set_text(cmd->text.str);
+        break;
+    case DISPLAY_CMD_SET_TEXT_REF:
+        // lv_label_set_text copies the string
+        display_scene_set_text(cmd->text_ref.str);
+        break;
+    case DISPLAY_CMD_SET_STATUS:
+        display_scene_set_status((connection_status_t)cmd->status);
+        break;
+    case DISPLAY_CMD_APPLY_FRAME:
+        apply_frame(&cmd->frame);
+        break;
+    default:
+        LV_LOG_WARN("Unknown display command %d", cmd->type);
+        break;
+    }
+}
+
+lv_obj_t *display_scene_screen(void)
+{
+    return screen_obj;
+}
+
+void display_scene_get_label_cache_stats(label_cache_stats_t *stats)
+{
+    label_cache_get_stats(&label_cache, stats);
+}
+
+void display_scene_create(const display_scene_hooks_t *scene_hooks, uint32_t label_cache_budget)
+{
+    hooks = *scene_hooks;
+    label_cache_init(&label_cache, LV_USE_SNAPSHOT ? label_cache_budget : 0);
+    text_color = lv_color_hex(0xFFFFFF);
+
+    // Create screen and label
+    screen_obj = lv_obj_create(NULL);
+    // Use RGB888 black (0x000000) for proper color handling
+    lv_obj_set_style_bg_color(screen_obj, lv_color_hex(0x000000), 0);
+    lv_scr_load(screen_obj);
+
+    // Uploaded images go below the text
+    asset_image = lv_img_create(screen_obj);
+    lv_obj_add_flag(asset_image, LV_OBJ_FLAG_HIDDEN);
+
+    // Create text label
+    text_label = lv_label_create(screen_obj);
+    lv_label_set_text(text_label, "Ready");
+    // Use RGB888 white (0xFFFFFF) instead of RGB565 (0xFFFF) for proper white color
+    lv_obj_set_style_text_color(text_label, text_color, 0);
+    lv_obj_set_style_text_font(text_label, &lv_font_montserrat_24, 0);  // 24pt font (enabled via sdkconfig)
+    lv_label_set_long_mode(text_label, LV_LABEL_LONG_WRAP);
+    label_fit_width("Ready");  // at most the screen width minus a margin for better readability
+
+    // Make label background transparent so screen color shows through
+    lv_obj_set_style_bg_opa(text_label, LV_OPA_TRANSP, 0);
+
+    lv_obj_center(text_label);
+
+    // Cached renderings of the label are shown here instead
+    text_image = lv_img_create(screen_obj);
+    lv_obj_add_flag(text_image, LV_OBJ_FLAG_HIDDEN);
+
+    // Create connection status indicator in top right corner
+    status_indicator = lv_obj_create(screen_obj);
+    lv_obj_set_size(status_indicator, 20, 20);  // 20x20 circle
+    lv_obj_align(status_indicator, LV_ALIGN_TOP_RIGHT, -10, 10);  // 10px from top and right edges
+    lv_obj_set_style_radius(status_indicator, LV_RADIUS_CIRCLE, 0);  // Make it circular
+    lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0xFF0000), 0);  // Start red (not connected)
+    lv_obj_set_style_border_color(status_indicator, lv_color_hex(0x000000), 0);  // Black outline
+    lv_obj_set_style_border_width(status_indicator, 2, 0);  // 2px border width
+
+    // Advertising blink runs as an LVGL timer in the task that owns LVGL, paused until advertising starts
+    blink_timer = lv_timer_create(status_indicator_timer_cb, 500, NULL);  // Flash every 500ms
+    lv_timer_pause(blink_timer);
+}
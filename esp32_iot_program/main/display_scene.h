@@ -0,0 +1,66 @@
+/*
+ * Display scene
+ * The LVGL object tree of the display (background, text label, connection
+ * status indicator) and the application of display commands to it.
+ *
+ * Pixels that bypass LVGL (solid background fills) and the backlight go
+ * through the hooks below, so the same scene runs on the panel in the
+ * firmware and on an in-memory framebuffer in the host benchmark.
+ *
+ * LVGL v8, no ESP-IDF dependencies. Only the task that owns LVGL may call
+ * into the scene.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lvgl.h"
+#include "display_cmd_queue.h"
+#include "label_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISPLAY_SCENE_MAX_HOLES 4  // visible objects the background fill paints around
+
+// Status indicator state
+typedef enum {
+    STATUS_DISCONNECTED,  // Red
+    STATUS_ADVERTISING,   // Flashing blue
+    STATUS_CONNECTED      // Green
+} connection_status_t;
+
+typedef struct {
+    // Fill a rectangle with a color already in panel wire order; the transfer may stay in flight
+    void (*fill_rect)(int x, int y, int width, int height, lv_color_t color, void *ctx);
+    // Wait until all fills have left their buffers
+    void (*fill_wait)(void *ctx);
+    void (*set_brightness)(uint8_t level, void *ctx);
+    // The scene changed; the owner schedules the render
+    void (*request_refresh)(void *ctx);
+    // Data of a stored image asset (LVGL binary image: lv_img_header_t, then the pixels) and its
+    // size, NULL when there is none. The data must stay readable while it is shown.
+    const uint8_t *(*find_image)(const uint8_t key[CMD_FRAME_ASSET_KEY_LEN], uint32_t *size, void *ctx);
+    void *ctx;
+} display_scene_hooks_t;
+
+// Build the scene on the default display and load it. The hooks are copied. Repeated texts
+// are served from a cache of label renderings of at most label_cache_budget bytes (0 disables it;
+// it also needs LV_USE_SNAPSHOT).
+void display_scene_create(const display_scene_hooks_t *hooks, uint32_t label_cache_budget);
+
+// Apply one display command. Text by reference is copied by the label before this returns.
+void display_scene_apply(const display_cmd_t *cmd);
+
+void display_scene_set_background(lv_color_t color);
+void display_scene_set_text(const char *text);
+void display_scene_set_status(connection_status_t status);
+
+lv_obj_t *display_scene_screen(void);
+
+void display_scene_get_label_cache_stats(label_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Persistent display state, see display_state.h
+ */
+
+#include <string.h>
+#include "display_state.h"
+
+#define ALL_FIELDS (CMD_FIELD_BG | CMD_FIELD_TEXT | CMD_FIELD_TEXT_COLOR | CMD_FIELD_FONT | \
+                    CMD_FIELD_BRIGHTNESS | CMD_FIELD_ASSET)
+
+static bool set_u32(uint32_t *field, uint32_t value)
+{
+    if (*field == value) {
+        return false;
+    }
+    *field = value;
+    return true;
+}
+
+static bool set_u8(uint8_t *field, uint8_t value)
+{
+    if (*field == value) {
+        return false;
+    }
+    *field = value;
+    return true;
+}
+
+// Same expansion as the scene uses for RGB565 color writes
+static uint32_t rgb565_to_rgb888(uint16_t color)
+{
+    uint8_t r5 = (color >> 11) & 0x1F;
+    uint8_t g6 = (color >> 5) & 0x3F;
+    uint8_t b5 = color & 0x1F;
+    uint8_t r8 = (r5 << 3) | (r5 >> 2);
+    uint8_t g8 = (g6 << 2) | (g6 >> 4);
+    uint8_t b8 = (b5 << 3) | (b5 >> 2);
+    return ((uint32_t)r8 << 16) | ((uint32_t)g8 << 8) | b8;
+}
+
+static bool set_text(display_state_t *s, const char *text, size_t len)
+{
+    if (len > CMD_FRAME_TEXT_MAX) {
+        // Do not split a UTF-8 sequence
+        len = CMD_FRAME_TEXT_MAX;
+        while (len > 0 && ((uint8_t)text[len] & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+    if (s->frame.text_len == len && memcmp(s->frame.text, text, len) == 0) {
+        return false;
+    }
+    memcpy(s->frame.text, text, len);
+    s->frame.text[len] = '\0';
+    s->frame.text_len = (uint8_t)len;
+    return true;
+}
+
+static bool set_asset(display_state_t *s, const cmd_frame_t *frame)
+{
+    if (!frame->asset_visible) {
+        return set_u8(&s->frame.asset_visible, 0);
+    }
+    if (s->frame.asset_visible && s->frame.asset_x == frame->asset_x && s->frame.asset_y == frame->asset_y &&
+        memcmp(s->frame.asset_key, frame->asset_key, CMD_FRAME_ASSET_KEY_LEN) == 0) {
+        return false;
+    }
+    s->frame.asset_visible = 1;
+    memcpy(s->frame.asset_key, frame->asset_key, CMD_FRAME_ASSET_KEY_LEN);
+    s->frame.asset_x = frame->asset_x;
+    s->frame.asset_y = frame->asset_y;
+    return true;
+}
+
+static bool apply_frame(display_state_t *s, const cmd_frame_t *frame)
+{
+    bool changed = false;
+    if (frame->fields & CMD_FIELD_BG) {
+        changed |= set_u32(&s->frame.bg_rgb888, frame->bg_rgb888);
+    }
+    if (frame->fields & CMD_FIELD_TEXT) {
+        changed |= set_text(s, frame->text, frame->text_len);
+    }
+    if (frame->fields & CMD_FIELD_TEXT_COLOR) {
+        changed |= set_u32(&s->frame.text_rgb888, frame->text_rgb888);
+    }
+    if (frame->fields & CMD_FIELD_FONT) {
+        changed |= set_u8(&s->frame.font_size, frame->font_size);
+    }
+    if (frame->fields & CMD_FIELD_BRIGHTNESS) {
+        changed |= set_u8(&s->frame.brightness, frame->brightness);
+    }
+    if (frame->fields & CMD_FIELD_ASSET) {
+        changed |= set_asset(s, frame);
+    }
+    return changed;
+}
+
+void display_state_init(display_state_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->frame.fields = ALL_FIELDS;
+    s->frame.bg_rgb888 = 0x000000;
+    s->frame.text_rgb888 = 0xFFFFFF;
+    s->frame.font_size = 24;
+    s->frame.brightness = 255;
+    set_text(s, "Ready", 5);
+}
+
+bool display_state_update(display_state_t *s, const display_cmd_t *cmd)
+{
+    switch (cmd->type) {
+    case DISPLAY_CMD_SET_BG_RGB565:
+        return set_u32(&s->frame.bg_rgb888, rgb565_to_rgb888(cmd->rgb565));
+    case DISPLAY_CMD_SET_BG_RGB888:
+        return set_u32(&s->frame.bg_rgb888, cmd->rgb888);
+    case DISPLAY_CMD_SET_TEXT:
+        return set_text(s, cmd->text.str, cmd->text.len);
+    case DISPLAY_CMD_SET_TEXT_REF:
+        return set_text(s, cmd->text_ref.str, cmd->text_ref.len);
+    case DISPLAY_CMD_APPLY_FRAME:
+        return apply_frame(s, &cmd->frame);
+    default:
+        return false;
+    }
+}
+
+size_t display_state_encode(const display_state_t *s, uint8_t *out, size_t max_len)
+{
+    return cmd_frame_encode(&s->frame, out, max_len);
+}
@@ -0,0 +1,42 @@
+/*
+ * Persistent display state
+ * What the screen shows (background, text, text color, font, brightness and
+ * stored asset), folded from the display commands as they are applied, so
+ * it can be saved and put back on the first frame after a power cycle.
+ *
+ * The state is a command frame with every field set, and it is saved as the
+ * encoded frame: restoring it is parsing and applying one ordinary command.
+ * Texts longer than CMD_FRAME_TEXT_MAX (long writes) are kept cut at a
+ * character boundary. The connection indicator is not part of the state;
+ * it always starts out disconnected.
+ *
+ * Portable C11, no ESP-IDF dependencies. Not thread safe.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cmd_frame.h"
+#include "display_cmd_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    cmd_frame_t frame;
+} display_state_t;
+
+// The scene as display_scene_create builds it
+void display_state_init(display_state_t *s);
+
+// Fold an applied command into the state; true when the state changed
+bool display_state_update(display_state_t *s, const display_cmd_t *cmd);
+
+// Encoded frame of the state, at most CMD_FRAME_ENCODED_MAX bytes; returns the length
+size_t display_state_encode(const display_state_t *s, uint8_t *out, size_t max_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Image codec (Q565), see image_codec.h
+ */
+
+#include <string.h>
+#include "image_codec.h"
+
+#define R5(px)  (((px) >> 11) & 0x1F)
+#define G6(px)  (((px) >> 5) & 0x3F)
+#define B5(px)  ((px) & 0x1F)
+#define HASH(px) ((R5(px) * 3 + G6(px) * 5 + B5(px) * 7) & 63)
+
+// Wrap a channel difference into the signed range of a bits-wide channel
+static inline int wrap_diff(int diff, int bits)
+{
+    int range = 1 << bits;
+    diff &= range - 1;
+    return diff >= range / 2 ? diff - range : diff;
+}
+
+// Half of a green difference (-32..31) as used by LUMA, rounded down
+static inline int half_dg(int dg)
+{
+    return (dg + 32) / 2 - 16;
+}
+
+void image_codec_decoder_init(image_codec_decoder_t *d, uint32_t pixels)
+{
+    memset(d, 0, sizeof(*d));
+    d->remaining = pixels;
+}
+
+bool image_codec_decoder_pending(const image_codec_decoder_t *d)
+{
+    return d->run > 0;
+}
+
+image_codec_status_t image_codec_decode(image_codec_decoder_t *d, const uint8_t **in, size_t *in_len,
+                                        uint8_t *out, size_t out_pixels, size_t *produced)
+{
+    const uint8_t *p = *in;
+    const uint8_t *end = p + *in_len;
+    size_t n = 0;
+    image_codec_status_t status = IMAGE_CODEC_OK;
+    uint16_t px = d->prev;
+
+    while (n < out_pixels) {
+        if (d->run > 0) {
+            // Runs are the bulk of UI content: emit as many as fit in one go
+            size_t count = d->run;
+            if (count > out_pixels - n) {
+                count = out_pixels - n;
+            }
+            for (size_t i = 0; i < count; i++) {
+                out[2 * (n + i)] = px >> 8;
+                out[2 * (n + i) + 1] = px & 0xFF;
+            }
+            n += count;
+            d->run -= count;
+            continue;
+        }
+        if (p == end) {
+            break;
+        }
+        if (d->remaining == 0) {
+            status = IMAGE_CODEC_ERR_TOO_LONG;
+            break;
+        }
+
+        uint8_t b = *p++;
+        if (d->need > 0) {
+            d->operand[d->have++] = b;
+            if (d->have < d->need) {
+                continue;
+            }
+            d->need = 0;
+            b = d->op;
+        } else if (b == IMAGE_CODEC_OP_PIXEL || (b & 0xC0) == IMAGE_CODEC_OP_LUMA) {
+            d->op = b;
+            d->have = 0;
+            d->need = (b == IMAGE_CODEC_OP_PIXEL) ? 2 : 1;
+            continue;
+        }
+
+        // Operand bytes complete, or a single byte op
+        if (b == IMAGE_CODEC_OP_PIXEL) {
+            px = (uint16_t)((d->operand[0] << 8) | d->operand[1]);
+        } else if (b == 0xFF) {
+            status = IMAGE_CODEC_ERR_CORRUPT;
+            break;
+        } else {
+            switch (b & 0xC0) {
+            case IMAGE_CODEC_OP_INDEX:
+                px = d->index[b];
+                break;
+            case IMAGE_CODEC_OP_DIFF: {
+                int r = (R5(px) + ((b >> 4) & 3) - 2) & 0x1F;
+                int g = (G6(px) + ((b >> 2) & 3) - 2) & 0x3F;
+                int bl = (B5(px) + (b & 3) - 2) & 0x1F;
+                px = (uint16_t)((r << 11) | (g << 5) | bl);
+                break;
+            }
+            case IMAGE_CODEC_OP_LUMA: {
+                int dg = (b & 0x3F) - 32;
+                int half = half_dg(dg);
+                int r = (R5(px) + half + (d->operand[0] >> 4) - 8) & 0x1F;
+                int g = (G6(px) + dg) & 0x3F;
+                int bl = (B5(px) + half + (d->operand[0] & 0x0F) - 8) & 0x1F;
+                px = (uint16_t)((r << 11) | (g << 5) | bl);
+                break;
+            }
+            default: {  // RUN: the first pixel is emitted below, the rest from the run counter
+                uint32_t run = (b & 0x3F) + 1;
+                if (run > d->remaining) {
+                    status = IMAGE_CODEC_ERR_CORRUPT;
+                    goto done;
+                }
+                d->remaining -= run;
+                d->run = (uint16_t)run;
+                continue;
+            }
+            }
+        }
+
+        d->index[HASH(px)] = px;
+        d->remaining--;
+        out[2 * n] = px >> 8;
+        out[2 * n + 1] = px & 0xFF;
+        n++;
+    }
+
+done:
+    d->prev = px;
+    *in_len = (size_t)(end - p);
+    *in = p;
+    *produced = n;
+    return status;
+}
+
+size_t image_codec_encode(const uint16_t *pixels, size_t count, uint8_t *out)
+{
+    uint16_t index[64] = {0};
+    uint16_t prev = 0;
+    size_t len = 0;
+    int run = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint16_t px = pixels[i];
+        if (px == prev) {
+            run++;
+            if (run == IMAGE_CODEC_RUN_MAX || i + 1 == count) {
+                out[len++] = IMAGE_CODEC_OP_RUN | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            out[len++] = IMAGE_CODEC_OP_RUN | (run - 1);
+            run = 0;
+        }
+
+        int h = HASH(px);
+        if (index[h] == px) {
+            out[len++] = IMAGE_CODEC_OP_INDEX | h;
+        } else {
+            index[h] = px;
+            int dr = wrap_diff(R5(px) - R5(prev), 5);
+            int dg = wrap_diff(G6(px) - G6(prev), 6);
+            int db = wrap_diff(B5(px) - B5(prev), 5);
+            int half = half_dg(dg);
+            int dr_dg = dr - half;
+            int db_dg = db - half;
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                out[len++] = IMAGE_CODEC_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+            } else if (dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                out[len++] = IMAGE_CODEC_OP_LUMA | (dg + 32);
+                out[len++] = (uint8_t)(((dr_dg + 8) << 4) | (db_dg + 8));
+            } else {
+                out[len++] = IMAGE_CODEC_OP_PIXEL;
+                out[len++] = px >> 8;
+                out[len++] = px & 0xFF;
+            }
+        }
+        prev = px;
+    }
+    return len;
+}
+
+const char *image_codec_status_str(image_codec_status_t status)
+{
+    switch (status) {
+    case IMAGE_CODEC_OK:           return "ok";
+    case IMAGE_CODEC_ERR_CORRUPT:  return "corrupt";
+    case IMAGE_CODEC_ERR_TOO_LONG: return "too long";
+    default:                       return "?";
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Image codec (Q565)
+ * Lossless QOI-style compression for RGB565 pixels. Every pixel is coded
+ * relative to the previous one, with a 64-entry table of recently seen
+ * colors:
+ *
+ *   00iiiiii            INDEX  color table entry i
+ *   01rrggbb            DIFF   r, g, b each differ by -2..1 from the previous pixel (bias 2)
+ *   10gggggg rrrrbbbb   LUMA   g differs by -32..31 (bias 32); r and b differ by half of
+ *                              that, plus -8..7 (bias 8)
+ *   11nnnnnn            RUN    previous pixel repeated n + 1 times (1..62)
+ *   0xFE hi lo          PIXEL  literal RGB565, big-endian
+ *   0xFF                       reserved
+ *
+ * Channel differences wrap (5-bit red and blue, 6-bit green). The color
+ * table slot of a pixel is (r * 3 + g * 5 + b * 7) & 63, and the first
+ * pixel is coded against black. The stream carries no header; the pixel
+ * count comes from the image window.
+ *
+ * The decoder is incremental: input may be split at any byte and output
+ * is written in panel (big-endian) order into whatever room the caller
+ * has, so it can feed DMA buffers directly. Its state is a few hundred
+ * bytes and it never needs a framebuffer.
+ *
+ * Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_CODEC_OP_INDEX  0x00
+#define IMAGE_CODEC_OP_DIFF   0x40
+#define IMAGE_CODEC_OP_LUMA   0x80
+#define IMAGE_CODEC_OP_RUN    0xC0
+#define IMAGE_CODEC_OP_PIXEL  0xFE
+#define IMAGE_CODEC_RUN_MAX   62
+
+// Worst case encoded size: every pixel a literal
+#define IMAGE_CODEC_MAX_ENCODED(pixels) ((size_t)(pixels) * 3)
+
+typedef enum {
+    IMAGE_CODEC_OK = 0,
+    IMAGE_CODEC_ERR_CORRUPT,   // reserved opcode, or a run past the end of the image
+    IMAGE_CODEC_ERR_TOO_LONG,  // input left after the last pixel
+} image_codec_status_t;
+
+typedef struct {
+    uint16_t index[64];   // native RGB565
+    uint16_t prev;
+    uint16_t run;         // pixels of the current run still to emit
+    uint8_t op;           // opcode waiting for operand bytes
+    uint8_t operand[2];
+    uint8_t have;         // operand bytes received
+    uint8_t need;         // operand bytes expected
+    uint32_t remaining;   // pixels still to decode
+} image_codec_decoder_t;
+
+void image_codec_decoder_init(image_codec_decoder_t *d, uint32_t pixels);
+
+// Decode from *in (advanced past consumed bytes) into out, at most out_pixels pixels in panel
+// byte order. Returns with *produced < out_pixels once the input is exhausted.
+image_codec_status_t image_codec_decode(image_codec_decoder_t *d, const uint8_t **in, size_t *in_len,
+                                        uint8_t *out, size_t out_pixels, size_t *produced);
+
+// Output is still owed without further input (inside a run)
+bool image_codec_decoder_pending(const image_codec_decoder_t *d);
+
+// Reference encoder for native RGB565 pixels; out must hold IMAGE_CODEC_MAX_ENCODED(count) bytes.
+// Returns the encoded length.
+size_t image_codec_encode(const uint16_t *pixels, size_t count, uint8_t *out);
+
+const char *image_codec_status_str(image_codec_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,202 @@
+/*
+ * Image stream
+ * Row-aligned DMA slot ring for windowed RGB565 pixel data, see image_stream.h
+ */
+
+#include <string.h>
+#include "image_stream.h"
+
+#define SLOT_MASK (IMAGE_STREAM_SLOTS - 1)
+
+_Static_assert((IMAGE_STREAM_SLOTS & SLOT_MASK) == 0, "IMAGE_STREAM_SLOTS must be a power of two");
+
+void image_stream_init(image_stream_t *s, uint8_t *const bufs[IMAGE_STREAM_SLOTS], size_t slot_capacity,
+                       uint16_t screen_w, uint16_t screen_h)
+{
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < IMAGE_STREAM_SLOTS; i++) {
+        s->slots[i].buf = bufs[i];
+    }
+    s->slot_capacity = slot_capacity;
+    s->screen_w = screen_w;
+    s->screen_h = screen_h;
+    atomic_init(&s->head, 0);
+    atomic_init(&s->tail, 0);
+    atomic_init(&s->image_id, 0);
+}
+
+// Bytes in the slot that starts at window row fill_row (the last slot may hold fewer rows)
+static size_t slot_bytes_at(const image_stream_t *s, uint16_t fill_row)
+{
+    uint16_t rows = s->h - fill_row;
+    if (rows > s->rows_per_slot) {
+        rows = s->rows_per_slot;
+    }
+    return (size_t)rows * s->row_bytes;
+}
+
+static void close_window(image_stream_t *s)
+{
+    if (s->open && s->received < s->total) {
+        s->stats.images_aborted++;
+    }
+    s->open = false;
+    s->fill = 0;
+}
+
+image_stream_status_t image_stream_open(image_stream_t *s, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                                        uint16_t *image_id, uint32_t *limit)
+{
+    size_t row_bytes = (size_t)w * IMAGE_STREAM_BPP;
+    if (w == 0 || h == 0 || (uint32_t)x + w > s->screen_w || (uint32_t)y + h > s->screen_h ||
+        row_bytes > s->slot_capacity) {
+        return IMAGE_STREAM_ERR_GEOMETRY;
+    }
+    if (atomic_load_explicit(&s->head, memory_order_relaxed) != atomic_load_explicit(&s->tail, memory_order_acquire)) {
+        return IMAGE_STREAM_ERR_BUSY;
+    }
+
+    close_window(s);
+    s->x = x;
+    s->y = y;
+    s->w = w;
+    s->h = h;
+    s->row_bytes = row_bytes;
+    s->rows_per_slot = s->slot_capacity / row_bytes;
+    s->total = (uint32_t)row_bytes * h;
+    s->received = 0;
+    s->fill_row = 0;
+    s->window = (uint32_t)(IMAGE_STREAM_SLOTS * s->rows_per_slot * row_bytes);
+    s->open = true;
+    s->stats.images_opened++;
+
+    *image_id = (uint16_t)(atomic_fetch_add_explicit(&s->image_id, 1, memory_order_relaxed) + 1);
+    *limit = s->window < s->total ? s->window : s->total;
+    return IMAGE_STREAM_OK;
+}
+
+image_stream_status_t image_stream_append(image_stream_t *s, const uint8_t *data, size_t len)
+{
+    if (!s->open) {
+        s->stats.rejected_writes++;
+        return IMAGE_STREAM_ERR_NOT_OPEN;
+    }
+    if (s->received + len > s->total) {
+        s->stats.rejected_writes++;
+        return IMAGE_STREAM_ERR_TOO_LONG;
+    }
+
+    // Reject the whole write up front rather than applying part of it
+    uint32_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+    uint32_t used = head - atomic_load_explicit(&s->tail, memory_order_acquire) + (s->fill > 0 ? 1 : 0);
+    size_t avail = (IMAGE_STREAM_SLOTS - used) * s->rows_per_slot * s->row_bytes;
+    if (s->fill > 0) {
+        avail += slot_bytes_at(s, s->fill_row) - s->fill;
+    }
+    if (len > avail) {
+        s->stats.rejected_writes++;
+        return IMAGE_STREAM_ERR_OVERRUN;
+    }
+
+    while (len > 0) {
+        size_t space;
+        uint8_t *dst = image_stream_fill_ptr(s, &space);
+        size_t n = space < len ? space : len;
+        memcpy(dst, data, n);
+        image_stream_fill_commit(s, n);
+        data += n;
+        len -= n;
+    }
+    return IMAGE_STREAM_OK;
+}
+
+uint8_t *image_stream_fill_ptr(image_stream_t *s, size_t *space)
+{
+    if (!s->open) {
+        return NULL;
+    }
+    uint32_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+    if (s->fill == 0 && head - atomic_load_explicit(&s->tail, memory_order_acquire) >= IMAGE_STREAM_SLOTS) {
+        return NULL;
+    }
+    *space = slot_bytes_at(s, s->fill_row) - s->fill;
+    return s->slots[head & SLOT_MASK].buf + s->fill;
+}
+
+void image_stream_fill_commit(image_stream_t *s, size_t n)
+{
+    size_t slot_bytes = slot_bytes_at(s, s->fill_row);
+    s->fill += n;
+    s->received += n;
+
+    if (s->fill == slot_bytes) {
+        uint32_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+        image_slot_t *slot = &s->slots[head & SLOT_MASK];
+        slot->image_id = image_stream_current_id(s);
+        slot->x = s->x;
+        slot->y = s->y + s->fill_row;
+        slot->w = s->w;
+        slot->rows = slot_bytes / s->row_bytes;
+        slot->end_offset = s->received;
+        slot->limit = s->received + s->window < s->total ? s->received + s->window : s->total;
+        slot->last = (s->received == s->total);
+
+        // Release publishes the pixels and metadata before the new head becomes visible
+        atomic_store_explicit(&s->head, head + 1, memory_order_release);
+        s->fill_row += slot->rows;
+        s->fill = 0;
+    }
+
+    if (s->received == s->total) {
+        s->stats.images_completed++;
+        s->open = false;
+    }
+}
+
+void image_stream_abort(image_stream_t *s)
+{
+    close_window(s);
+    atomic_fetch_add_explicit(&s->image_id, 1, memory_order_relaxed);
+}
+
+uint32_t image_stream_ready(image_stream_t *s)
+{
+    uint32_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    return atomic_load_explicit(&s->head, memory_order_acquire) - tail;
+}
+
+const image_slot_t *image_stream_slot(image_stream_t *s, uint32_t i)
+{
+    uint32_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    return &s->slots[(tail + i) & SLOT_MASK];
+}
+
+bool image_stream_slot_is_current(image_stream_t *s, const image_slot_t *slot)
+{
+    return slot->image_id == image_stream_current_id(s);
+}
+
+void image_stream_release(image_stream_t *s, uint32_t n)
+{
+    uint32_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    // Release hands the slot buffers back only after the consumer is done with them
+    atomic_store_explicit(&s->tail, tail + n, memory_order_release);
+}
+
+uint16_t image_stream_current_id(image_stream_t *s)
+{
+    return (uint16_t)atomic_load_explicit(&s->image_id, memory_order_relaxed);
+}
+
+const char *image_stream_status_str(image_stream_status_t status)
+{
+    switch (status) {
+    case IMAGE_STREAM_OK:           return "ok";
+    case IMAGE_STREAM_ERR_GEOMETRY: return "bad window";
+    case IMAGE_STREAM_ERR_BUSY:     return "previous image still drawing";
+    case IMAGE_STREAM_ERR_NOT_OPEN: return "no open window";
+    case IMAGE_STREAM_ERR_OVERRUN:  return "overrun";
+    case IMAGE_STREAM_ERR_TOO_LONG: return "too long";
+    default:                        return "?";
+    }
+}
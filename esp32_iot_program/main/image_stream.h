@@ -0,0 +1,113 @@
+/*
+ * Image stream
+ * RGB565 pixels for a screen window arrive in arbitrary chunks and are
+ * packed into a small ring of DMA-capable slots, each holding whole rows of
+ * the window, so every slot can be sent to the panel with one bitmap draw.
+ * No framebuffer is involved.
+ *
+ * The producer (Bluedroid callback context) opens windows and appends
+ * pixel data; the consumer (lvgl_task) draws published slots and releases
+ * them once the transfer is done. Flow control is a cumulative byte limit:
+ * the client may send while bytes sent < limit, and the limit grows as
+ * slots are drawn, so a compliant client never finds the ring full.
+ *
+ * Aborting a window starts a new image id; slots of the aborted image still
+ * in the ring are skipped instead of drawn. A window can only be opened
+ * once the ring has drained, so the initial limit is always the full ring.
+ *
+ * Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_STREAM_SLOTS  4   // must be a power of two
+#define IMAGE_STREAM_BPP    2   // RGB565
+
+typedef enum {
+    IMAGE_STREAM_OK = 0,
+    IMAGE_STREAM_ERR_GEOMETRY,  // window empty, off screen or a row larger than a slot
+    IMAGE_STREAM_ERR_BUSY,      // slots of an earlier image are still waiting to be drawn
+    IMAGE_STREAM_ERR_NOT_OPEN,  // pixel data without an open window
+    IMAGE_STREAM_ERR_OVERRUN,   // no free slot, the client ignored its limit
+    IMAGE_STREAM_ERR_TOO_LONG,  // more pixel data than the window holds
+} image_stream_status_t;
+
+typedef struct {
+    uint8_t *buf;         // DMA-capable, owned by the caller of image_stream_init
+    uint16_t image_id;
+    uint16_t x;
+    uint16_t y;           // first row of this slot on screen
+    uint16_t w;
+    uint16_t rows;
+    uint32_t end_offset;  // image bytes up to and including this slot
+    uint32_t limit;       // client byte limit once this slot is drawn
+    bool last;            // final slot of the image
+} image_slot_t;
+
+typedef struct {
+    uint32_t images_opened;
+    uint32_t images_completed;  // all pixel data received
+    uint32_t images_aborted;    // replaced or aborted before all data arrived
+    uint32_t rejected_writes;   // NOT_OPEN, OVERRUN or TOO_LONG
+} image_stream_stats_t;
+
+typedef struct {
+    image_slot_t slots[IMAGE_STREAM_SLOTS];
+    size_t slot_capacity;       // bytes per slot buffer
+    uint16_t screen_w;
+    uint16_t screen_h;
+    _Atomic uint32_t head;      // slots published, owned by the producer
+    _Atomic uint32_t tail;      // slots released, owned by the consumer
+    _Atomic uint32_t image_id;  // current image, bumped by open and abort
+    // Producer state for the current window
+    bool open;
+    uint16_t x, y, w, h;
+    uint16_t rows_per_slot;
+    size_t row_bytes;
+    uint32_t total;             // bytes in the window
+    uint32_t received;          // bytes appended so far
+    uint32_t window;            // bytes the client may have in flight beyond the drawn ones
+    size_t fill;                // bytes in the slot being filled
+    uint16_t fill_row;          // first window row of the slot being filled
+    image_stream_stats_t stats; // producer-owned
+} image_stream_t;
+
+// bufs holds IMAGE_STREAM_SLOTS buffers of slot_capacity bytes each
+void image_stream_init(image_stream_t *s, uint8_t *const bufs[IMAGE_STREAM_SLOTS], size_t slot_capacity,
+                       uint16_t screen_w, uint16_t screen_h);
+
+// Producer side. open replaces any window in progress and returns the new image id and the
+// initial byte limit. Once a slot is drawn the limit becomes slot->limit.
+image_stream_status_t image_stream_open(image_stream_t *s, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                                        uint16_t *image_id, uint32_t *limit);
+image_stream_status_t image_stream_append(image_stream_t *s, const uint8_t *data, size_t len);
+
+// Producer side for writers that generate pixels in place (decoders): contiguous room in the
+// slot being filled, NULL when no window is open or the ring is full, then commit what was written.
+uint8_t *image_stream_fill_ptr(image_stream_t *s, size_t *space);
+void image_stream_fill_commit(image_stream_t *s, size_t n);
+void image_stream_abort(image_stream_t *s);
+
+// Consumer side: published slots waiting to be drawn, the i-th oldest of them,
+// and release of the n oldest once their transfers are done.
+uint32_t image_stream_ready(image_stream_t *s);
+const image_slot_t *image_stream_slot(image_stream_t *s, uint32_t i);
+bool image_stream_slot_is_current(image_stream_t *s, const image_slot_t *slot);
+void image_stream_release(image_stream_t *s, uint32_t n);
+
+uint16_t image_stream_current_id(image_stream_t *s);
+
+const char *image_stream_status_str(image_stream_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,143 @@
+/*
+ * Rendered label cache, see label_cache.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "label_cache.h"
+
+static uint32_t key_hash(const char *text, size_t len, uint32_t style)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    for (int i = 0; i < 4; i++) {
+        hash = (hash ^ ((style >> (8 * i)) & 0xFF)) * 16777619u;
+    }
+    // 0 marks a free entry
+    return hash != 0 ? hash : 1;
+}
+
+static void entry_free(label_cache_t *cache, label_cache_entry_t *entry)
+{
+    cache->bytes_used -= entry->size;
+    free(entry->pixels);
+    memset(entry, 0, sizeof(*entry));
+}
+
+void label_cache_init(label_cache_t *cache, uint32_t budget)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->budget = budget;
+}
+
+void label_cache_clear(label_cache_t *cache)
+{
+    for (int i = 0; i < LABEL_CACHE_ENTRIES; i++) {
+        if (cache->entries[i].hash != 0) {
+            entry_free(cache, &cache->entries[i]);
+        }
+    }
+}
+
+const label_cache_entry_t *label_cache_get(label_cache_t *cache, const char *text, size_t len, uint32_t style)
+{
+    if (len <= LABEL_CACHE_TEXT_MAX && cache->budget > 0) {
+        uint32_t hash = key_hash(text, len, style);
+        for (int i = 0; i < LABEL_CACHE_ENTRIES; i++) {
+            label_cache_entry_t *entry = &cache->entries[i];
+            if (entry->hash == hash && entry->style == style && entry->text_len == len &&
+                memcmp(entry->text, text, len) == 0) {
+                entry->last_used = ++cache->clock;
+                cache->hits++;
+                return entry;
+            }
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+label_cache_entry_t *label_cache_insert(label_cache_t *cache, const char *text, size_t len, uint32_t style,
+                                        uint32_t size)
+{
+    if (len > LABEL_CACHE_TEXT_MAX || size == 0 || size > cache->budget) {
+        cache->rejected++;
+        return NULL;
+    }
+
+    // Evict least recently used entries until the rendering fits and a slot is free
+    label_cache_entry_t *slot = NULL;
+    for (;;) {
+        label_cache_entry_t *lru = NULL;
+        slot = NULL;
+        for (int i = 0; i < LABEL_CACHE_ENTRIES; i++) {
+            label_cache_entry_t *entry = &cache->entries[i];
+            if (entry->hash == 0) {
+                slot = slot != NULL ? slot : entry;
+            } else if (lru == NULL || entry->last_used < lru->last_used) {
+                lru = entry;
+            }
+        }
+        if (slot != NULL && cache->bytes_used + size <= cache->budget) {
+            break;
+        }
+        entry_free(cache, lru);
+        cache->evictions++;
+    }
+
+    slot->pixels = malloc(size);
+    if (slot->pixels == NULL) {
+        cache->rejected++;
+        return NULL;
+    }
+    slot->hash = key_hash(text, len, style);
+    slot->style = style;
+    slot->text_len = (uint16_t)len;
+    memcpy(slot->text, text, len);
+    slot->size = size;
+    slot->last_used = ++cache->clock;
+    cache->bytes_used += size;
+    return slot;
+}
+
+void label_cache_drop(label_cache_t *cache, label_cache_entry_t *entry)
+{
+    entry_free(cache, entry);
+}
+
+void label_cache_get_stats(const label_cache_t *cache, label_cache_stats_t *stats)
+{
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->rejected = cache->rejected;
+    stats->entries = 0;
+    for (int i = 0; i < LABEL_CACHE_ENTRIES; i++) {
+        if (cache->entries[i].hash != 0) {
+            stats->entries++;
+        }
+    }
+    stats->bytes_used = cache->bytes_used;
+    stats->budget = cache->budget;
+}
+
+static uint8_t *put_le(uint8_t *out, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        *out++ = (value >> (8 * i)) & 0xFF;
+    }
+    return out;
+}
+
+size_t label_cache_stats_encode(const label_cache_stats_t *stats, uint8_t *out)
+{
+    uint8_t *p = out;
+    p = put_le(p, stats->hits, 4);
+    p = put_le(p, stats->misses, 4);
+    p = put_le(p, stats->evictions, 4);
+    p = put_le(p, stats->entries, 2);
+    p = put_le(p, (stats->bytes_used + 1023) / 1024, 2);
+    return (size_t)(p - out);
+}
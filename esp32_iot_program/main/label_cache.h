@@ -0,0 +1,85 @@
+/*
+ * Rendered label cache
+ * LRU cache of pre-rendered text bitmaps keyed by (text, style), where the
+ * style packs whatever changes the rendering (font size, text color). The
+ * pixel buffers are allocated with malloc and bounded by a byte budget;
+ * the least recently used entries are evicted to make room.
+ *
+ * The cache only stores bytes. Rendering into an entry and showing it are
+ * up to the caller, which must not keep using an entry's pixels after the
+ * next insert.
+ *
+ * Portable C11, no ESP-IDF dependencies. Not thread safe.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LABEL_CACHE_ENTRIES   16
+#define LABEL_CACHE_TEXT_MAX  128  // longer texts are not cached
+#define LABEL_CACHE_REPORT_LEN 16  // label_cache_stats_encode
+
+typedef struct {
+    uint32_t hash;       // FNV-1a of text and style, 0 for a free entry
+    uint32_t style;
+    uint16_t text_len;
+    char text[LABEL_CACHE_TEXT_MAX];
+    uint16_t width;
+    uint16_t height;
+    uint32_t size;       // bytes at pixels
+    uint8_t *pixels;
+    uint32_t last_used;  // cache clock at the last hit or insert
+} label_cache_entry_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t rejected;    // inserts larger than the budget or failed allocations
+    uint32_t entries;
+    uint32_t bytes_used;
+    uint32_t budget;
+} label_cache_stats_t;
+
+typedef struct {
+    label_cache_entry_t entries[LABEL_CACHE_ENTRIES];
+    uint32_t budget;
+    uint32_t bytes_used;
+    uint32_t clock;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t rejected;
+} label_cache_t;
+
+// A budget of 0 disables the cache: lookups always miss and inserts are rejected
+void label_cache_init(label_cache_t *cache, uint32_t budget);
+
+// Free all pixel buffers
+void label_cache_clear(label_cache_t *cache);
+
+// Look up a rendering; counts a hit or a miss. Texts longer than LABEL_CACHE_TEXT_MAX always miss.
+const label_cache_entry_t *label_cache_get(label_cache_t *cache, const char *text, size_t len, uint32_t style);
+
+// Make room for a rendering of size bytes, evicting least recently used entries, and return
+// the new entry for the caller to fill: entry->pixels, width and height. NULL when it cannot be cached.
+label_cache_entry_t *label_cache_insert(label_cache_t *cache, const char *text, size_t len, uint32_t style,
+                                        uint32_t size);
+
+// Drop an entry returned by label_cache_insert whose rendering failed
+void label_cache_drop(label_cache_t *cache, label_cache_entry_t *entry);
+
+void label_cache_get_stats(const label_cache_t *cache, label_cache_stats_t *stats);
+
+// uint32 hits, misses, evictions, uint16 entries, uint16 KB used, little-endian (LABEL_CACHE_REPORT_LEN bytes)
+size_t label_cache_stats_encode(const label_cache_stats_t *stats, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
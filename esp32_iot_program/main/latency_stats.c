@@ -0,0 +1,129 @@
+/*
+ * Latency statistics, see latency_stats.h
+ */
+
+#include <string.h>
+#include "latency_stats.h"
+
+#define SUB_BUCKETS (1u << LATENCY_SUB_BITS)
+
+_Static_assert(LATENCY_OVERFLOW_US == (2 * SUB_BUCKETS - 1u) << (LATENCY_BUCKETS / SUB_BUCKETS - 2),
+               "LATENCY_OVERFLOW_US must be the lower bound of the last bucket");
+
+static unsigned bucket_index(uint32_t us)
+{
+    if (us >= LATENCY_OVERFLOW_US) {
+        return LATENCY_BUCKETS - 1;
+    }
+    if (us < SUB_BUCKETS) {
+        return us;
+    }
+    unsigned exp = 0;
+    while ((us >> exp) >= 2 * SUB_BUCKETS) {
+        exp++;
+    }
+    // us is now (SUB_BUCKETS + sub) << exp
+    return (exp + 1) * SUB_BUCKETS + ((us >> exp) - SUB_BUCKETS);
+}
+
+static uint32_t bucket_upper(unsigned index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    unsigned exp = index / SUB_BUCKETS - 1;
+    unsigned sub = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << exp) - 1;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t to_units(uint32_t us)
+{
+    uint32_t units = (us + LATENCY_REPORT_UNIT_US - 1) / LATENCY_REPORT_UNIT_US;
+    return units > 0xFFFF ? 0xFFFF : (uint16_t)units;
+}
+
+void latency_stats_init(latency_stats_t *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void latency_hist_add(latency_hist_t *h, uint32_t us)
+{
+    h->buckets[bucket_index(us)]++;
+    h->count++;
+}
+
+void latency_stats_add(latency_stats_t *s, unsigned type, latency_stage_t stage, uint32_t us)
+{
+    if (type < LATENCY_TYPES && stage < LATENCY_STAGE_NUM) {
+        latency_hist_add(&s->hist[type][stage], us);
+    }
+}
+
+uint32_t latency_hist_percentile(const latency_hist_t *h, uint32_t per_mille)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+    // Rank of the sample at the quantile, rounded up so p99 of 10 samples is the largest
+    uint64_t rank = ((uint64_t)h->count * per_mille + 999) / 1000;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            // The overflow bucket has no upper bound
+            return i == LATENCY_BUCKETS - 1 ? UINT32_MAX : bucket_upper(i);
+        }
+    }
+    return UINT32_MAX;
+}
+
+size_t latency_stats_encode(const latency_stats_t *s, uint32_t stage_mask, uint8_t *out, size_t out_max)
+{
+    if (out_max < LATENCY_REPORT_HEADER) {
+        return 0;
+    }
+    size_t len = LATENCY_REPORT_HEADER;
+    uint16_t entries = 0;
+    for (unsigned type = 0; type < LATENCY_TYPES; type++) {
+        for (unsigned stage = 0; stage < LATENCY_STAGE_NUM; stage++) {
+            const latency_hist_t *h = &s->hist[type][stage];
+            if (!(stage_mask & (1u << stage)) || h->count == 0) {
+                continue;
+            }
+            if (len + LATENCY_REPORT_ENTRY > out_max) {
+                goto done;
+            }
+            uint8_t *p = out + len;
+            p[0] = (uint8_t)type;
+            p[1] = (uint8_t)stage;
+            put_u32(p + 2, h->count);
+            put_u16(p + 6, to_units(latency_hist_percentile(h, 500)));
+            put_u16(p + 8, to_units(latency_hist_percentile(h, 950)));
+            put_u16(p + 10, to_units(latency_hist_percentile(h, 990)));
+            len += LATENCY_REPORT_ENTRY;
+            entries++;
+        }
+    }
+done:
+    out[0] = 1;
+    out[1] = LATENCY_REPORT_UNIT_US;
+    put_u16(out + 2, entries);
+    return len;
+}
@@ -0,0 +1,77 @@
+/*
+ * Latency statistics
+ * Fixed-bucket latency histograms per command type and pipeline stage, and
+ * the compact binary report served by the stats characteristic.
+ *
+ * Buckets are log-linear: four per power of two, so every bucket is at
+ * most 25% wide relative to its lower bound. Values of 0-3 us get a
+ * bucket each, and the last bucket is open-ended from LATENCY_OVERFLOW_US.
+ * Percentiles report the upper bound of the bucket they fall in, or the
+ * saturated maximum for the last bucket.
+ *
+ * Report layout (little-endian):
+ *   header: uint8 version (1), uint8 unit (us per count, 10),
+ *           uint16 entry count
+ *   entry:  uint8 command type, uint8 stage, uint32 samples,
+ *           uint16 p50, uint16 p95, uint16 p99 (in units, saturated)
+ * Only (type, stage) pairs with samples are included.
+ *
+ * Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_SUB_BITS        2
+#define LATENCY_BUCKETS         64
+#define LATENCY_OVERFLOW_US     114688u  // lower bound of the open-ended last bucket, about 115 ms
+#define LATENCY_TYPES           6        // command types tracked, indexed by display_cmd_type_t
+#define LATENCY_REPORT_UNIT_US  10
+#define LATENCY_REPORT_HEADER   4
+#define LATENCY_REPORT_ENTRY    12
+#define LATENCY_REPORT_MAX      (LATENCY_REPORT_HEADER + LATENCY_TYPES * LATENCY_STAGE_NUM * LATENCY_REPORT_ENTRY)
+
+// Intervals between the timestamps taken for each command
+typedef enum {
+    LATENCY_STAGE_PARSE,   // write received -> command enqueued
+    LATENCY_STAGE_WAIT,    // enqueued -> render start (queue, apply, frame budget)
+    LATENCY_STAGE_RENDER,  // render start -> first flush start
+    LATENCY_STAGE_FLUSH,   // first flush start -> last flush done
+    LATENCY_STAGE_TOTAL,   // write received -> pixels on the panel
+    LATENCY_STAGE_NUM,
+} latency_stage_t;
+
+#define LATENCY_STAGE_MASK_ALL ((1u << LATENCY_STAGE_NUM) - 1)
+
+typedef struct {
+    uint32_t count;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+typedef struct {
+    latency_hist_t hist[LATENCY_TYPES][LATENCY_STAGE_NUM];
+} latency_stats_t;
+
+void latency_stats_init(latency_stats_t *s);
+
+// Record one sample; types outside LATENCY_TYPES are ignored
+void latency_stats_add(latency_stats_t *s, unsigned type, latency_stage_t stage, uint32_t us);
+
+void latency_hist_add(latency_hist_t *h, uint32_t us);
+
+// Upper bound in us of the bucket holding the given quantile (per mille, 500 = median), 0 when empty
+uint32_t latency_hist_percentile(const latency_hist_t *h, uint32_t per_mille);
+
+// Encode the entries for the stages in stage_mask into out, stopping before out_max would be exceeded.
+// Returns the report length.
+size_t latency_stats_encode(const latency_stats_t *s, uint32_t stage_mask, uint8_t *out, size_t out_max);
+
+#ifdef __cplusplus
+}
+#endif
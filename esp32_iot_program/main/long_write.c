@@ -0,0 +1,128 @@
+/*
+ * Long (prepared) write reassembly, see long_write.h
+ */
+
+#include <string.h>
+#include "long_write.h"
+
+void long_write_init(long_write_t *lw, uint8_t *buf, size_t capacity)
+{
+    memset(lw, 0, sizeof(*lw));
+    lw->buf = buf;
+    lw->capacity = capacity;
+    atomic_init(&lw->locked, false);
+}
+
+// The whole payload is void once a fragment is rejected: keep the handle so the payload stays
+// in progress until finish or cancel, which report or drop the error
+static long_write_status_t long_write_void(long_write_t *lw, uint16_t handle, long_write_status_t error)
+{
+    lw->handle = handle;
+    lw->len = 0;
+    lw->error = error;
+    return error;
+}
+
+long_write_status_t long_write_append(long_write_t *lw, uint16_t handle, uint16_t offset,
+                                      const uint8_t *data, uint16_t len)
+{
+    if (atomic_load_explicit(&lw->locked, memory_order_acquire)) {
+        lw->stats.rejected_busy++;
+        return LONG_WRITE_ERR_BUSY;
+    }
+    if (lw->handle != 0 && lw->handle != handle) {
+        return LONG_WRITE_ERR_HANDLE;
+    }
+    if (lw->error != LONG_WRITE_OK) {
+        return lw->error;
+    }
+    if (offset > lw->len) {
+        lw->stats.rejected_offset++;
+        return long_write_void(lw, handle, LONG_WRITE_ERR_OFFSET);
+    }
+    if ((size_t)offset + len > lw->capacity) {
+        lw->stats.rejected_overflow++;
+        return long_write_void(lw, handle, LONG_WRITE_ERR_OVERFLOW);
+    }
+
+    memcpy(&lw->buf[offset], data, len);
+    lw->handle = handle;
+    if ((size_t)offset + len > lw->len) {
+        lw->len = (size_t)offset + len;
+    }
+    return LONG_WRITE_OK;
+}
+
+long_write_status_t long_write_finish(long_write_t *lw, uint16_t *handle, const uint8_t **data, size_t *len)
+{
+    if (lw->handle == 0) {
+        return LONG_WRITE_ERR_EMPTY;
+    }
+    if (lw->error != LONG_WRITE_OK) {
+        long_write_status_t error = lw->error;
+        lw->handle = 0;
+        lw->error = LONG_WRITE_OK;
+        return error;
+    }
+
+    lw->buf[lw->len] = '\0';
+    *handle = lw->handle;
+    *data = lw->buf;
+    *len = lw->len;
+
+    lw->stats.completed++;
+    lw->stats.bytes += lw->len;
+    lw->handle = 0;
+    lw->len = 0;
+    atomic_store_explicit(&lw->locked, true, memory_order_release);
+    return LONG_WRITE_OK;
+}
+
+void long_write_cancel(long_write_t *lw)
+{
+    if (lw->handle != 0) {
+        lw->stats.cancelled++;
+    }
+    lw->handle = 0;
+    lw->len = 0;
+    lw->error = LONG_WRITE_OK;
+}
+
+long_write_status_t long_write_store(long_write_t *lw, const uint8_t *data, size_t len, const uint8_t **out)
+{
+    if (atomic_load_explicit(&lw->locked, memory_order_acquire) || lw->handle != 0) {
+        lw->stats.rejected_busy++;
+        return LONG_WRITE_ERR_BUSY;
+    }
+    if (len > lw->capacity) {
+        lw->stats.rejected_overflow++;
+        return LONG_WRITE_ERR_OVERFLOW;
+    }
+
+    memcpy(lw->buf, data, len);
+    lw->buf[len] = '\0';
+    *out = lw->buf;
+
+    lw->stats.completed++;
+    lw->stats.bytes += len;
+    atomic_store_explicit(&lw->locked, true, memory_order_release);
+    return LONG_WRITE_OK;
+}
+
+void long_write_release(long_write_t *lw)
+{
+    atomic_store_explicit(&lw->locked, false, memory_order_release);
+}
+
+const char *long_write_status_str(long_write_status_t status)
+{
+    switch (status) {
+    case LONG_WRITE_OK:           return "ok";
+    case LONG_WRITE_ERR_BUSY:     return "busy";
+    case LONG_WRITE_ERR_HANDLE:   return "interleaved handle";
+    case LONG_WRITE_ERR_OFFSET:   return "invalid offset";
+    case LONG_WRITE_ERR_OVERFLOW: return "overflow";
+    case LONG_WRITE_ERR_EMPTY:    return "nothing prepared";
+    default:                      return "?";
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Long (prepared) write reassembly
+ * ATT prepare-write fragments are copied once into a preallocated, bounded
+ * arena. On execute the reassembled payload is handed to its consumer by
+ * reference; the arena stays locked until the consumer releases it, and
+ * fragments arriving in the meantime are rejected as busy. A fragment
+ * rejected for its offset or size voids the whole payload: the rest of its
+ * fragments are rejected the same way and finish reports the error.
+ *
+ * Producer (append/finish/cancel) and consumer (release) may run in
+ * different tasks. Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    LONG_WRITE_OK = 0,
+    LONG_WRITE_ERR_BUSY,      // previous payload not released yet
+    LONG_WRITE_ERR_HANDLE,    // fragment for a different attribute than the one in progress
+    LONG_WRITE_ERR_OFFSET,    // fragment offset past the end of the data received so far
+    LONG_WRITE_ERR_OVERFLOW,  // payload would not fit in the arena
+    LONG_WRITE_ERR_EMPTY,     // execute without any prepared data
+} long_write_status_t;
+
+typedef struct {
+    uint32_t completed;         // payloads handed to a consumer
+    uint32_t bytes;             // bytes in completed payloads
+    uint32_t rejected_busy;
+    uint32_t rejected_offset;
+    uint32_t rejected_overflow;
+    uint32_t cancelled;
+} long_write_stats_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t capacity;         // usable bytes; buf holds one more for a NUL terminator
+    size_t len;
+    uint16_t handle;         // attribute being reassembled, 0 when idle
+    long_write_status_t error;  // why the payload in progress was voided, LONG_WRITE_OK while it is intact
+    atomic_bool locked;      // payload handed out and not yet released
+    long_write_stats_t stats;
+} long_write_t;
+
+// buf must hold capacity + 1 bytes
+void long_write_init(long_write_t *lw, uint8_t *buf, size_t capacity);
+
+long_write_status_t long_write_append(long_write_t *lw, uint16_t handle, uint16_t offset,
+                                      const uint8_t *data, uint16_t len);
+
+// Complete the payload in progress. On success the arena is locked, *data is NUL terminated
+// and stays valid until long_write_release(). A voided payload is dropped and its error returned.
+long_write_status_t long_write_finish(long_write_t *lw, uint16_t *handle, const uint8_t **data, size_t *len);
+
+// Drop the payload in progress (execute with cancel, disconnect)
+void long_write_cancel(long_write_t *lw);
+
+// Copy a complete payload that did not arrive as prepared writes into the arena and lock it
+long_write_status_t long_write_store(long_write_t *lw, const uint8_t *data, size_t len, const uint8_t **out);
+
+void long_write_release(long_write_t *lw);
+
+const char *long_write_status_str(long_write_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
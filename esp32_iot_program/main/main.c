@@ -7,15 +7,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "freertos/event_groups.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "freertos/ringbuf.h"
+#include "mbedtls/sha256.h"
 #include "nvs_flash.h"
+#include "nvs.h"
 #include "esp_bt.h"
 #include "esp_gap_ble_api.h"
 #include "esp_gatts_api.h"
@@ -27,16 +33,33 @@
 #include "esp_lcd_panel_vendor.h"
 #include "esp_lcd_panel_ops.h"
 #include "driver/gpio.h"
+#include "driver/ledc.h"
 #include "driver/spi_master.h"
 
 // LVGL includes
 #include "lvgl.h"
 
+#include "display_cmd_queue.h"
+#include "cmd_frame.h"
+#include "long_write.h"
+#include "image_stream.h"
+#include "image_codec.h"
+#include "trace.h"
+#include "latency_stats.h"
+#include "display_protocol.h"
+#include "display_scene.h"
+#include "asset_store.h"
+#include "display_state.h"
+#include "adv_state.h"
+
 // Pin definitions for ST7789 display
 #define LCD_HOST       SPI2_HOST
 #define LCD_PIXEL_CLOCK_HZ (40 * 1000 * 1000)
 #define LCD_BK_LIGHT_ON_LEVEL  1
 #define LCD_BK_LIGHT_OFF_LEVEL !LCD_BK_LIGHT_ON_LEVEL
+#define LCD_BK_LIGHT_LEDC_TIMER   LEDC_TIMER_0
+#define LCD_BK_LIGHT_LEDC_CHANNEL LEDC_CHANNEL_0
+#define LCD_BK_LIGHT_PWM_HZ       5000
 
 #define PIN_NUM_MOSI   6
 #define PIN_NUM_CLK    7
@@ -63,54 +86,445 @@ static const char *TAG = "BLE_LCD";
 
 // Global LCD handle
 static esp_lcd_panel_handle_t panel_handle = NULL;
-static uint16_t current_color = COLOR_BLACK;
+
+#if CONFIG_DISPLAY_RENDER_DIRECT
+// Direct mode: LVGL renders into one persistent full-screen framebuffer and only the dirty
+// areas are sent. Areas narrower than the screen are packed into a staging buffer first.
+#define LCD_DIRECT_STAGE_LINES 16
+static lv_color_t *lcd_framebuffer = NULL;
+static lv_color_t *lcd_direct_stage = NULL;
+#else
+// Number of display lines per LVGL draw buffer (two buffers, ping-ponged against SPI DMA)
+#define LCD_DRAW_BUF_LINES CONFIG_DISPLAY_DRAW_BUF_LINES
+static lv_color_t *buf1 = NULL;
+static lv_color_t *buf2 = NULL;
+#endif
 
 // LVGL globals
 static lv_disp_draw_buf_t disp_buf;
 static lv_disp_drv_t disp_drv;
-static lv_color_t *buf1 = NULL;
-static lv_color_t *buf2 = NULL;
-static lv_obj_t *text_label = NULL;
-static lv_obj_t *screen_obj = NULL;
-static lv_obj_t *status_indicator = NULL;
 
-// Status indicator state
+// Async flush state: set by lvgl_flush_cb, cleared by the SPI color-transfer-done ISR
+static volatile bool lvgl_flush_in_flight = false;
+static SemaphoreHandle_t lvgl_flush_done_sem = NULL;
+
+// Solid-fill engine: persistent DMA tile holding one pre-swapped color, sent in large bursts
+#define LCD_FILL_TILE_LINES 16
+static uint16_t *lcd_fill_tile = NULL;
+static uint16_t lcd_fill_tile_color = 0;    // wire-order (byte swapped) color in the tile
+static bool lcd_fill_tile_valid = false;
+static volatile uint32_t lcd_direct_pending = 0;  // direct (non-LVGL) color transfers in flight
+static SemaphoreHandle_t lcd_direct_done_sem = NULL;
+static portMUX_TYPE lcd_direct_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Image streaming: pixel rows go from the BLE callback into DMA slots and straight to the panel
+#define IMAGE_SLOT_LINES 8
+static image_stream_t image_stream;
+static int64_t image_open_us = 0;       // (Bluedroid task)
+static int64_t image_last_data_us = 0;  // (Bluedroid task, read by lvgl_task after the last slot)
+static uint32_t image_wire_bytes = 0;   // pixel payload as received, before decoding (same)
+static uint8_t image_encoding = 0;      // IMAGE_ENCODING_* of the open window (Bluedroid task)
+static image_codec_decoder_t image_decoder;
+
+// Asset store: uploads are queued raw by the BLE callback and written to flash by asset_task.
+// The partition stays memory-mapped, so LVGL reads stored images in place.
+#define ASSET_PARTITION_SUBTYPE 0x40   // custom data subtype of the "assets" partition
+#define ASSET_WINDOW            4096   // data bytes a client may send beyond those written
+#define ASSET_ITEM_HEADER       3      // ring items: slot index, slot generation uint16, then the written value
+#define ASSET_MIN_CHUNK         15     // data bytes per DATA write at the minimum MTU: 23 - 3 - 5
+// Ring space of one no-split item: the value rounded up to 4 bytes plus the 8-byte item header
+#define ASSET_RING_ITEM(len)    ((((len) + 3) & ~3) + 8)
+// A whole window of minimum-MTU DATA items (32 bytes each for 15 data bytes), one more for the
+// ring's wrap, and room for two of the largest control items (QUERY)
+#define ASSET_RING_SIZE                                                                              \
+    (ASSET_RING_ITEM(ASSET_ITEM_HEADER + 5 + ASSET_MIN_CHUNK) * (ASSET_WINDOW / ASSET_MIN_CHUNK + 2) + \
+     2 * ASSET_RING_ITEM(ASSET_ITEM_HEADER + 1 + ASSET_QUERY_MAX * ASSET_KEY_LEN))
+static const esp_partition_t *asset_partition = NULL;
+static esp_partition_mmap_handle_t asset_mmap;
+static asset_store_t asset_store;            // (asset_task; lookups under asset_lock)
+static SemaphoreHandle_t asset_lock = NULL;
+static RingbufHandle_t asset_ring = NULL;
+static TaskHandle_t asset_task_handle = NULL;
+static int64_t asset_begin_us = 0;           // (asset_task)
+// Erasing waits for the shown image to be hidden: the Bluedroid task posts a hide fence with each
+// ERASE, lvgl_task counts the fences it applied, and asset_task erases once the count reaches the
+// ERASE's fence. Lookups find nothing while an erase is pending, so an image cannot come back
+// between the hide and the erase.
+#define ASSET_HIDE_TIMEOUT_MS   1000
+static uint32_t asset_hides_posted = 0;      // (Bluedroid task)
+static volatile uint32_t asset_hides_applied = 0;  // (lvgl_task)
+static _Atomic int asset_erases_pending = 0;
+
+_Static_assert(CMD_FRAME_ASSET_KEY_LEN == ASSET_KEY_LEN, "command frames carry asset store keys");
+
+// Display state persistence: lvgl_task folds every applied command into display_state and
+// publishes the encoded frame; state_task writes it to NVS once updates pause
+#define STATE_NVS_NAMESPACE  "display"
+#define STATE_NVS_KEY        "state"
+#define STATE_SAVE_QUIET_MS  2000   // write once no update came for this long
+#define STATE_SAVE_MAX_MS    30000  // but no later than this after the first unsaved update
+static display_state_t display_state;               // (lvgl_task)
+static uint8_t state_blob[CMD_FRAME_ENCODED_MAX];   // latest encoded state, under state_blob_lock
+static size_t state_blob_len = 0;
+static uint8_t state_adv[ADV_STATE_LEN];            // its advertisement data, under state_blob_lock
+static portMUX_TYPE state_blob_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t state_saved[CMD_FRAME_ENCODED_MAX];  // what NVS holds (state_task)
+static size_t state_saved_len = 0;
+static TaskHandle_t state_task_handle = NULL;
+
+// Refresh scheduler state: updates only invalidate objects, lvgl_task renders
+static volatile bool refresh_pending = false;
+static volatile uint32_t frames_requested = 0;  // display updates requested
+static volatile uint32_t frames_coalesced = 0;  // updates merged into an already pending frame
+static volatile uint32_t frames_rendered = 0;   // render passes actually flushed
+static volatile uint32_t frames_flush_bytes = 0; // pixel bytes sent to the panel by LVGL flushes
+
+// Backlight level asked for by the scene. The backlight stays off until LVGL has put the first
+// frame on the panel, so whatever the panel RAM held at power-up is never seen.
+static uint8_t lcd_brightness = 255;
+static bool lcd_backlight_on = false;  // (lvgl_task; app_main before it starts)
+
+// Boot profile: the display and Bluetooth come up in parallel, each phase is stamped once
+// (us since boot) and the whole timeline is logged when the last one is reached
 typedef enum {
-    STATUS_DISCONNECTED,  // Red
-    STATUS_ADVERTISING,   // Flashing blue
-    STATUS_CONNECTED      // Green
-} connection_status_t;
+    BOOT_PHASE_APP_MAIN,     // bootloader and startup done
+    BOOT_PHASE_LCD,          // panel initialized
+    BOOT_PHASE_LVGL,         // scene created, saved state applied
+    BOOT_PHASE_FIRST_FRAME,  // first frame on the panel, backlight on
+    BOOT_PHASE_CONTROLLER,   // Bluetooth controller enabled
+    BOOT_PHASE_BLUEDROID,    // Bluedroid enabled
+    BOOT_PHASE_ADVERTISING,  // advertising started
+    BOOT_PHASES
+} boot_phase_t;
+static const char *const boot_phase_names[BOOT_PHASES] = {
+    "app_main", "lcd", "lvgl", "first frame", "controller", "bluedroid", "advertising",
+};
+static int64_t boot_phase_us[BOOT_PHASES];
+static _Atomic uint32_t boot_phases_done = 0;  // bit per stamped phase
+
+// lvgl_task sleeps until its next LVGL timer is due or a producer notifies it
+static TaskHandle_t lvgl_task_handle = NULL;
+static volatile uint32_t lvgl_wakeups = 0;       // loop passes of lvgl_task
+
+// Display commands from the Bluedroid callbacks, consumed only by lvgl_task. This system queue
+// carries status changes; what a client writes goes through the queue of its connection slot.
+static display_cmd_queue_t display_cmd_queue;
+
+// Binary event trace in place of logging on the hot paths (dumped on demand, tools/trace_decode.py)
+#if CONFIG_DISPLAY_TRACE
+static trace_ring_t trace_ring;
+static uint8_t trace_dump[TRACE_SNAPSHOT_MAX];
+static size_t trace_dump_len = 0;     // snapshot being read over BLE (Bluedroid task)
+static size_t trace_dump_cursor = 0;
+#define TRACE(event, a, b) trace_record(&trace_ring, (uint32_t)esp_timer_get_time(), (event), (a), (b))
+#else
+#define TRACE(event, a, b) do { } while (0)
+#endif
 
-static connection_status_t current_status = STATUS_DISCONNECTED;
-static bool indicator_flash_state = false;
+// Command latency from write to pixels on the panel, timestamps are the low 32 bits of esp_timer
+typedef struct {
+    uint8_t type;
+    uint32_t rx_us;
+    uint32_t enq_us;
+} latency_sample_t;
+
+#define LATENCY_BATCH_MAX (2 * DISPLAY_CMD_QUEUE_LEN * CONFIG_DISPLAY_MAX_CONNECTIONS)
+#define LATENCY_REPORT_PERIOD_US (1000 * 1000)
+static uint32_t gatts_rx_us = 0;                            // arrival of the write being handled (Bluedroid task)
+static latency_stats_t latency_stats;                       // (lvgl_task from here on)
+static latency_sample_t latency_pending[LATENCY_BATCH_MAX]; // applied, waiting for the next frame
+static int latency_pending_count = 0;
+static latency_sample_t latency_frame[LATENCY_BATCH_MAX];   // applied before the frame now on the wire
+static int latency_frame_count = 0;
+static bool latency_frame_active = false;
+static uint32_t latency_pass_start_us = 0;
+static uint32_t latency_render_start_us = 0;
+static uint32_t latency_flush_start_us = 0;
+static uint32_t latency_recorded = 0;
+static uint32_t latency_reported = 0;
+static int64_t latency_report_us = 0;
+static volatile bool lvgl_flush_last = false;         // the flush in flight ends a frame
+static volatile bool latency_frame_done = false;      // set by the ISR when that flush completes
+static volatile uint32_t latency_frame_done_us = 0;
+// Encoded report served by the stats characteristic, rebuilt by lvgl_task
+static uint8_t latency_report[LATENCY_REPORT_MAX + LABEL_CACHE_REPORT_LEN];
+static size_t latency_report_len = 0;
+static portMUX_TYPE latency_report_lock = portMUX_INITIALIZER_UNLOCKED;
+
+_Static_assert(DISPLAY_CMD_SET_TEXT_REF < LATENCY_TYPES, "every display command type needs latency histograms");
 
 // Function declarations
-void lcd_clear_screen(uint16_t color);
-void lcd_clear_screen_rgb888(uint32_t rgb888);
-void lcd_display_text(const char *text);
-void set_connection_status(connection_status_t status);
+void lcd_set_brightness(uint8_t level);
+typedef struct conn_slot conn_slot_t;
+static bool display_post_status(connection_status_t status);
+static void stream_send_credits(conn_slot_t *slot);
+static void image_send_ack(conn_slot_t *slot, uint16_t image_id, uint8_t state, uint32_t drawn, uint32_t limit);
+void display_get_refresh_stats(uint32_t *requested, uint32_t *coalesced, uint32_t *rendered, uint32_t *flush_bytes);
 
 // BLE Definitions
 #define GATTS_SERVICE_UUID   0x00FF
 #define GATTS_CHAR_UUID_COLOR 0xFF01
 #define GATTS_CHAR_UUID_TEXT  0xFF02
-#define GATTS_NUM_HANDLE     8
+#define GATTS_CHAR_UUID_COMMAND 0xFF03
+#define GATTS_CHAR_UUID_STREAM  0xFF04
+#define GATTS_CHAR_UUID_CREDITS 0xFF05
+#define GATTS_CHAR_UUID_IMAGE   0xFF06
+#define GATTS_CHAR_UUID_TRACE   0xFF07
+#define GATTS_CHAR_UUID_STATS   0xFF08
+#define GATTS_CHAR_UUID_ASSET   0xFF09
+#define GATTS_CHAR_UUID_THROUGHPUT 0xFF0A
+#define GATTS_CHAR_UUID_LINK    0xFF0B
+
+// Characteristics of the display service, added in this order from ESP_GATTS_ADD_CHAR_EVT
+enum {
+    CHAR_IDX_COLOR,
+    CHAR_IDX_TEXT,
+    CHAR_IDX_COMMAND,
+    CHAR_IDX_STREAM,
+    CHAR_IDX_CREDITS,
+    CHAR_IDX_IMAGE,
+    CHAR_IDX_TRACE,
+    CHAR_IDX_STATS,
+    CHAR_IDX_ASSET,
+    CHAR_IDX_THROUGHPUT,
+    CHAR_IDX_LINK,
+    CHAR_IDX_NUM,
+};
+
+typedef struct {
+    uint16_t uuid;
+    esp_gatt_perm_t perm;
+    esp_gatt_char_prop_t property;  // a CCCD is added for NOTIFY characteristics
+} gatts_char_def_t;
+
+static const gatts_char_def_t gatts_char_defs[CHAR_IDX_NUM] = {
+    [CHAR_IDX_COLOR] = {
+        .uuid = GATTS_CHAR_UUID_COLOR,
+        .perm = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
+    },
+    [CHAR_IDX_TEXT] = {
+        .uuid = GATTS_CHAR_UUID_TEXT,
+        .perm = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
+    },
+    [CHAR_IDX_COMMAND] = {
+        .uuid = GATTS_CHAR_UUID_COMMAND,
+        .perm = ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_WRITE,
+    },
+    [CHAR_IDX_STREAM] = {
+        .uuid = GATTS_CHAR_UUID_STREAM,
+        .perm = ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_WRITE_NR,
+    },
+    [CHAR_IDX_CREDITS] = {
+        .uuid = GATTS_CHAR_UUID_CREDITS,
+        .perm = ESP_GATT_PERM_READ,
+        .property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+    },
+    [CHAR_IDX_IMAGE] = {
+        .uuid = GATTS_CHAR_UUID_IMAGE,
+        .perm = ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+    },
+    [CHAR_IDX_TRACE] = {
+        .uuid = GATTS_CHAR_UUID_TRACE,
+        .perm = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
+    },
+    [CHAR_IDX_STATS] = {
+        .uuid = GATTS_CHAR_UUID_STATS,
+        .perm = ESP_GATT_PERM_READ,
+        .property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+    },
+    [CHAR_IDX_ASSET] = {
+        .uuid = GATTS_CHAR_UUID_ASSET,
+        .perm = ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+    },
+    [CHAR_IDX_THROUGHPUT] = {
+        .uuid = GATTS_CHAR_UUID_THROUGHPUT,
+        .perm = ESP_GATT_PERM_WRITE,
+        .property = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+    },
+    [CHAR_IDX_LINK] = {
+        .uuid = GATTS_CHAR_UUID_LINK,
+        .perm = ESP_GATT_PERM_READ,
+        .property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+    },
+};
+
+// Streaming flow control: a client may have this many stream frames outstanding
+// beyond those consumed; the rest of the display queue stays free for other commands
+#define STREAM_CREDIT_WINDOW (DISPLAY_CMD_QUEUE_LEN / 2)
+
+// Image characteristic: the first byte of every write is an opcode
+#define IMAGE_OP_OPEN   0x01  // x, y, w, h as uint16 little-endian, optional encoding byte
+#define IMAGE_OP_DATA   0x02  // pixels in the window's encoding
+#define IMAGE_OP_ABORT  0x03
+
+// Asset characteristic: the first byte of every write is an opcode, fields are little-endian
+#define ASSET_OP_BEGIN   0x01  // key[8], type uint8, size uint32 (write with response)
+#define ASSET_OP_DATA    0x02  // offset uint32, then data (write without response)
+#define ASSET_OP_FINISH  0x03  // check the data hashes to its key and publish the asset
+#define ASSET_OP_ABORT   0x04
+#define ASSET_OP_ERASE   0x05  // erase every stored asset
+#define ASSET_OP_QUERY   0x06  // key[8] * n: which of these keys are stored
+#define ASSET_QUERY_MAX  60    // keys per query, fits a 512-byte write
+
+// Throughput characteristic: the first byte of every write is an opcode
+#define THROUGHPUT_OP_RX_START  0x01  // reset the receive counters
+#define THROUGHPUT_OP_DATA      0x02  // filler, counted (write without response); also the notified filler
+#define THROUGHPUT_OP_RX_STOP   0x03  // notify the receive result
+#define THROUGHPUT_OP_TX_START  0x04  // duration_ms uint16: notify filler for that long, then the result
+#define THROUGHPUT_OP_RESULT    0x05  // notified: direction, PHYs, bytes, elapsed, interval, MTU
+#define THROUGHPUT_DIR_RX       0     // client to device
+#define THROUGHPUT_DIR_TX       1     // device to client
+#define THROUGHPUT_TX_MAX_MS    10000
+
+// Trace characteristic commands
+#define TRACE_CMD_SNAPSHOT  0x01  // freeze the ring; successive reads return the snapshot in chunks
+#define TRACE_CMD_SERIAL    0x02  // print the ring to the serial log as TRACE lines
+
+// Link characteristic (read, notified when the MTU changes), all little-endian:
+//   uint8 version, uint8 reserved, uint16 MTU, uint16 largest MTU the device accepts,
+//   uint16 largest single write (MTU - 3), uint16 largest long (prepared) write value
+#define LINK_INFO_LEN  10
+
+// Image pixel encodings
+#define IMAGE_ENCODING_RAW   0  // RGB565, big-endian, row-major
+#define IMAGE_ENCODING_Q565  1  // image_codec.h
+
+// Image acknowledgement states
+#define IMAGE_STATE_RECEIVING 0
+#define IMAGE_STATE_DRAWN     1
+#define IMAGE_STATE_ERROR     2
+
+// Service declaration plus declaration and value handle per characteristic, with room for descriptors
+#define GATTS_NUM_HANDLE     (1 + 3 * CHAR_IDX_NUM)
 
 #define DEVICE_NAME          "SusanESP"
+#define FIRMWARE_VERSION     1      // advertised with the display state; bump with every release
 #define GATTS_DEMO_CHAR_VAL_LEN_MAX 100
 
-static uint8_t adv_config_done = 0;
+// Long (prepared) writes are reassembled into this preallocated arena
+#define LONG_WRITE_ARENA_SIZE 4096
+static uint8_t long_write_arena[LONG_WRITE_ARENA_SIZE + 1];  // +1 for the NUL terminator
+static long_write_t long_write;
+static int64_t long_write_start_us = 0;
+
+// ATT MTU offered in the exchange; the connection uses the smaller of this and the client's
+#define GATTS_LOCAL_MTU      500
+#define GATTS_LINK_VERSION   1
+
+// Connection parameters: a short interval while the client writes, a relaxed one with peripheral
+// latency once the link has been idle for CONFIG_DISPLAY_CONN_IDLE_MS. Intervals in 1.25 ms units.
+#define CONN_FAST_MIN_INTERVAL  6
+#define CONN_IDLE_LATENCY       4      // connection events the device may skip while idle
+#define CONN_TIMEOUT            400    // supervision timeout, 10 ms units
+#define CONN_DATA_LEN           251    // link layer payload with data length extension
+#define CONN_IDLE_CHECK_US      (1000 * 1000)
+static esp_timer_handle_t conn_idle_timer = NULL;  // runs while any client is connected
+
+// One slot per connected client, CONFIG_DISPLAY_MAX_CONNECTIONS of them. Slots are claimed and
+// freed by the Bluedroid task; lvgl_task and the idle timer only read them.
+#define GATTS_MAX_CONN       CONFIG_DISPLAY_MAX_CONNECTIONS
+struct conn_slot {
+    volatile bool in_use;
+    uint16_t conn_id;
+    esp_bd_addr_t bda;
+    uint16_t mtu;                               // negotiated ATT MTU
+    uint16_t cccd_values[CHAR_IDX_NUM];         // the client's subscriptions
+    // Display commands this client wrote, drained round robin by lvgl_task. Initialized once
+    // at boot: commands still queued when a slot is reused are applied all the same, but their
+    // stream frames are stamped with the old generation and no longer earn credits.
+    display_cmd_queue_t queue;
+    volatile uint16_t generation;               // bumped on disconnect (Bluedroid task)
+    // Streaming statistics. The total only grows; the connection's view subtracts the base taken at connect.
+    volatile uint32_t stream_consumed_total;    // this generation's stream frames applied (lvgl_task)
+    uint32_t stream_consumed_base;              // (Bluedroid task from here on)
+    uint32_t stream_received;
+    uint32_t stream_dropped;
+    int64_t stream_first_us;
+    int64_t stream_last_us;
+    // Connection parameters
+    uint16_t interval;                          // current interval
+    uint8_t tx_phy;                             // ESP_BLE_GAP_PHY_1M / _2M / _CODED
+    uint8_t rx_phy;
+    volatile bool relaxed;                      // relaxed parameters requested (Bluedroid task, idle timer)
+    volatile uint32_t last_rx_us;               // last write from the client
+    // Throughput test, receive direction
+    uint32_t throughput_rx_bytes;
+    int64_t throughput_rx_first_us;
+    int64_t throughput_rx_last_us;
+};
+static conn_slot_t conn_slots[GATTS_MAX_CONN];
+static int conn_count = 0;                      // slots in use (Bluedroid task)
+static conn_slot_t *gatts_slot = NULL;          // connection of the event being handled (Bluedroid task)
+
+// The image window, the long-write arena and the throughput burst are single resources: they
+// belong to the connection that started them until it finishes or disconnects
+static conn_slot_t *volatile image_owner = NULL;
+static conn_slot_t *long_write_owner = NULL;    // (Bluedroid task)
+
+// Throughput test, see THROUGHPUT_OP_*
+static _Atomic bool throughput_tx_running = false;   // a notification burst is in progress
+static volatile bool throughput_tx_cancel = false;   // set when its client disconnects
+static conn_slot_t *throughput_tx_slot = NULL;       // client receiving the burst
+static uint16_t throughput_tx_ms = 0;
+static uint8_t throughput_tx_buf[512];               // filler, the largest attribute value
+
+static uint8_t adv_config_done = 0;                  // configured at boot, not yet confirmed (Bluedroid task)
 #define ADV_CONFIG_FLAG      (1 << 0)
 #define SCAN_RSP_CONFIG_FLAG (1 << 1)
 
+// Advertising intervals in 0.625 ms units: fast for CONFIG_DISPLAY_ADV_FAST_MS after boot and after
+// a disconnect so the app finds the device within one scan window, slow after that to save radio time
+#define ADV_FAST_INT_MIN     0x20   // 20 ms
+#define ADV_FAST_INT_MAX     0x30   // 30 ms
+#define ADV_SLOW_INT_MIN     0x640  // 1 s
+#define ADV_SLOW_INT_MAX     0x780  // 1.2 s
+enum { ADV_RESTART_NONE, ADV_RESTART_FAST, ADV_RESTART_SLOW };
+static volatile int adv_restart = ADV_RESTART_NONE;  // how to restart once advertising has stopped
+static esp_timer_handle_t adv_fast_timer = NULL;
+
+// Display state snapshot in the manufacturer data, see adv_state.h. adv_manufacturer is what
+// adv_data points to and only the Bluedroid task touches it; app_main and state_task leave the
+// newest snapshot in adv_state_latest and configure it themselves only once the boot handshake
+// (adv_config_done) has finished, which adv_ready records.
+static uint8_t adv_manufacturer[ADV_STATE_LEN];
+static uint8_t adv_state_latest[ADV_STATE_LEN];    // under adv_state_lock
+static bool adv_ready = false;                     // under adv_state_lock
+static portMUX_TYPE adv_state_lock = portMUX_INITIALIZER_UNLOCKED;
+
 static uint8_t service_uuid[16] = {
     0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
     0x00, 0x10, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00,
 };
 
+// Legacy advertising carries 31 bytes: flags, name, service UUID (Bluedroid shortens UUIDs on the
+// base UUID to 16 bits) and the manufacturer data take 30. TX power and the preferred connection
+// interval go to the scan response.
 static esp_ble_adv_data_t adv_data = {
     .set_scan_rsp = false,
     .include_name = true,
+    .include_txpower = false,
+    .min_interval = 0,
+    .max_interval = 0,
+    .appearance = 0x00,
+    .manufacturer_len = sizeof(adv_manufacturer),
+    .p_manufacturer_data = adv_manufacturer,
+    .service_data_len = 0,
+    .p_service_data = NULL,
+    .service_uuid_len = sizeof(service_uuid),
+    .p_service_uuid = service_uuid,
+    .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+};
+
+static esp_ble_adv_data_t scan_rsp_data = {
+    .set_scan_rsp = true,
+    .include_name = false,
     .include_txpower = true,
     .min_interval = 0x0006,
     .max_interval = 0x0010,
@@ -119,14 +533,14 @@ static esp_ble_adv_data_t adv_data = {
     .p_manufacturer_data = NULL,
     .service_data_len = 0,
     .p_service_data = NULL,
-    .service_uuid_len = sizeof(service_uuid),
-    .p_service_uuid = service_uuid,
-    .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+    .service_uuid_len = 0,
+    .p_service_uuid = NULL,
+    .flag = 0,
 };
 
 static esp_ble_adv_params_t adv_params = {
-    .adv_int_min = 0x20,
-    .adv_int_max = 0x40,
+    .adv_int_min = ADV_FAST_INT_MIN,
+    .adv_int_max = ADV_FAST_INT_MAX,
     .adv_type = ADV_TYPE_IND,
     .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
     .channel_map = ADV_CHNL_ALL,
@@ -137,13 +551,10 @@ struct gatts_profile_inst {
     esp_gatts_cb_t gatts_cb;
     uint16_t gatts_if;
     uint16_t app_id;
-    uint16_t conn_id;
     uint16_t service_handle;
     esp_gatt_srvc_id_t service_id;
-    uint16_t char_handle_color;
-    uint16_t char_handle_text;
-    esp_bt_uuid_t char_uuid_color;
-    esp_bt_uuid_t char_uuid_text;
+    uint16_t char_handles[CHAR_IDX_NUM];
+    uint16_t cccd_handles[CHAR_IDX_NUM];
     esp_gatt_perm_t perm;
     esp_gatt_char_prop_t property;
     uint16_t descr_handle;
@@ -162,212 +573,1864 @@ static struct gatts_profile_inst gl_profile_tab[PROFILE_NUM] = {
     },
 };
 
-// LVGL Display Flush Callback
+// Panel IO color transfer done (ISR context): completes the LVGL flush that owns the buffer
+static bool lcd_color_trans_done_cb(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+{
+    lv_disp_drv_t *drv = (lv_disp_drv_t *)user_ctx;
+    BaseType_t need_yield = pdFALSE;
+
+    // Transfers complete in issue order and a direct draw only starts once the
+    // previous LVGL flush has drained, so an in-flight flush is always the oldest
+    if (lvgl_flush_in_flight) {
+        lvgl_flush_in_flight = false;
+        if (lvgl_flush_last) {
+            latency_frame_done_us = (uint32_t)esp_timer_get_time();
+            latency_frame_done = true;
+            // Let lvgl_task record the frame's latency even if it has nothing else to do
+            vTaskNotifyGiveFromISR(lvgl_task_handle, &need_yield);
+        }
+        lv_disp_flush_ready(drv);
+        xSemaphoreGiveFromISR(lvgl_flush_done_sem, &need_yield);
+    } else {
+        portENTER_CRITICAL_ISR(&lcd_direct_lock);
+        if (lcd_direct_pending > 0 && --lcd_direct_pending == 0) {
+            xSemaphoreGiveFromISR(lcd_direct_done_sem, &need_yield);
+        }
+        portEXIT_CRITICAL_ISR(&lcd_direct_lock);
+    }
+    return need_yield == pdTRUE;
+}
+
+// Record the stage latencies of every command in a frame once its last flush is done (lvgl_task only)
+static void latency_frame_poll(void)
+{
+    if (!latency_frame_active || !latency_frame_done) {
+        return;
+    }
+    uint32_t done_us = latency_frame_done_us;
+    for (int i = 0; i < latency_frame_count; i++) {
+        const latency_sample_t *sample = &latency_frame[i];
+        latency_stats_add(&latency_stats, sample->type, LATENCY_STAGE_PARSE, sample->enq_us - sample->rx_us);
+        latency_stats_add(&latency_stats, sample->type, LATENCY_STAGE_WAIT, latency_render_start_us - sample->enq_us);
+        latency_stats_add(&latency_stats, sample->type, LATENCY_STAGE_RENDER,
+                          latency_flush_start_us - latency_render_start_us);
+        latency_stats_add(&latency_stats, sample->type, LATENCY_STAGE_FLUSH, done_us - latency_flush_start_us);
+        latency_stats_add(&latency_stats, sample->type, LATENCY_STAGE_TOTAL, done_us - sample->rx_us);
+    }
+    latency_recorded += latency_frame_count;
+    latency_frame_count = 0;
+    latency_frame_active = false;
+    latency_frame_done = false;
+}
+
+// First flush of a frame: everything applied since the previous frame is rendered in it (lvgl_task only).
+// Render start is taken as the start of the lv_timer_handler pass that produced the frame.
+static void latency_frame_begin(void)
+{
+    memcpy(latency_frame, latency_pending, latency_pending_count * sizeof(latency_sample_t));
+    latency_frame_count = latency_pending_count;
+    latency_pending_count = 0;
+    latency_render_start_us = latency_pass_start_us;
+    latency_flush_start_us = (uint32_t)esp_timer_get_time();
+    latency_frame_active = true;
+}
+
+#if !CONFIG_DISPLAY_RENDER_DIRECT
+// LVGL Display Flush Callback: queue the buffer for DMA and return immediately,
+// so LVGL renders into the other buffer while this one is on the wire
 static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
+    // The previous frame's last flush has completed before LVGL hands over the next buffer
+    latency_frame_poll();
+    if (!latency_frame_active) {
+        latency_frame_begin();
+    }
+    lvgl_flush_last = lv_disp_flush_is_last(drv);
+    frames_flush_bytes += (uint32_t)lv_area_get_size(area) * sizeof(lv_color_t);
+
     esp_lcd_panel_handle_t panel = (esp_lcd_panel_handle_t) drv->user_data;
     int offsetx1 = area->x1;
     int offsetx2 = area->x2;
     int offsety1 = area->y1;
     int offsety2 = area->y2;
-    // Pass the draw buffer to the driver
+    // Pass the draw buffer to the driver, lv_disp_flush_ready() is called from the transfer done ISR
+    lvgl_flush_in_flight = true;
     esp_lcd_panel_draw_bitmap(panel, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
+}
+#endif
+
+// LVGL Wait Callback: block instead of spinning while both buffers are busy
+static void lvgl_wait_cb(lv_disp_drv_t *drv)
+{
+    xSemaphoreTake(lvgl_flush_done_sem, pdMS_TO_TICKS(10));
+}
+
+// Queue a direct color transfer (lvgl_task or boot only); the buffer must stay untouched until idle
+static void lcd_direct_draw(int x_start, int y_start, int x_end, int y_end, const void *data)
+{
+    // The ISR decrements the count when an earlier transfer completes
+    portENTER_CRITICAL(&lcd_direct_lock);
+    lcd_direct_pending++;
+    portEXIT_CRITICAL(&lcd_direct_lock);
+    esp_lcd_panel_draw_bitmap(panel_handle, x_start, y_start, x_end, y_end, data);
+}
+
+// Wait until all direct color transfers have left the DMA buffers
+static void lcd_direct_wait_idle(void)
+{
+    while (lcd_direct_pending > 0) {
+        xSemaphoreTake(lcd_direct_done_sem, pdMS_TO_TICKS(10));
+    }
+}
+
+#if CONFIG_DISPLAY_RENDER_DIRECT
+// Send one dirty area of the framebuffer (inclusive coordinates) and return the bytes sent.
+// Full-width areas are contiguous and go straight from the framebuffer; narrower ones are
+// packed row by row into the staging buffer, one burst at a time.
+static uint32_t lcd_direct_flush_area(const lv_area_t *area)
+{
+    const int width = area->x2 - area->x1 + 1;
+    const int height = area->y2 - area->y1 + 1;
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    if (width == LCD_H_RES) {
+        lcd_direct_draw(0, area->y1, LCD_H_RES, area->y2 + 1, &lcd_framebuffer[area->y1 * LCD_H_RES]);
+    } else {
+        const int rows_per_burst = (LCD_H_RES * LCD_DIRECT_STAGE_LINES) / width;
+        for (int row = 0; row < height; row += rows_per_burst) {
+            int rows = (height - row < rows_per_burst) ? height - row : rows_per_burst;
+            // The previous burst may still be reading the staging buffer
+            lcd_direct_wait_idle();
+            for (int r = 0; r < rows; r++) {
+                memcpy(&lcd_direct_stage[r * width],
+                       &lcd_framebuffer[(area->y1 + row + r) * LCD_H_RES + area->x1],
+                       width * sizeof(lv_color_t));
+            }
+            lcd_direct_draw(area->x1, area->y1 + row, area->x2 + 1, area->y1 + row + rows, lcd_direct_stage);
+        }
+    }
+    return (uint32_t)width * height * sizeof(lv_color_t);
+}
+
+// LVGL Display Flush Callback, direct mode: the framebuffer already holds the frame, so only
+// the last flush of a refresh sends anything, namely the display's invalidated areas.
+// The transfers are waited for here; with a single buffer LVGL could not render meanwhile anyway.
+static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    latency_frame_poll();
+    if (!latency_frame_active) {
+        latency_frame_begin();
+    }
+    if (!lv_disp_flush_is_last(drv)) {
+        lv_disp_flush_ready(drv);
+        return;
+    }
+
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    uint32_t bytes = 0;
+    for (int i = 0; i < disp->inv_p; i++) {
+        if (!disp->inv_area_joined[i]) {
+            bytes += lcd_direct_flush_area(&disp->inv_areas[i]);
+        }
+    }
+    lcd_direct_wait_idle();
+    frames_flush_bytes += bytes;
+
+    latency_frame_done_us = (uint32_t)esp_timer_get_time();
+    latency_frame_done = true;
     lv_disp_flush_ready(drv);
 }
+#endif
+
+// Fill a rectangle with a wire-order color using the persistent tile (lvgl_task or boot only).
+// Each burst covers as many full rows as fit in the tile; transfers are left in flight.
+static void lcd_fill_rect_raw(int x, int y, int width, int height, uint16_t wire_color)
+{
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // The tile may still be on the wire from a previous fill of another color
+    if (!lcd_fill_tile_valid || lcd_fill_tile_color != wire_color) {
+        lcd_direct_wait_idle();
+        for (int i = 0; i < LCD_H_RES * LCD_FILL_TILE_LINES; i++) {
+            lcd_fill_tile[i] = wire_color;
+        }
+        lcd_fill_tile_color = wire_color;
+        lcd_fill_tile_valid = true;
+    }
+
+    const int rows_per_burst = (LCD_H_RES * LCD_FILL_TILE_LINES) / width;
+    for (int row = 0; row < height; row += rows_per_burst) {
+        int rows = (height - row < rows_per_burst) ? height - row : rows_per_burst;
+        lcd_direct_draw(x, y + row, x + width, y + row + rows, lcd_fill_tile);
+    }
+}
+
+// Fill a rectangle with an RGB565 color and wait for the transfer to finish
+void lcd_fill_rect(int x, int y, int width, int height, uint16_t color)
+{
+    // The panel expects big-endian RGB565; swap once instead of per pixel
+    uint16_t wire_color = (uint16_t)((color >> 8) | (color << 8));
+    lcd_fill_rect_raw(x, y, width, height, wire_color);
+    lcd_direct_wait_idle();
+}
+
+// Stamp a boot phase the first time it is reached; any task
+static void boot_mark(boot_phase_t phase)
+{
+    uint32_t bit = 1u << phase;
+    if (atomic_load(&boot_phases_done) & bit) {
+        return;
+    }
+    boot_phase_us[phase] = esp_timer_get_time();
+    uint32_t before = atomic_fetch_or(&boot_phases_done, bit);
+    if ((before & bit) || (before | bit) != (1u << BOOT_PHASES) - 1) {
+        return;
+    }
+    // Last phase: print the timeline once
+    char line[192];
+    int pos = 0;
+    for (int i = 0; i < BOOT_PHASES && pos < (int)sizeof(line); i++) {
+        pos += snprintf(line + pos, sizeof(line) - pos, "%s%s %lld ms", i > 0 ? ", " : "", boot_phase_names[i],
+                        boot_phase_us[i] / 1000);
+    }
+    ESP_LOGI(TAG, "Boot: %s", line);
+}
+
+// LVGL Monitor Callback (called once per completed render pass)
+static void lvgl_monitor_cb(lv_disp_drv_t *drv, uint32_t time, uint32_t px)
+{
+    refresh_pending = false;
+    frames_rendered++;
+    TRACE(TRACE_EV_FRAME, time, px);
+
+    if (!lcd_backlight_on) {
+        lcd_backlight_on = true;
+        lcd_set_brightness(lcd_brightness);
+        boot_mark(BOOT_PHASE_FIRST_FRAME);
+    }
+}
+
+// Mark a display update; the refresh timer in lvgl_task coalesces pending updates into one frame.
+// The timer is paused while nothing is invalidated, see lvgl_task (lvgl_task only).
+static void display_request_refresh(void)
+{
+    lv_timer_resume(_lv_disp_get_refr_timer(lv_disp_get_default()));
+    frames_requested++;
+    if (refresh_pending) {
+        frames_coalesced++;
+    } else {
+        refresh_pending = true;
+    }
+}
+
+void display_get_refresh_stats(uint32_t *requested, uint32_t *coalesced, uint32_t *rendered, uint32_t *flush_bytes)
+{
+    *requested = frames_requested;
+    *coalesced = frames_coalesced;
+    *rendered = frames_rendered;
+    *flush_bytes = frames_flush_bytes;
+}
+
+// LVGL Tick Callback
+#if LV_TICK_CUSTOM
+static uint32_t lvgl_tick_get_cb(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+#endif
+
+// Scene hooks: background fills go to the panel through the tile engine (lvgl_task only)
+// In direct mode the framebuffer keeps the old background around the children; that is harmless
+// because LVGL re-renders every invalidated area completely and only those areas are sent.
+static void scene_fill_rect(int x, int y, int width, int height, lv_color_t color, void *ctx)
+{
+    // With CONFIG_LV_COLOR_16_SWAP lv_color_t is already in panel wire order
+    lcd_fill_rect_raw(x, y, width, height, color.full);
+}
+
+static void scene_fill_wait(void *ctx)
+{
+    lcd_direct_wait_idle();
+}
+
+static void scene_set_brightness(uint8_t level, void *ctx)
+{
+    lcd_brightness = level;
+    if (lcd_backlight_on) {
+        lcd_set_brightness(level);
+    }
+}
+
+static void scene_request_refresh(void *ctx)
+{
+    display_request_refresh();
+}
+
+static const uint8_t *scene_find_image(const uint8_t key[CMD_FRAME_ASSET_KEY_LEN], uint32_t *size, void *ctx)
+{
+    if (asset_lock == NULL || atomic_load(&asset_erases_pending) != 0) {
+        return NULL;
+    }
+    uint8_t type;
+    xSemaphoreTake(asset_lock, portMAX_DELAY);
+    const uint8_t *data = asset_store_find(&asset_store, key, &type, size);
+    xSemaphoreGive(asset_lock);
+    return (data != NULL && type == ASSET_TYPE_IMAGE) ? data : NULL;
+}
+
+// Hand the current display state to state_task for saving (lvgl_task only)
+static void state_publish(void)
+{
+    uint8_t blob[CMD_FRAME_ENCODED_MAX];
+    size_t len = display_state_encode(&display_state, blob, sizeof(blob));
+    uint8_t adv[ADV_STATE_LEN];
+    adv_state_encode(&display_state, FIRMWARE_VERSION, adv);
+    portENTER_CRITICAL(&state_blob_lock);
+    memcpy(state_blob, blob, len);
+    state_blob_len = len;
+    memcpy(state_adv, adv, sizeof(adv));
+    portEXIT_CRITICAL(&state_blob_lock);
+    if (state_task_handle != NULL) {
+        xTaskNotifyGive(state_task_handle);
+    }
+}
+
+// Put the saved display state on the scene before the first frame is rendered (app_main, before
+// lvgl_task exists, so LVGL is still ours)
+static void state_restore(void)
+{
+    display_state_init(&display_state);
+    if (state_saved_len == 0) {
+        return;
+    }
+    display_cmd_t cmd;
+    cmd_frame_status_t status = display_protocol_frame(state_saved, state_saved_len, 0, &cmd);
+    if (status != CMD_FRAME_OK) {
+        ESP_LOGW(TAG, "Saved display state ignored: %s", cmd_frame_status_str(status));
+        return;
+    }
+    display_scene_apply(&cmd);
+    display_state_update(&display_state, &cmd);
+    ESP_LOGI(TAG, "Display state restored (%u bytes)", (unsigned int)state_saved_len);
+}
+
+// Apply one queued display command (lvgl_task only)
+static void display_apply_command(const display_cmd_t *cmd)
+{
+    display_scene_apply(cmd);
+    if (display_state_update(&display_state, cmd)) {
+        state_publish();
+    }
+
+    if (cmd->type == DISPLAY_CMD_SET_TEXT_REF) {
+        // The label has copied the string, so the arena can take the next long write
+        long_write_release(&long_write);
+    }
+}
+
+// Apply the oldest command of q, if any; slot is the client that wrote it (lvgl_task only)
+static bool display_apply_next(display_cmd_queue_t *q, conn_slot_t *slot)
+{
+    const display_cmd_t *cmd = display_cmd_queue_peek(q);
+    if (cmd == NULL) {
+        return false;
+    }
+    TRACE(TRACE_EV_CMD_APPLY, cmd->type, display_cmd_queue_count(q) - 1);
+    if (latency_pending_count < LATENCY_BATCH_MAX) {
+        latency_pending[latency_pending_count++] = (latency_sample_t){
+            .type = cmd->type, .rx_us = cmd->rx_us, .enq_us = cmd->enq_us,
+        };
+    }
+    display_apply_command(cmd);
+    if (slot != NULL && (cmd->flags & DISPLAY_CMD_FLAG_STREAM) && cmd->conn == slot->generation) {
+        slot->stream_consumed_total++;
+    }
+    if (cmd->flags & DISPLAY_CMD_FLAG_FENCE) {
+        // The asset is hidden: nothing reads its flash from here on
+        asset_hides_applied++;
+        if (asset_task_handle != NULL) {
+            xTaskNotifyGive(asset_task_handle);
+        }
+    }
+    display_cmd_queue_pop(q);
+    return true;
+}
+
+// Apply everything queued since the last pass (lvgl_task only). Status changes go first, then
+// the clients take turns one command at a time, starting with a different client every pass, so
+// a client streaming at full rate cannot starve another one's writes.
+static void display_drain_queues(void)
+{
+    static int first_slot = 0;
+    uint32_t consumed_before[GATTS_MAX_CONN];
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        consumed_before[i] = conn_slots[i].stream_consumed_total;
+    }
+
+    while (display_apply_next(&display_cmd_queue, NULL)) {
+    }
+    // Bounded by the queue length, so producers refilling a queue cannot keep the pass going
+    for (int turn = 0; turn < DISPLAY_CMD_QUEUE_LEN; turn++) {
+        bool applied = false;
+        for (int n = 0; n < GATTS_MAX_CONN; n++) {
+            conn_slot_t *slot = &conn_slots[(first_slot + n) % GATTS_MAX_CONN];
+            applied |= display_apply_next(&slot->queue, slot);
+        }
+        if (!applied) {
+            break;
+        }
+    }
+    first_slot = (first_slot + 1) % GATTS_MAX_CONN;
+
+    // One credit notification per client and pass, however many stream frames were drained
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        if (conn_slots[i].stream_consumed_total != consumed_before[i]) {
+            stream_send_credits(&conn_slots[i]);
+        }
+    }
+}
+
+// Wake lvgl_task after publishing work for it (Bluedroid task)
+static void display_wake(void)
+{
+    if (lvgl_task_handle != NULL) {
+        xTaskNotifyGive(lvgl_task_handle);
+    }
+}
+
+// Stamp a command reserved in q and publish it; rx_us is when the triggering write arrived
+static void display_cmd_publish(display_cmd_queue_t *q, display_cmd_t *cmd, uint32_t rx_us)
+{
+    cmd->rx_us = rx_us;
+    cmd->enq_us = (uint32_t)esp_timer_get_time();
+    display_cmd_queue_commit(q);
+    display_wake();
+}
+
+// Producer helpers, called from the Bluedroid callbacks; they never touch LVGL.
+// Writes are decoded straight into a slot of the writing client's queue (gatts_slot), which is
+// only published if the write is valid.
+static esp_gatt_status_t display_post_color(const uint8_t *value, uint16_t len)
+{
+    display_cmd_t *cmd = display_cmd_queue_reserve(&gatts_slot->queue);
+    if (cmd == NULL) {
+        return ESP_GATT_NO_RESOURCES;
+    }
+    if (!display_protocol_color(value, len, cmd)) {
+        ESP_LOGW(TAG, "Invalid color data length: %d", len);
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    display_cmd_publish(&gatts_slot->queue, cmd, gatts_rx_us);
+    return ESP_GATT_OK;
+}
+
+static bool display_post_text(const uint8_t *text, uint16_t len)
+{
+    display_cmd_t *cmd = display_cmd_queue_reserve(&gatts_slot->queue);
+    if (cmd == NULL || !display_protocol_text(text, len, cmd)) {
+        return false;
+    }
+    display_cmd_publish(&gatts_slot->queue, cmd, gatts_rx_us);
+    return true;
+}
+
+static esp_gatt_status_t display_post_frame(const uint8_t *data, uint16_t len, uint8_t flags)
+{
+    display_cmd_t *cmd = display_cmd_queue_reserve(&gatts_slot->queue);
+    if (cmd == NULL) {
+        return ESP_GATT_NO_RESOURCES;
+    }
+
+    cmd_frame_status_t frame_status = display_protocol_frame(data, len, flags, cmd);
+    if (frame_status != CMD_FRAME_OK) {
+        ESP_LOGW(TAG, "Invalid command frame: %s", cmd_frame_status_str(frame_status));
+        return ESP_GATT_INVALID_PDU;
+    }
+    cmd->conn = gatts_slot->generation;
+    display_cmd_publish(&gatts_slot->queue, cmd, gatts_rx_us);
+    return ESP_GATT_OK;
+}
+
+// Post text that lives in the long-write arena; the arena is released once the label has copied it
+static esp_gatt_status_t display_post_text_ref(const char *text, uint16_t len)
+{
+    display_cmd_t *cmd = display_cmd_queue_reserve(&gatts_slot->queue);
+    if (cmd == NULL) {
+        long_write_release(&long_write);
+        return ESP_GATT_NO_RESOURCES;
+    }
+    cmd->type = DISPLAY_CMD_SET_TEXT_REF;
+    cmd->flags = 0;
+    cmd->text_ref.str = text;
+    cmd->text_ref.len = len;
+    display_cmd_publish(&gatts_slot->queue, cmd, gatts_rx_us);
+    return ESP_GATT_OK;
+}
+
+static bool display_post_status(connection_status_t status)
+{
+    display_cmd_t *cmd = display_cmd_queue_reserve(&display_cmd_queue);
+    if (cmd == NULL) {
+        ESP_LOGW(TAG, "Display queue full, status update dropped");
+        TRACE(TRACE_EV_QUEUE_FULL, DISPLAY_CMD_SET_STATUS, 0);
+        return false;
+    }
+    cmd->type = DISPLAY_CMD_SET_STATUS;
+    cmd->flags = 0;
+    cmd->status = (uint8_t)status;
+    display_cmd_publish(&display_cmd_queue, cmd, (uint32_t)esp_timer_get_time());
+    return true;
+}
+
+#if CONFIG_DISPLAY_PERF_PROBE
+// Repaint the full screen repeatedly and report frames per second and CPU idle time
+static void display_perf_probe(void)
+{
+    const int frames = 60;
+    TaskHandle_t idle_task = xTaskGetIdleTaskHandle();
+    configRUN_TIME_COUNTER_TYPE idle_start = ulTaskGetRunTimeCounter(idle_task);
+    int64_t start_us = esp_timer_get_time();
+
+    for (int i = 0; i < frames; i++) {
+        lv_obj_invalidate(display_scene_screen());
+        lv_refr_now(NULL);
+    }
+    // Let the last transfer finish before stopping the clock
+    while (lvgl_flush_in_flight) {
+        xSemaphoreTake(lvgl_flush_done_sem, pdMS_TO_TICKS(10));
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    configRUN_TIME_COUNTER_TYPE idle_us = ulTaskGetRunTimeCounter(idle_task) - idle_start;
+    ESP_LOGI(TAG, "Perf probe: %d full-screen frames in %lld us -> %.1f fps, CPU idle %.1f%%",
+             frames, elapsed_us, frames * 1000000.0 / elapsed_us, 100.0 * idle_us / elapsed_us);
+
+    // Solid-fill engine: alternate two colors so the tile is refilled every time
+    start_us = esp_timer_get_time();
+    for (int i = 0; i < frames; i++) {
+        lcd_fill_rect(0, 0, LCD_H_RES, LCD_V_RES, (i & 1) ? COLOR_BLUE : COLOR_BLACK);
+    }
+    elapsed_us = esp_timer_get_time() - start_us;
+    ESP_LOGI(TAG, "Perf probe: solid fill %lld us per full screen", elapsed_us / frames);
+
+    lv_obj_invalidate(display_scene_screen());
+}
+#endif
+
+// Draw the published image slots straight to the panel, then hand the buffers back and
+// acknowledge with the new byte limit (lvgl_task)
+static void image_draw_slots(void)
+{
+    static uint16_t spi_image_id = 0;
+    static int64_t spi_busy_us = 0;
+
+    uint32_t ready = image_stream_ready(&image_stream);
+    if (ready == 0) {
+        return;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    image_slot_t newest = {0};
+    bool drawn_any = false;
+    for (uint32_t i = 0; i < ready; i++) {
+        const image_slot_t *slot = image_stream_slot(&image_stream, i);
+        if (!image_stream_slot_is_current(&image_stream, slot)) {
+            continue;  // aborted image
+        }
+        lcd_direct_draw(slot->x, slot->y, slot->x + slot->w, slot->y + slot->rows, slot->buf);
+        newest = *slot;
+        drawn_any = true;
+    }
+    // Off the wire before the buffers are reused, and before LVGL flushes again
+    lcd_direct_wait_idle();
+    image_stream_release(&image_stream, ready);
+
+    if (!drawn_any) {
+        return;
+    }
+    if (newest.image_id != spi_image_id) {
+        spi_image_id = newest.image_id;
+        spi_busy_us = 0;
+    }
+    spi_busy_us += esp_timer_get_time() - start_us;
+
+    if (newest.last) {
+        TRACE(TRACE_EV_IMAGE_DRAWN, newest.image_id, newest.end_offset);
+        // BLE throughput counts bytes on the air, pixels per second follow from the ratio
+        int64_t ble_us = image_last_data_us - image_open_us;
+        ESP_LOGI(TAG, "Image %u drawn: %u bytes from %u on the air (%.2fx), BLE %.1f KB/s (%lld ms), "
+                 "SPI %.1f KB/s (%lld us)",
+                 newest.image_id, (unsigned int)newest.end_offset, (unsigned int)image_wire_bytes,
+                 image_wire_bytes > 0 ? (double)newest.end_offset / image_wire_bytes : 0.0,
+                 ble_us > 0 ? image_wire_bytes * 1000000.0 / 1024.0 / ble_us : 0.0, ble_us / 1000,
+                 spi_busy_us > 0 ? newest.end_offset * 1000000.0 / 1024.0 / spi_busy_us : 0.0, spi_busy_us);
+    }
+    image_send_ack(image_owner, newest.image_id, newest.last ? IMAGE_STATE_DRAWN : IMAGE_STATE_RECEIVING,
+                   newest.end_offset, newest.limit);
+}
+
+// Stats characteristic value: the latency entries of the given stages that fit, then the label
+// cache counters, which the entry count in the header leaves out
+static size_t stats_report_encode(uint32_t stage_mask, uint8_t *out, size_t out_max)
+{
+    size_t len = latency_stats_encode(&latency_stats, stage_mask, out, out_max - LABEL_CACHE_REPORT_LEN);
+    label_cache_stats_t cstats;
+    display_scene_get_label_cache_stats(&cstats);
+    return len + label_cache_stats_encode(&cstats, out + len);
+}
+
+// Rebuild the stats characteristic value and notify the end-to-end latencies (lvgl_task only)
+static void latency_publish(void)
+{
+    uint8_t report[LATENCY_REPORT_MAX + LABEL_CACHE_REPORT_LEN];
+    size_t len = stats_report_encode(LATENCY_STAGE_MASK_ALL, report, sizeof(report));
+    portENTER_CRITICAL(&latency_report_lock);
+    memcpy(latency_report, report, len);
+    latency_report_len = len;
+    portEXIT_CRITICAL(&latency_report_lock);
+    latency_reported = latency_recorded;
+
+    // The statistics cover the device, every subscribed client gets them. Notifications carry
+    // only the total stage so they fit the MTU; read for the breakdown.
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        conn_slot_t *slot = &conn_slots[i];
+        if (!slot->in_use || !(slot->cccd_values[CHAR_IDX_STATS] & 0x0001)) {
+            continue;
+        }
+        len = stats_report_encode(1u << LATENCY_STAGE_TOTAL, report, slot->mtu - 3);
+        esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id, profile->char_handles[CHAR_IDX_STATS],
+                                    len, report, false);
+    }
+}
+
+// Copy part of the stats report for a (long) read (Bluedroid task)
+static uint16_t latency_report_read(uint16_t offset, uint8_t *out, uint16_t max_len)
+{
+    uint16_t len = 0;
+    portENTER_CRITICAL(&latency_report_lock);
+    if (offset < latency_report_len) {
+        len = latency_report_len - offset < max_len ? latency_report_len - offset : max_len;
+        memcpy(out, latency_report + offset, len);
+    }
+    portEXIT_CRITICAL(&latency_report_lock);
+    return len;
+}
+
+// Latency bookkeeping after each lv_timer_handler pass (lvgl_task only)
+static void latency_pass_done(void)
+{
+    latency_frame_poll();
+
+    // Nothing left to render: commands that changed no pixels through LVGL end here
+    if (latency_pending_count > 0 && !latency_frame_active && lv_disp_get_default()->inv_p == 0) {
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+        for (int i = 0; i < latency_pending_count; i++) {
+            const latency_sample_t *sample = &latency_pending[i];
+            latency_stats_add(&latency_stats, sample->type, LATENCY_STAGE_PARSE, sample->enq_us - sample->rx_us);
+            latency_stats_add(&latency_stats, sample->type, LATENCY_STAGE_TOTAL, now_us - sample->rx_us);
+        }
+        latency_recorded += latency_pending_count;
+        latency_pending_count = 0;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (latency_recorded != latency_reported && now - latency_report_us >= LATENCY_REPORT_PERIOD_US) {
+        latency_report_us = now;
+        latency_publish();
+    }
+}
+
+// LVGL Task: sole owner of all lv_* objects
+static void lvgl_task(void *pvParameter)
+{
+    ESP_LOGI(TAG, "LVGL task started");
+#if CONFIG_DISPLAY_PERF_PROBE
+    display_perf_probe();
+#endif
+    lv_timer_t *refr_timer = _lv_disp_get_refr_timer(lv_disp_get_default());
+    uint32_t sleep_ms = 0;
+    while (1) {
+        // Sleep until the next LVGL timer is due or a producer publishes work; with nothing
+        // invalidated and no blink running there is no timer at all and the task sleeps until woken
+        TickType_t sleep_ticks = portMAX_DELAY;
+        if (sleep_ms != LV_NO_TIMER_READY) {
+            sleep_ticks = pdMS_TO_TICKS(sleep_ms) > 0 ? pdMS_TO_TICKS(sleep_ms) : 1;
+        }
+        ulTaskNotifyTake(pdTRUE, sleep_ticks);
+        lvgl_wakeups++;
+
+        // Apply everything queued since the last pass, then let LVGL render it as one frame
+        display_drain_queues();
+        image_draw_slots();
+
+        latency_pass_start_us = (uint32_t)esp_timer_get_time();
+        sleep_ms = lv_timer_handler();
+        latency_pass_done();
+
+        // Nothing left to render: stop the refresh timer until display_request_refresh
+        if (lv_disp_get_default()->inv_p == 0) {
+            lv_timer_pause(refr_timer);
+        }
+        // Statistics not yet published need another pass; finished frames wake the task from the ISR
+        if (latency_recorded != latency_reported) {
+            sleep_ms = LV_MIN(sleep_ms, LATENCY_REPORT_PERIOD_US / 1000);
+        }
+    }
+}
+
+// LCD Helper Functions
+void lcd_set_brightness(uint8_t level)
+{
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, LCD_BK_LIGHT_LEDC_CHANNEL, level);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, LCD_BK_LIGHT_LEDC_CHANNEL);
+}
+
+static const char *conn_phy_str(uint8_t phy)
+{
+    return phy == 2 ? "2M" : phy == 3 ? "coded" : "1M";
+}
+
+static conn_slot_t *conn_slot_by_id(uint16_t conn_id)
+{
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        if (conn_slots[i].in_use && conn_slots[i].conn_id == conn_id) {
+            return &conn_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static conn_slot_t *conn_slot_by_bda(const esp_bd_addr_t bda)
+{
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        if (conn_slots[i].in_use && memcmp(conn_slots[i].bda, bda, sizeof(esp_bd_addr_t)) == 0) {
+            return &conn_slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Take a free slot for a new connection, NULL when all are in use (Bluedroid task)
+static conn_slot_t *conn_slot_claim(uint16_t conn_id, const esp_bd_addr_t bda, uint16_t interval)
+{
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        conn_slot_t *slot = &conn_slots[i];
+        if (slot->in_use) {
+            continue;
+        }
+        slot->conn_id = conn_id;
+        memcpy(slot->bda, bda, sizeof(esp_bd_addr_t));
+        slot->mtu = 23;
+        // Fresh subscriptions and flow-control state for the new client
+        memset(slot->cccd_values, 0, sizeof(slot->cccd_values));
+        slot->stream_consumed_base = slot->stream_consumed_total;
+        slot->stream_received = 0;
+        slot->stream_dropped = 0;
+        slot->interval = interval;
+        slot->tx_phy = 1;
+        slot->rx_phy = 1;
+        slot->relaxed = false;
+        slot->last_rx_us = (uint32_t)esp_timer_get_time();
+        slot->throughput_rx_bytes = 0;
+        slot->in_use = true;
+        conn_count++;
+        return slot;
+    }
+    return NULL;
+}
+
+// Start advertising with the fast or the slow interval. Fast advertising backs off on its own
+// after CONFIG_DISPLAY_ADV_FAST_MS.
+static void adv_start(bool fast)
+{
+    adv_params.adv_int_min = fast ? ADV_FAST_INT_MIN : ADV_SLOW_INT_MIN;
+    adv_params.adv_int_max = fast ? ADV_FAST_INT_MAX : ADV_SLOW_INT_MAX;
+    esp_ble_gap_start_advertising(&adv_params);
+    if (adv_fast_timer != NULL) {
+        esp_timer_stop(adv_fast_timer);
+        if (fast) {
+            esp_timer_start_once(adv_fast_timer, CONFIG_DISPLAY_ADV_FAST_MS * 1000LL);
+        }
+    }
+}
+
+// The interval of running advertising cannot change: stop it, ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT
+// starts it again
+static void adv_restart_with(bool fast)
+{
+    adv_restart = fast ? ADV_RESTART_FAST : ADV_RESTART_SLOW;
+    esp_ble_gap_stop_advertising();
+}
+
+// End of the fast advertising period (esp_timer task)
+static void adv_fast_expired(void *arg)
+{
+    adv_restart_with(false);
+}
+
+// Put new manufacturer data into the advertisement, running or not. Bluedroid copies it in the
+// call; before Bluedroid is enabled the call fails and ESP_GATTS_REG_EVT picks it up instead.
+// New state snapshot (app_main at boot, then state_task). esp_ble_gap_config_adv_data copies the
+// data before returning, so the advertisement can be configured from a copy on this task's stack.
+static void adv_update_state(const uint8_t manufacturer[ADV_STATE_LEN])
+{
+    portENTER_CRITICAL(&adv_state_lock);
+    bool changed = memcmp(manufacturer, adv_state_latest, ADV_STATE_LEN) != 0;
+    memcpy(adv_state_latest, manufacturer, ADV_STATE_LEN);
+    bool ready = adv_ready;
+    portEXIT_CRITICAL(&adv_state_lock);
+    if (!changed || !ready) {
+        return;  // before the handshake finishes, adv_boot_configured() picks it up
+    }
+    uint8_t data[ADV_STATE_LEN];
+    memcpy(data, manufacturer, ADV_STATE_LEN);
+    esp_ble_adv_data_t update = adv_data;
+    update.p_manufacturer_data = data;
+    esp_ble_gap_config_adv_data(&update);
+}
+
+// Boot advertisement configured (Bluedroid task): from now on updates go straight to the stack,
+// and one that arrived after REG_EVT took its snapshot is configured here
+static void adv_boot_configured(void)
+{
+    portENTER_CRITICAL(&adv_state_lock);
+    adv_ready = true;
+    bool changed = memcmp(adv_manufacturer, adv_state_latest, ADV_STATE_LEN) != 0;
+    memcpy(adv_manufacturer, adv_state_latest, ADV_STATE_LEN);
+    portEXIT_CRITICAL(&adv_state_lock);
+    if (changed) {
+        esp_ble_gap_config_adv_data(&adv_data);
+    }
+}
+
+// BLE Event Handlers
+static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    switch (event) {
+    case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+    case ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT:
+        // Start once both are configured at boot; later state updates change the running advertisement
+        if (adv_config_done != 0) {
+            adv_config_done &= event == ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT ? ~ADV_CONFIG_FLAG : ~SCAN_RSP_CONFIG_FLAG;
+            if (adv_config_done == 0) {
+                adv_boot_configured();
+                adv_start(true);
+            }
+        }
+        break;
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+        TRACE(TRACE_EV_ADV_START, param->adv_start_cmpl.status, 0);
+        if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGE(TAG, "Advertising start failed");
+        } else {
+            ESP_LOGI(TAG, "Advertising as '%s', service 0x%04X, every %d-%d ms", DEVICE_NAME, GATTS_SERVICE_UUID,
+                     adv_params.adv_int_min * 5 / 8, adv_params.adv_int_max * 5 / 8);
+            boot_mark(BOOT_PHASE_ADVERTISING);
+            ESP_LOGD(TAG, "");
+            ESP_LOGD(TAG, "╔════════════════════════════════════════════╗");
+            ESP_LOGD(TAG, "║  BLE ADVERTISING STARTED                   ║");
+            ESP_LOGD(TAG, "╚════════════════════════════════════════════╝");
+            ESP_LOGD(TAG, "  Device is now visible to Flutter app!");
+            ESP_LOGD(TAG, "  Look for: 'SusanESP'");
+            ESP_LOGD(TAG, "  Service UUID: 0x00FF");
+            ESP_LOGD(TAG, "");
+            // Update status indicator to flashing blue (advertising), unless a client is connected
+            if (conn_count == 0) {
+                display_post_status(STATUS_ADVERTISING);
+            }
+        }
+        break;
+    case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT: {
+        int restart = adv_restart;
+        adv_restart = ADV_RESTART_NONE;
+        if (param->adv_stop_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGE(TAG, "Advertising stop failed");
+        } else {
+            ESP_LOGI(TAG, "Stop adv successfully");
+        }
+        // A client may have taken the last slot in the meantime
+        if (restart != ADV_RESTART_NONE && conn_count < GATTS_MAX_CONN) {
+            adv_start(restart == ADV_RESTART_FAST);
+        }
+        break;
+    }
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT: {
+        TRACE(TRACE_EV_CONN_PARAMS, param->update_conn_params.latency, param->update_conn_params.conn_int);
+        if (param->update_conn_params.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGW(TAG, "Connection parameter update refused, status %d", param->update_conn_params.status);
+            break;
+        }
+        conn_slot_t *slot = conn_slot_by_bda(param->update_conn_params.bda);
+        if (slot != NULL) {
+            slot->interval = param->update_conn_params.conn_int;
+        }
+        ESP_LOGI(TAG, "Connection parameters of " ESP_BD_ADDR_STR ": interval %.2f ms, latency %d, timeout %d ms",
+                 ESP_BD_ADDR_HEX(param->update_conn_params.bda), param->update_conn_params.conn_int * 1.25,
+                 param->update_conn_params.latency, param->update_conn_params.timeout * 10);
+        break;
+    }
+    case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+        if (param->pkt_data_length_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGW(TAG, "Data length extension refused, status %d", param->pkt_data_length_cmpl.status);
+        } else {
+            ESP_LOGI(TAG, "Data length: rx %d, tx %d bytes", param->pkt_data_length_cmpl.params.rx_len,
+                     param->pkt_data_length_cmpl.params.tx_len);
+        }
+        break;
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT: {
+        conn_slot_t *slot = conn_slot_by_bda(param->phy_update.bda);
+        if (slot == NULL) {
+            break;
+        }
+        if (param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+            slot->tx_phy = param->phy_update.tx_phy;
+            slot->rx_phy = param->phy_update.rx_phy;
+        }
+        ESP_LOGI(TAG, "PHY of conn %d: tx %s, rx %s, status %d", slot->conn_id, conn_phy_str(slot->tx_phy),
+                 conn_phy_str(slot->rx_phy), param->phy_update.status);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static esp_gatt_status_t gatts_long_write_status(long_write_status_t status)
+{
+    switch (status) {
+    case LONG_WRITE_OK:           return ESP_GATT_OK;
+    case LONG_WRITE_ERR_BUSY:     return ESP_GATT_BUSY;
+    case LONG_WRITE_ERR_HANDLE:   return ESP_GATT_PREPARE_Q_FULL;
+    case LONG_WRITE_ERR_OFFSET:   return ESP_GATT_INVALID_OFFSET;
+    case LONG_WRITE_ERR_OVERFLOW: return ESP_GATT_INVALID_ATTR_LEN;
+    default:                      return ESP_GATT_ERROR;
+    }
+}
+
+// Characteristic whose CCCD is being added (descriptor events do not carry the characteristic)
+static int gatts_char_adding_cccd = -1;
+
+// Add characteristic gatts_char_defs[idx] to the display service
+static void gatts_add_char(int idx)
+{
+    esp_bt_uuid_t char_uuid = {
+        .len = ESP_UUID_LEN_16,
+        .uuid.uuid16 = gatts_char_defs[idx].uuid,
+    };
+    esp_ble_gatts_add_char(gl_profile_tab[PROFILE_APP_IDX].service_handle, &char_uuid,
+                           gatts_char_defs[idx].perm, gatts_char_defs[idx].property,
+                           NULL, NULL);
+}
+
+static int gatts_char_index_by_uuid(uint16_t uuid)
+{
+    for (int i = 0; i < CHAR_IDX_NUM; i++) {
+        if (gatts_char_defs[i].uuid == uuid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int gatts_char_index_by_handle(uint16_t handle)
+{
+    for (int i = 0; i < CHAR_IDX_NUM; i++) {
+        if (gl_profile_tab[PROFILE_APP_IDX].char_handles[i] == handle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int gatts_cccd_index_by_handle(uint16_t handle)
+{
+    for (int i = 0; i < CHAR_IDX_NUM; i++) {
+        if (gl_profile_tab[PROFILE_APP_IDX].cccd_handles[i] != 0 &&
+            gl_profile_tab[PROFILE_APP_IDX].cccd_handles[i] == handle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Link characteristic value of a connection, see LINK_INFO_LEN
+static uint16_t link_info_encode(const conn_slot_t *slot, uint8_t *out)
+{
+    const uint16_t fields[] = {slot->mtu, GATTS_LOCAL_MTU, slot->mtu - 3, LONG_WRITE_ARENA_SIZE};
+    out[0] = GATTS_LINK_VERSION;
+    out[1] = 0;
+    for (int i = 0; i < 4; i++) {
+        out[2 + 2 * i] = fields[i] & 0xFF;
+        out[3 + 2 * i] = fields[i] >> 8;
+    }
+    return LINK_INFO_LEN;
+}
+
+// Notify the client of the link limits (after an MTU exchange, or on subscription)
+static void link_send_info(conn_slot_t *slot)
+{
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    if (!(slot->cccd_values[CHAR_IDX_LINK] & 0x0001)) {
+        return;
+    }
+    uint8_t value[LINK_INFO_LEN];
+    link_info_encode(slot, value);
+    esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id, profile->char_handles[CHAR_IDX_LINK],
+                                sizeof(value), value, false);
+}
+
+// Credits value: uint32 credit limit (stream frames the client may have sent since connecting)
+// followed by uint32 frames dropped since connecting, both little-endian. A dropped frame never
+// reaches the queue, so its credit is returned right away.
+static uint16_t stream_credits_encode(const conn_slot_t *slot, uint8_t *out)
+{
+    uint32_t dropped = slot->stream_dropped;
+    uint32_t credit_limit = (slot->stream_consumed_total - slot->stream_consumed_base) + dropped + STREAM_CREDIT_WINDOW;
+    for (int i = 0; i < 4; i++) {
+        out[i] = (credit_limit >> (8 * i)) & 0xFF;
+        out[4 + i] = (dropped >> (8 * i)) & 0xFF;
+    }
+    return 8;
+}
+
+// Notify the client of its new credit limit (lvgl_task after draining, or on subscription)
+static void stream_send_credits(conn_slot_t *slot)
+{
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    if (!slot->in_use || !(slot->cccd_values[CHAR_IDX_CREDITS] & 0x0001)) {
+        return;
+    }
+    uint8_t value[8];
+    uint16_t len = stream_credits_encode(slot, value);
+    esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id, profile->char_handles[CHAR_IDX_CREDITS],
+                                len, value, false);
+}
+
+// Image acknowledgement: uint16 image id, uint8 state, uint8 reserved, uint32 bytes drawn,
+// uint32 byte limit (pixel bytes the client may have sent for this image), little-endian
+static void image_send_ack(conn_slot_t *slot, uint16_t image_id, uint8_t state, uint32_t drawn, uint32_t limit)
+{
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    if (slot == NULL || !slot->in_use || !(slot->cccd_values[CHAR_IDX_IMAGE] & 0x0001)) {
+        return;
+    }
+    uint8_t value[12];
+    value[0] = image_id & 0xFF;
+    value[1] = image_id >> 8;
+    value[2] = state;
+    value[3] = 0;
+    for (int i = 0; i < 4; i++) {
+        value[4 + i] = (drawn >> (8 * i)) & 0xFF;
+        value[8 + i] = (limit >> (8 * i)) & 0xFF;
+    }
+    esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id, profile->char_handles[CHAR_IDX_IMAGE],
+                                sizeof(value), value, false);
+}
+
+// Decode Q565 data straight into the image slots; the decoder never needs more than the slot
+// being filled. A corrupt stream is reported as too long, the image is dropped either way.
+static image_stream_status_t image_decode_append(const uint8_t *data, size_t len)
+{
+    while (len > 0 || image_codec_decoder_pending(&image_decoder)) {
+        size_t space;
+        uint8_t *dst = image_stream_fill_ptr(&image_stream, &space);
+        if (dst == NULL) {
+            return image_stream.open ? IMAGE_STREAM_ERR_OVERRUN : IMAGE_STREAM_ERR_TOO_LONG;
+        }
+        size_t produced;
+        image_codec_status_t status = image_codec_decode(&image_decoder, &data, &len, dst,
+                                                         space / IMAGE_STREAM_BPP, &produced);
+        image_stream_fill_commit(&image_stream, produced * IMAGE_STREAM_BPP);
+        if (status != IMAGE_CODEC_OK) {
+            ESP_LOGW(TAG, "Image decode failed: %s", image_codec_status_str(status));
+            return IMAGE_STREAM_ERR_TOO_LONG;
+        }
+    }
+    return IMAGE_STREAM_OK;
+}
+
+// Image characteristic write: OPEN a window, stream DATA into it, or ABORT it. The window
+// belongs to the client that opened it until the image is complete.
+static esp_gatt_status_t image_handle_write(const uint8_t *value, uint16_t len)
+{
+    if (len == 0) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    if (image_stream.open && image_owner != gatts_slot) {
+        return ESP_GATT_BUSY;
+    }
+
+    switch (value[0]) {
+    case IMAGE_OP_OPEN: {
+        if (len != 9 && len != 10) {
+            return ESP_GATT_INVALID_ATTR_LEN;
+        }
+        uint8_t encoding = (len == 10) ? value[9] : IMAGE_ENCODING_RAW;
+        if (encoding != IMAGE_ENCODING_RAW && encoding != IMAGE_ENCODING_Q565) {
+            return ESP_GATT_OUT_OF_RANGE;
+        }
+        uint16_t x = value[1] | (value[2] << 8);
+        uint16_t y = value[3] | (value[4] << 8);
+        uint16_t w = value[5] | (value[6] << 8);
+        uint16_t h = value[7] | (value[8] << 8);
+        uint16_t image_id;
+        uint32_t limit;
+        image_stream_status_t status = image_stream_open(&image_stream, x, y, w, h, &image_id, &limit);
+        if (status != IMAGE_STREAM_OK) {
+            ESP_LOGW(TAG, "Image window %ux%u at (%u,%u) rejected: %s", w, h, x, y, image_stream_status_str(status));
+            return status == IMAGE_STREAM_ERR_BUSY ? ESP_GATT_BUSY : ESP_GATT_OUT_OF_RANGE;
+        }
+        image_owner = gatts_slot;
+        image_open_us = esp_timer_get_time();
+        image_wire_bytes = 0;
+        image_encoding = encoding;
+        image_codec_decoder_init(&image_decoder, (uint32_t)w * h);
+        ESP_LOGI(TAG, "Image %u opened: %ux%u at (%u,%u), %u bytes, %s, initial limit %u",
+                 image_id, w, h, x, y, (unsigned int)(w * h * IMAGE_STREAM_BPP),
+                 encoding == IMAGE_ENCODING_Q565 ? "Q565" : "raw", (unsigned int)limit);
+        TRACE(TRACE_EV_IMAGE_OPEN, image_id, (uint32_t)w << 16 | h);
+        image_send_ack(gatts_slot, image_id, IMAGE_STATE_RECEIVING, 0, limit);
+        return ESP_GATT_OK;
+    }
+    case IMAGE_OP_DATA: {
+        image_last_data_us = esp_timer_get_time();
+        image_wire_bytes += len - 1;
+        image_stream_status_t status = (image_encoding == IMAGE_ENCODING_Q565)
+                                       ? image_decode_append(value + 1, len - 1)
+                                       : image_stream_append(&image_stream, value + 1, len - 1);
+        if (status != IMAGE_STREAM_OK) {
+            // Writes without response carry no status, so report the failure and drop the image
+            uint16_t image_id = image_stream_current_id(&image_stream);
+            ESP_LOGW(TAG, "Image %u data rejected: %s", image_id, image_stream_status_str(status));
+            TRACE(TRACE_EV_IMAGE_ERROR, image_id, status);
+            if (status != IMAGE_STREAM_ERR_NOT_OPEN) {
+                image_stream_abort(&image_stream);
+            }
+            image_send_ack(gatts_slot, image_id, IMAGE_STATE_ERROR, 0, 0);
+            return ESP_GATT_OUT_OF_RANGE;
+        }
+        // Completed slots are drawn by lvgl_task
+        display_wake();
+        return ESP_GATT_OK;
+    }
+    case IMAGE_OP_ABORT:
+        if (image_owner != gatts_slot) {
+            return ESP_GATT_BUSY;  // the last image may still be drawing
+        }
+        ESP_LOGI(TAG, "Image %u aborted", image_stream_current_id(&image_stream));
+        image_stream_abort(&image_stream);
+        return ESP_GATT_OK;
+    default:
+        return ESP_GATT_REQ_NOT_SUPPORTED;
+    }
+}
+
+// Asset status: uint8 op, uint8 asset_store_status_t, uint16 reserved, uint32 bytes written,
+// uint32 byte limit (data bytes the client may have sent), little-endian
+static void asset_send_status(conn_slot_t *slot, uint8_t op, asset_store_status_t status, uint32_t received,
+                              uint32_t limit)
+{
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    if (!slot->in_use || !(slot->cccd_values[CHAR_IDX_ASSET] & 0x0001)) {
+        return;
+    }
+    uint8_t value[12];
+    value[0] = op;
+    value[1] = (uint8_t)status;
+    value[2] = 0;
+    value[3] = 0;
+    for (int i = 0; i < 4; i++) {
+        value[4 + i] = (received >> (8 * i)) & 0xFF;
+        value[8 + i] = (limit >> (8 * i)) & 0xFF;
+    }
+    esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id, profile->char_handles[CHAR_IDX_ASSET],
+                                sizeof(value), value, false);
+}
+
+// Query result: uint8 op, uint8 status, uint8 key count, uint8 reserved, then one bit per queried
+// key (bit i of byte i / 8), set when the key is stored
+static void asset_send_query(conn_slot_t *slot, const uint8_t *keys, size_t count)
+{
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    if (!slot->in_use || !(slot->cccd_values[CHAR_IDX_ASSET] & 0x0001)) {
+        return;
+    }
+    uint8_t value[4 + (ASSET_QUERY_MAX + 7) / 8] = {0};
+    value[0] = ASSET_OP_QUERY;
+    value[1] = ASSET_STORE_OK;
+    value[2] = (uint8_t)count;
+    xSemaphoreTake(asset_lock, portMAX_DELAY);
+    for (size_t i = 0; i < count; i++) {
+        uint8_t type;
+        uint32_t size;
+        if (asset_store_find(&asset_store, keys + i * ASSET_KEY_LEN, &type, &size) != NULL) {
+            value[4 + i / 8] |= 1 << (i % 8);
+        }
+    }
+    xSemaphoreGive(asset_lock);
+    esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id, profile->char_handles[CHAR_IDX_ASSET],
+                                4 + (count + 7) / 8, value, false);
+}
+
+static uint32_t asset_read_le32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Key as 16 hex digits for the log
+static const char *asset_key_str(const uint8_t key[ASSET_KEY_LEN], char buf[2 * ASSET_KEY_LEN + 1])
+{
+    for (int i = 0; i < ASSET_KEY_LEN; i++) {
+        snprintf(buf + 2 * i, 3, "%02x", key[i]);
+    }
+    return buf;
+}
+
+// Asset flash I/O, called by asset_store from asset_task
+static bool asset_flash_write(uint32_t offset, const void *data, size_t len, void *ctx)
+{
+    // Writes and erases through esp_partition also invalidate the cache of the mapped range
+    return esp_partition_write(asset_partition, offset, data, len) == ESP_OK;
+}
+
+static bool asset_flash_erase(uint32_t offset, size_t len, void *ctx)
+{
+    return esp_partition_erase_range(asset_partition, offset, len) == ESP_OK;
+}
+
+// Key of an asset: the data is hashed straight out of the mapping
+static void asset_hash(const uint8_t *data, size_t len, uint8_t key[ASSET_KEY_LEN], void *ctx)
+{
+    uint8_t digest[32];
+    mbedtls_sha256(data, len, digest, 0);
+    memcpy(key, digest, ASSET_KEY_LEN);
+}
+
+// Ring item header: the connection slot that wrote the item and that slot's generation
+static void asset_item_header(uint8_t *item)
+{
+    item[0] = (uint8_t)(gatts_slot - conn_slots);
+    item[1] = gatts_slot->generation & 0xFF;
+    item[2] = gatts_slot->generation >> 8;
+}
+
+// Flash writer: applies queued asset writes in order. Erases take tens of milliseconds per
+// sector, which is why none of this runs in the Bluedroid task. An upload belongs to the
+// connection that began it; once that connection is gone (its slot's generation moved on)
+// the upload is abandoned and items it still had queued are dropped.
+static void asset_task(void *pvParameter)
+{
+    uint32_t limit = 0;
+    int owner = -1;                  // slot of the open upload
+    uint16_t owner_generation = 0;   // and its generation at BEGIN
+    char key_str[2 * ASSET_KEY_LEN + 1];
+    while (1) {
+        size_t item_len;
+        uint8_t *item = xRingbufferReceive(asset_ring, &item_len, portMAX_DELAY);
+        int from = item[0];
+        uint16_t generation = item[1] | (item[2] << 8);
+        conn_slot_t *slot = &conn_slots[from];
+        const uint8_t *value = item + ASSET_ITEM_HEADER;
+        size_t len = item_len - ASSET_ITEM_HEADER;
+        asset_store_status_t status;
+        const uint8_t *key = asset_store.upload.key;
+
+        if (asset_store.open && conn_slots[owner].generation != owner_generation) {
+            ESP_LOGW(TAG, "Asset %s upload abandoned, its client disconnected", asset_key_str(key, key_str));
+            asset_store_abort(&asset_store);
+        }
+        if (generation != slot->generation) {
+            // Written by a client that has disconnected since; a new client may hold the slot now
+            if (value[0] == ASSET_OP_ERASE) {
+                atomic_fetch_sub(&asset_erases_pending, 1);
+            }
+            vRingbufferReturnItem(asset_ring, item);
+            continue;
+        }
+
+        if (asset_store.open && from != owner) {
+            // Another client's upload is in progress: it cannot be replaced, written or erased
+            switch (value[0]) {
+            case ASSET_OP_ERASE:
+                atomic_fetch_sub(&asset_erases_pending, 1);
+                asset_send_status(slot, value[0], ASSET_STORE_ERR_BUSY, 0, 0);
+                break;
+            case ASSET_OP_BEGIN:
+                asset_send_status(slot, value[0], ASSET_STORE_ERR_BUSY, 0, 0);
+                break;
+            case ASSET_OP_FINISH:
+                asset_send_status(slot, value[0], ASSET_STORE_ERR_NOT_OPEN, 0, 0);
+                break;
+            case ASSET_OP_QUERY:
+                asset_send_query(slot, value + 1, (len - 1) / ASSET_KEY_LEN);
+                break;
+            }
+            vRingbufferReturnItem(asset_ring, item);
+            continue;
+        }
+
+        switch (value[0]) {
+        case ASSET_OP_BEGIN: {
+            key = value + 1;
+            uint32_t size = asset_read_le32(value + 10);
+            asset_begin_us = esp_timer_get_time();
+            status = asset_store_begin(&asset_store, key, value[9], size);
+            if (status == ASSET_STORE_ERR_DUPLICATE) {
+                ESP_LOGI(TAG, "Asset %s already stored", asset_key_str(key, key_str));
+            } else if (status != ASSET_STORE_OK) {
+                ESP_LOGW(TAG, "Asset %s of %u bytes rejected: %s", asset_key_str(key, key_str), (unsigned int)size,
+                         asset_store_status_str(status));
+            }
+            limit = status == ASSET_STORE_OK ? ASSET_WINDOW : 0;
+            owner = from;
+            owner_generation = generation;
+            asset_send_status(slot, ASSET_OP_BEGIN, status, 0, limit);
+            break;
+        }
+        case ASSET_OP_DATA:
+            status = asset_store_write(&asset_store, asset_read_le32(value + 1), value + 5, len - 5);
+            if (status == ASSET_STORE_ERR_NOT_OPEN) {
+                // The rest of a failed or aborted upload, already reported
+            } else if (status != ASSET_STORE_OK) {
+                ESP_LOGW(TAG, "Asset %s data rejected: %s", asset_key_str(key, key_str), asset_store_status_str(status));
+                asset_send_status(slot, ASSET_OP_DATA, status, asset_store_received(&asset_store), 0);
+            } else if (asset_store_received(&asset_store) + ASSET_WINDOW / 2 >= limit) {
+                // Grant more once half of the window is written, not after every chunk
+                limit = asset_store_received(&asset_store) + ASSET_WINDOW;
+                asset_send_status(slot, ASSET_OP_DATA, status, asset_store_received(&asset_store), limit);
+            }
+            break;
+        case ASSET_OP_FINISH: {
+            uint32_t size = asset_store_received(&asset_store);
+            xSemaphoreTake(asset_lock, portMAX_DELAY);
+            status = asset_store_finish(&asset_store);
+            xSemaphoreGive(asset_lock);
+            if (status == ASSET_STORE_OK) {
+                int64_t elapsed_us = esp_timer_get_time() - asset_begin_us;
+                asset_store_stats_t stats;
+                asset_store_get_stats(&asset_store, &stats);
+                ESP_LOGI(TAG, "Asset %s stored: %u bytes in %lld ms, %u assets, %u/%u bytes used",
+                         asset_key_str(key, key_str), (unsigned int)size, elapsed_us / 1000,
+                         (unsigned int)stats.assets, (unsigned int)stats.used, (unsigned int)stats.capacity);
+            } else {
+                ESP_LOGW(TAG, "Asset %s not stored: %s", asset_key_str(key, key_str), asset_store_status_str(status));
+            }
+            asset_send_status(slot, ASSET_OP_FINISH, status, size, 0);
+            break;
+        }
+        case ASSET_OP_ABORT:
+            asset_store_abort(&asset_store);
+            break;
+        case ASSET_OP_ERASE: {
+            uint32_t fence = asset_read_le32(value + 1);
+            int64_t deadline_us = esp_timer_get_time() + ASSET_HIDE_TIMEOUT_MS * 1000LL;
+            while ((int32_t)(asset_hides_applied - fence) < 0 && esp_timer_get_time() < deadline_us) {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            }
+            if ((int32_t)(asset_hides_applied - fence) >= 0) {
+                xSemaphoreTake(asset_lock, portMAX_DELAY);
+                status = asset_store_erase_all(&asset_store);
+                xSemaphoreGive(asset_lock);
+                ESP_LOGI(TAG, "Assets erased: %s", asset_store_status_str(status));
+            } else {
+                ESP_LOGW(TAG, "Shown asset not hidden in time, erase skipped");
+                status = ASSET_STORE_ERR_BUSY;
+            }
+            atomic_fetch_sub(&asset_erases_pending, 1);
+            asset_send_status(slot, ASSET_OP_ERASE, status, 0, 0);
+            break;
+        }
+        case ASSET_OP_QUERY:
+            asset_send_query(slot, value + 1, (len - 1) / ASSET_KEY_LEN);
+            break;
+        }
+        vRingbufferReturnItem(asset_ring, item);
+    }
+}
+
+// Hide any shown asset before its flash is erased (Bluedroid task); false when the queue is full
+static bool display_post_asset_hidden(void)
+{
+    display_cmd_t *cmd = display_cmd_queue_reserve(&display_cmd_queue);
+    if (cmd == NULL) {
+        return false;
+    }
+    cmd->type = DISPLAY_CMD_APPLY_FRAME;
+    cmd->flags = DISPLAY_CMD_FLAG_FENCE;
+    cmd->frame.fields = CMD_FIELD_ASSET;
+    cmd->frame.asset_visible = 0;
+    display_cmd_publish(&display_cmd_queue, cmd, gatts_rx_us);
+    return true;
+}
+
+// ERASE: post the hide fence, then queue the erase with the fence it waits for (Bluedroid task)
+static esp_gatt_status_t asset_queue_erase(void)
+{
+    atomic_fetch_add(&asset_erases_pending, 1);
+    if (!display_post_asset_hidden()) {
+        atomic_fetch_sub(&asset_erases_pending, 1);
+        return ESP_GATT_NO_RESOURCES;
+    }
+    uint32_t fence = ++asset_hides_posted;
+    uint8_t *item;
+    if (xRingbufferSendAcquire(asset_ring, (void **)&item, ASSET_ITEM_HEADER + 5, 0) != pdTRUE) {
+        // The asset stays hidden; the fence is applied with nobody waiting for it
+        atomic_fetch_sub(&asset_erases_pending, 1);
+        return ESP_GATT_NO_RESOURCES;
+    }
+    asset_item_header(item);
+    item[ASSET_ITEM_HEADER] = ASSET_OP_ERASE;
+    for (int i = 0; i < 4; i++) {
+        item[ASSET_ITEM_HEADER + 1 + i] = (fence >> (8 * i)) & 0xFF;
+    }
+    xRingbufferSendComplete(asset_ring, item);
+    return ESP_GATT_OK;
+}
+
+// Asset characteristic write: check the length and queue it for asset_task
+static esp_gatt_status_t asset_handle_write(const uint8_t *value, uint16_t len)
+{
+    if (asset_ring == NULL) {
+        return ESP_GATT_REQ_NOT_SUPPORTED;
+    }
+    if (len == 0) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    switch (value[0]) {
+    case ASSET_OP_BEGIN:
+        if (len != 14) {
+            return ESP_GATT_INVALID_ATTR_LEN;
+        }
+        break;
+    case ASSET_OP_DATA:
+        if (len < 5) {
+            return ESP_GATT_INVALID_ATTR_LEN;
+        }
+        break;
+    case ASSET_OP_QUERY:
+        if (len < 1 + ASSET_KEY_LEN || (len - 1) % ASSET_KEY_LEN != 0 || (len - 1) / ASSET_KEY_LEN > ASSET_QUERY_MAX) {
+            return ESP_GATT_INVALID_ATTR_LEN;
+        }
+        break;
+    case ASSET_OP_ERASE:
+        if (len != 1) {
+            return ESP_GATT_INVALID_ATTR_LEN;
+        }
+        return asset_queue_erase();
+    case ASSET_OP_FINISH:
+    case ASSET_OP_ABORT:
+        break;
+    default:
+        return ESP_GATT_REQ_NOT_SUPPORTED;
+    }
+    // Queued behind the writing client's slot and generation.
+    // A dropped DATA write shows up as an offset error on the next one.
+    uint8_t *item;
+    if (xRingbufferSendAcquire(asset_ring, (void **)&item, ASSET_ITEM_HEADER + len, 0) != pdTRUE) {
+        return ESP_GATT_NO_RESOURCES;
+    }
+    asset_item_header(item);
+    memcpy(item + ASSET_ITEM_HEADER, value, len);
+    xRingbufferSendComplete(asset_ring, item);
+    return ESP_GATT_OK;
+}
 
-// LVGL Tick Callback
-#if LV_TICK_CUSTOM
-static uint32_t lvgl_tick_get_cb(void)
+// Ask the central for the fast or the relaxed connection parameters. It may pick any interval in
+// the range or refuse; ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT reports what the link ends up using.
+static void conn_request_params(conn_slot_t *slot, bool relaxed)
 {
-    return esp_timer_get_time() / 1000;
+    esp_ble_conn_update_params_t params = {
+        .min_int = relaxed ? CONFIG_DISPLAY_CONN_INTERVAL_IDLE : CONN_FAST_MIN_INTERVAL,
+        .max_int = relaxed ? CONFIG_DISPLAY_CONN_INTERVAL_IDLE : CONFIG_DISPLAY_CONN_INTERVAL_FAST,
+        .latency = relaxed ? CONN_IDLE_LATENCY : 0,
+        .timeout = CONN_TIMEOUT,
+    };
+    memcpy(params.bda, slot->bda, sizeof(esp_bd_addr_t));
+    slot->relaxed = relaxed;
+    esp_err_t ret = esp_ble_gap_update_conn_params(&params);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Connection parameter update failed: %s", esp_err_to_name(ret));
+    }
 }
-#endif
 
-// LVGL Task
-static void lvgl_task(void *pvParameter)
+// New connection (Bluedroid task): fast interval, 2M PHY and the longest link layer packets.
+// The idle timer runs while any client is connected.
+static void conn_start(conn_slot_t *slot)
 {
-    ESP_LOGI(TAG, "LVGL task started");
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(10));
-        lv_timer_handler();
+    conn_request_params(slot, false);
+    esp_ble_gap_set_pkt_data_len(slot->bda, CONN_DATA_LEN);
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    esp_ble_gap_set_preferred_phy(slot->bda, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                  ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+    if (conn_count == 1 && conn_idle_timer != NULL) {
+        esp_timer_start_periodic(conn_idle_timer, CONN_IDLE_CHECK_US);
     }
 }
 
-// LCD Helper Functions
-void lcd_fill_rect(esp_lcd_panel_handle_t panel_handle, int x, int y, int width, int height, uint16_t color)
+// Connection gone (Bluedroid task): free its slot and whatever shared resource it held
+static void conn_stop(conn_slot_t *slot)
 {
-    uint16_t *line_buf = malloc(width * sizeof(uint16_t));
-    if (line_buf == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate line buffer");
-        return;
+    if (throughput_tx_running && throughput_tx_slot == slot) {
+        throughput_tx_cancel = true;
     }
-
-    for (int i = 0; i < width; i++) {
-        line_buf[i] = color;
+    if (long_write_owner == slot) {
+        long_write_cancel(&long_write);
+        long_write_owner = NULL;
     }
-
-    for (int i = 0; i < height; i++) {
-        esp_lcd_panel_draw_bitmap(panel_handle, x, y + i, x + width, y + i + 1, line_buf);
+    if (image_owner == slot) {
+        image_stream_abort(&image_stream);
+        image_owner = NULL;
+    }
+    // Frames of this client still queued are applied but no longer counted, so the base the
+    // next client takes at connect cannot move under it. asset_task abandons an upload this
+    // client began when it sees the generation change.
+    slot->generation++;
+    slot->relaxed = false;
+    slot->in_use = false;
+    conn_count--;
+    if (conn_count == 0 && conn_idle_timer != NULL) {
+        esp_timer_stop(conn_idle_timer);
     }
-
-    free(line_buf);
 }
 
-void lcd_clear_screen(uint16_t color)
+// Client write (Bluedroid task): back to the fast interval if the link was relaxed
+static void conn_note_activity(conn_slot_t *slot)
 {
-    if (screen_obj) {
-        // Extract RGB565 components
-        uint8_t r5 = (color >> 11) & 0x1F;
-        uint8_t g6 = (color >> 5) & 0x3F;
-        uint8_t b5 = color & 0x1F;
-
-        // Convert RGB565 to RGB888 for LVGL
-        uint8_t r8 = (r5 << 3) | (r5 >> 2);  // Replicate top bits
-        uint8_t g8 = (g6 << 2) | (g6 >> 4);
-        uint8_t b8 = (b5 << 3) | (b5 >> 2);
-
-        // Create RGB888 hex value (driver handles BGR conversion)
-        uint32_t rgb888 = (r8 << 16) | (g8 << 8) | b8;
-
-        lv_color_t lv_color = lv_color_hex(rgb888);
-        lv_obj_set_style_bg_color(screen_obj, lv_color, 0);
-        current_color = color;
-
-        // Force LVGL to refresh the display
-        lv_refr_now(NULL);
-
-        ESP_LOGI(TAG, "Screen cleared to color: RGB565=0x%04X, RGB888=0x%06X", color, (unsigned int)rgb888);
+    slot->last_rx_us = gatts_rx_us;
+    if (slot->relaxed) {
+        conn_request_params(slot, false);
     }
 }
 
-void lcd_clear_screen_rgb888(uint32_t rgb888)
+// Idle timer (esp_timer task): relax each connection once its client stopped writing
+static void conn_idle_check(void *arg)
 {
-    if (screen_obj) {
-        // Use RGB888 directly - LCD driver handles BGR conversion automatically
-        lv_color_t lv_color = lv_color_hex(rgb888);
-        lv_obj_set_style_bg_color(screen_obj, lv_color, 0);
-
-        // Force LVGL to refresh the display
-        lv_refr_now(NULL);
-
-        ESP_LOGI(TAG, "Screen cleared to color: RGB888=0x%06X", (unsigned int)rgb888);
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        conn_slot_t *slot = &conn_slots[i];
+        if (!slot->in_use || slot->relaxed || (throughput_tx_running && throughput_tx_slot == slot)) {
+            continue;
+        }
+        uint32_t idle_us = now_us - slot->last_rx_us;
+        if (idle_us >= CONFIG_DISPLAY_CONN_IDLE_MS * 1000u) {
+            ESP_LOGI(TAG, "Conn %d idle for %u ms, relaxing the connection", slot->conn_id,
+                     (unsigned int)(idle_us / 1000));
+            conn_request_params(slot, true);
+        }
     }
 }
 
-void lcd_display_text(const char *text)
+// Result of a throughput run: uint8 op, uint8 direction, uint8 tx PHY, uint8 rx PHY, uint32 bytes,
+// uint32 elapsed us, uint16 connection interval, uint16 MTU
+static void throughput_send_result(conn_slot_t *slot, uint8_t direction, uint32_t bytes, uint32_t elapsed_us)
 {
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "┌─────────────────────────────────┐");
-    ESP_LOGI(TAG, "│ DISPLAYING TEXT WITH LVGL       │");
-    ESP_LOGI(TAG, "├─────────────────────────────────┤");
-    ESP_LOGI(TAG, "│ Text: '%s'", text);
-    ESP_LOGI(TAG, "│ Length: %d chars", (int)strlen(text));
-    ESP_LOGI(TAG, "└─────────────────────────────────┘");
-    ESP_LOGI(TAG, "");
-
-    if (text_label != NULL) {
-        // Update the label text
-        lv_label_set_text(text_label, text);
-
-        // Make sure label is visible and centered
-        lv_obj_clear_flag(text_label, LV_OBJ_FLAG_HIDDEN);
-        lv_obj_center(text_label);
-
-        // Force LVGL to refresh the display
-        lv_refr_now(NULL);
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    if (!(slot->cccd_values[CHAR_IDX_THROUGHPUT] & 0x0001)) {
+        return;
+    }
+    uint8_t value[16];
+    value[0] = THROUGHPUT_OP_RESULT;
+    value[1] = direction;
+    value[2] = slot->tx_phy;
+    value[3] = slot->rx_phy;
+    for (int i = 0; i < 4; i++) {
+        value[4 + i] = (bytes >> (8 * i)) & 0xFF;
+        value[8 + i] = (elapsed_us >> (8 * i)) & 0xFF;
+    }
+    value[12] = slot->interval & 0xFF;
+    value[13] = slot->interval >> 8;
+    value[14] = slot->mtu & 0xFF;
+    value[15] = slot->mtu >> 8;
+    esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id, profile->char_handles[CHAR_IDX_THROUGHPUT],
+                                sizeof(value), value, false);
+}
 
-        ESP_LOGI(TAG, "Text displayed successfully using LVGL!");
-        ESP_LOGI(TAG, "Label text: '%s'", lv_label_get_text(text_label));
-        ESP_LOGI(TAG, "");
-    } else {
-        ESP_LOGW(TAG, "Text label not initialized!");
+// Notify MTU-sized filler to throughput_tx_slot for throughput_tx_ms, as fast as the controller
+// takes it, then the result
+static void throughput_tx_task(void *pvParameter)
+{
+    struct gatts_profile_inst *profile = &gl_profile_tab[PROFILE_APP_IDX];
+    conn_slot_t *slot = throughput_tx_slot;
+    uint16_t len = slot->mtu - 3;
+    if (len > sizeof(throughput_tx_buf)) {
+        len = sizeof(throughput_tx_buf);
+    }
+    memset(throughput_tx_buf, 0x5A, len);
+    throughput_tx_buf[0] = THROUGHPUT_OP_DATA;
+
+    uint32_t sent = 0;
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + throughput_tx_ms * 1000LL;
+    while (!throughput_tx_cancel && esp_timer_get_time() < end_us &&
+           (slot->cccd_values[CHAR_IDX_THROUGHPUT] & 0x0001)) {
+        if (esp_ble_get_cur_sendable_packets_num(slot->conn_id) == 0) {
+            vTaskDelay(1);
+            continue;
+        }
+        if (esp_ble_gatts_send_indicate(profile->gatts_if, slot->conn_id,
+                                        profile->char_handles[CHAR_IDX_THROUGHPUT], len, throughput_tx_buf,
+                                        false) == ESP_OK) {
+            sent += len;
+        }
     }
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    if (!throughput_tx_cancel) {
+        ESP_LOGI(TAG, "Throughput tx: %u bytes in %u ms, %.1f kB/s", (unsigned int)sent,
+                 (unsigned int)(elapsed_us / 1000), elapsed_us > 0 ? sent * 1000.0 / elapsed_us : 0.0);
+        throughput_send_result(slot, THROUGHPUT_DIR_TX, sent, elapsed_us);
+    }
+    throughput_tx_running = false;
+    vTaskDelete(NULL);
 }
 
-void set_connection_status(connection_status_t status)
+// Throughput characteristic write (Bluedroid task). Receive goodput is timed from the first to
+// the last DATA write, so the time the client takes to send STOP is not counted.
+static esp_gatt_status_t throughput_handle_write(const uint8_t *value, uint16_t len)
 {
-    current_status = status;
-    indicator_flash_state = false;
+    conn_slot_t *slot = gatts_slot;
+    if (len == 0) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    switch (value[0]) {
+    case THROUGHPUT_OP_RX_START:
+        slot->throughput_rx_bytes = 0;
+        slot->throughput_rx_first_us = 0;
+        slot->throughput_rx_last_us = 0;
+        return ESP_GATT_OK;
+    case THROUGHPUT_OP_DATA: {
+        int64_t now_us = esp_timer_get_time();
+        if (slot->throughput_rx_bytes == 0) {
+            slot->throughput_rx_first_us = now_us;
+        }
+        slot->throughput_rx_last_us = now_us;
+        slot->throughput_rx_bytes += len;
+        return ESP_GATT_OK;
+    }
+    case THROUGHPUT_OP_RX_STOP: {
+        uint32_t elapsed_us = (uint32_t)(slot->throughput_rx_last_us - slot->throughput_rx_first_us);
+        ESP_LOGI(TAG, "Throughput rx: %u bytes in %u ms, %.1f kB/s", (unsigned int)slot->throughput_rx_bytes,
+                 (unsigned int)(elapsed_us / 1000),
+                 elapsed_us > 0 ? slot->throughput_rx_bytes * 1000.0 / elapsed_us : 0.0);
+        throughput_send_result(slot, THROUGHPUT_DIR_RX, slot->throughput_rx_bytes, elapsed_us);
+        return ESP_GATT_OK;
+    }
+    case THROUGHPUT_OP_TX_START: {
+        if (len != 3) {
+            return ESP_GATT_INVALID_ATTR_LEN;
+        }
+        uint16_t duration_ms = value[1] | (value[2] << 8);
+        if (duration_ms == 0 || duration_ms > THROUGHPUT_TX_MAX_MS) {
+            return ESP_GATT_OUT_OF_RANGE;
+        }
+        bool idle = false;
+        if (!atomic_compare_exchange_strong(&throughput_tx_running, &idle, true)) {
+            return ESP_GATT_BUSY;
+        }
+        throughput_tx_slot = slot;
+        throughput_tx_ms = duration_ms;
+        throughput_tx_cancel = false;
+        if (xTaskCreate(throughput_tx_task, "BLE_Tput", 3072, NULL, 4, NULL) != pdPASS) {
+            throughput_tx_running = false;
+            return ESP_GATT_NO_RESOURCES;
+        }
+        return ESP_GATT_OK;
+    }
+    default:
+        return ESP_GATT_REQ_NOT_SUPPORTED;
+    }
+}
 
-    if (status_indicator != NULL) {
-        switch (status) {
-            case STATUS_DISCONNECTED:
-                lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0xFF0000), 0);  // Red
-                break;
-            case STATUS_ADVERTISING:
-                lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x0000FF), 0);  // Blue
-                break;
-            case STATUS_CONNECTED:
-                lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x00FF00), 0);  // Green
-                break;
+#if CONFIG_DISPLAY_TRACE
+// Trace characteristic: snapshot the ring for chunked reads, or print it to the serial log
+static esp_gatt_status_t trace_handle_write(const uint8_t *value, uint16_t len)
+{
+    if (len != 1) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    size_t snapshot_len = trace_snapshot(&trace_ring, (uint32_t)esp_timer_get_time(), trace_dump);
+    if (value[0] == TRACE_CMD_SNAPSHOT) {
+        trace_dump_len = snapshot_len;
+        trace_dump_cursor = 0;
+        ESP_LOGI(TAG, "Trace snapshot of %u bytes ready", (unsigned int)snapshot_len);
+        return ESP_GATT_OK;
+    }
+    if (value[0] == TRACE_CMD_SERIAL) {
+        // One hex line per 32 bytes, picked out of the log by tools/trace_decode.py
+        char line[2 * 32 + 1];
+        for (size_t off = 0; off < snapshot_len; off += 32) {
+            size_t n = snapshot_len - off < 32 ? snapshot_len - off : 32;
+            for (size_t i = 0; i < n; i++) {
+                snprintf(line + 2 * i, 3, "%02x", trace_dump[off + i]);
+            }
+            ESP_LOGI(TAG, "TRACE %s", line);
         }
-        lv_refr_now(NULL);
+        trace_dump_len = 0;
+        return ESP_GATT_OK;
     }
+    return ESP_GATT_REQ_NOT_SUPPORTED;
 }
 
-// Task to handle indicator flashing
-static void status_indicator_task(void *pvParameter)
+// Next chunk of the snapshot, empty once it has been read completely.
+// Chunks stay below MTU - 1 so clients do not follow up with Read Blob requests.
+static uint16_t trace_read_chunk(uint16_t mtu, uint8_t *out)
 {
-    while (1) {
-        if (current_status == STATUS_ADVERTISING && status_indicator != NULL) {
-            // Flash blue when advertising
-            if (indicator_flash_state) {
-                lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x0000FF), 0);  // Blue
+    size_t chunk = trace_dump_len - trace_dump_cursor;
+    if (chunk > (size_t)mtu - 2) {
+        chunk = mtu - 2;
+    }
+    memcpy(out, trace_dump + trace_dump_cursor, chunk);
+    trace_dump_cursor += chunk;
+    return (uint16_t)chunk;
+}
+#endif
+
+// Route a complete write value to its characteristic. value_in_arena is set for reassembled
+// long writes; consumers either take over the arena or release it.
+static esp_gatt_status_t gatts_dispatch_write(uint16_t handle, const uint8_t *value, uint16_t len, bool value_in_arena)
+{
+    esp_gatt_status_t write_status = ESP_GATT_OK;
+    int char_idx = gatts_char_index_by_handle(handle);
+    if (char_idx == CHAR_IDX_COLOR) {
+        ESP_LOGD(TAG, "  -> COLOR CHARACTERISTIC");
+
+        write_status = display_post_color(value, len);
+    } else if (char_idx == CHAR_IDX_TEXT) {
+        ESP_LOGD(TAG, "  -> TEXT CHARACTERISTIC");
+        ESP_LOGD(TAG, "  -> Received text: '%.*s'", len, (const char *)value);
+        if (value_in_arena) {
+            // Reassembled long write: hand the arena to the display without copying
+            write_status = display_post_text_ref((const char *)value, len);
+        } else if (len <= DISPLAY_CMD_TEXT_MAX) {
+            // Short text: copied inline into the display queue
+            if (!display_post_text(value, len)) {
+                write_status = ESP_GATT_NO_RESOURCES;
+            }
+        } else {
+            // Longer than a command slot but within one MTU: park it in the arena
+            const uint8_t *stored;
+            long_write_status_t lw_status = long_write_store(&long_write, value, len, &stored);
+            if (lw_status == LONG_WRITE_OK) {
+                write_status = display_post_text_ref((const char *)stored, len);
             } else {
-                lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0x000000), 0);  // Black (off)
+                ESP_LOGW(TAG, "  -> ERROR: Text of %d bytes rejected: %s", len, long_write_status_str(lw_status));
+                write_status = gatts_long_write_status(lw_status);
             }
-            indicator_flash_state = !indicator_flash_state;
-            lv_refr_now(NULL);
         }
-        vTaskDelay(pdMS_TO_TICKS(500));  // Flash every 500ms
+    } else if (char_idx == CHAR_IDX_COMMAND) {
+        ESP_LOGD(TAG, "  -> COMMAND CHARACTERISTIC");
+        write_status = display_post_frame(value, len, 0);
+        if (value_in_arena) {
+            // The frame was parsed into the queue slot, the arena is free again
+            long_write_release(&long_write);
+        }
+    } else if (char_idx == CHAR_IDX_STREAM) {
+        // Write without response: a full queue means the client ignored its credits
+        int64_t now_us = esp_timer_get_time();
+        if (gatts_slot->stream_received == 0) {
+            gatts_slot->stream_first_us = now_us;
+        }
+        gatts_slot->stream_last_us = now_us;
+        gatts_slot->stream_received++;
+        write_status = display_post_frame(value, len, DISPLAY_CMD_FLAG_STREAM);
+        if (write_status != ESP_GATT_OK) {
+            gatts_slot->stream_dropped++;
+            stream_send_credits(gatts_slot);
+        }
+#if CONFIG_DISPLAY_TRACE
+    } else if (char_idx == CHAR_IDX_TRACE) {
+        write_status = trace_handle_write(value, len);
+#endif
+    } else if (gatts_cccd_index_by_handle(handle) >= 0 && len == 2) {
+        int cccd_idx = gatts_cccd_index_by_handle(handle);
+        uint16_t cccd_value = value[0] | (value[1] << 8);
+        gatts_slot->cccd_values[cccd_idx] = cccd_value;
+        ESP_LOGD(TAG, "  -> CCCD of 0x%04X set to 0x%04X", gatts_char_defs[cccd_idx].uuid, cccd_value);
+        if (cccd_idx == CHAR_IDX_CREDITS && (cccd_value & 0x0001)) {
+            // Initial grant: the full window
+            stream_send_credits(gatts_slot);
+        }
+        if (cccd_idx == CHAR_IDX_LINK && (cccd_value & 0x0001)) {
+            link_send_info(gatts_slot);
+        }
+    } else {
+        ESP_LOGW(TAG, "  -> UNKNOWN HANDLE");
     }
+
+    return write_status;
 }
 
-// BLE Event Handlers
-static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+// Prepare write: append the fragment to the arena and echo it back as ATT requires.
+// The arena is shared: while one client reassembles a value, the others are told it is busy.
+static void gatts_prepare_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
 {
-    switch (event) {
-    case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
-        adv_config_done &= (~ADV_CONFIG_FLAG);
-        if (adv_config_done == 0) {
-            esp_ble_gap_start_advertising(&adv_params);
+    esp_gatt_status_t status = ESP_GATT_OK;
+    int char_idx = gatts_char_index_by_handle(param->write.handle);
+
+    if (char_idx != CHAR_IDX_TEXT && char_idx != CHAR_IDX_COMMAND) {
+        status = ESP_GATT_NOT_LONG;
+    } else if (long_write.handle != 0 && long_write_owner != gatts_slot) {
+        status = ESP_GATT_BUSY;
+    } else {
+        if (param->write.offset == 0 && long_write.len == 0) {
+            long_write_start_us = esp_timer_get_time();
         }
-        break;
-    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
-        if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
-            ESP_LOGE(TAG, "Advertising start failed");
-        } else {
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "╔════════════════════════════════════════════╗");
-            ESP_LOGI(TAG, "║  BLE ADVERTISING STARTED                   ║");
-            ESP_LOGI(TAG, "╚════════════════════════════════════════════╝");
-            ESP_LOGI(TAG, "  Device is now visible to Flutter app!");
-            ESP_LOGI(TAG, "  Look for: 'SusanESP'");
-            ESP_LOGI(TAG, "  Service UUID: 0x00FF");
-            ESP_LOGI(TAG, "");
-            // Update status indicator to flashing blue (advertising)
-            set_connection_status(STATUS_ADVERTISING);
+        long_write_status_t lw_status = long_write_append(&long_write, param->write.handle, param->write.offset,
+                                                          param->write.value, param->write.len);
+        if (lw_status != LONG_WRITE_OK) {
+            ESP_LOGW(TAG, "Prepare write at offset %d rejected: %s", param->write.offset, long_write_status_str(lw_status));
+            status = gatts_long_write_status(lw_status);
         }
-        break;
-    case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
-        if (param->adv_stop_cmpl.status != ESP_BT_STATUS_SUCCESS) {
-            ESP_LOGE(TAG, "Advertising stop failed");
-        } else {
-            ESP_LOGI(TAG, "Stop adv successfully");
+        if (long_write.handle != 0) {
+            // Also a voided payload: it is this client's until its execute reports the error
+            long_write_owner = gatts_slot;
         }
-        break;
-    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
-        ESP_LOGI(TAG, "=== CONNECTION PARAMS UPDATED ===");
-        ESP_LOGI(TAG, "  Status: %d", param->update_conn_params.status);
-        ESP_LOGI(TAG, "  Min interval: %d", param->update_conn_params.min_int);
-        ESP_LOGI(TAG, "  Max interval: %d", param->update_conn_params.max_int);
-        ESP_LOGI(TAG, "  Latency: %d", param->update_conn_params.latency);
-        ESP_LOGI(TAG, "  Timeout: %d", param->update_conn_params.timeout);
-        ESP_LOGI(TAG, "================================");
-        break;
-    default:
-        break;
     }
+
+    if (param->write.need_rsp) {
+        esp_gatt_rsp_t rsp;
+        memset(&rsp, 0, sizeof(rsp));
+        rsp.attr_value.handle = param->write.handle;
+        rsp.attr_value.offset = param->write.offset;
+        rsp.attr_value.len = param->write.len;
+        rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+        memcpy(rsp.attr_value.value, param->write.value, param->write.len);
+        esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, &rsp);
+    }
+}
+
+// Execute write: dispatch the reassembled payload, or drop it on cancel. Another client's
+// payload in progress is left alone; for this client there is nothing prepared.
+static void gatts_exec_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    esp_gatt_status_t status = ESP_GATT_OK;
+
+    if (long_write.handle != 0 && long_write_owner != gatts_slot) {
+        // Nothing to do
+    } else if (param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC) {
+        uint16_t handle;
+        const uint8_t *data;
+        size_t len;
+        long_write_status_t lw_status = long_write_finish(&long_write, &handle, &data, &len);
+        if (lw_status == LONG_WRITE_OK) {
+            int64_t elapsed_us = esp_timer_get_time() - long_write_start_us;
+            TRACE(TRACE_EV_LONG_WRITE, gatts_char_index_by_handle(handle), len);
+            ESP_LOGI(TAG, "Long write of %u bytes reassembled in %lld us (%.1f KB/s)", (unsigned int)len,
+                     elapsed_us, elapsed_us > 0 ? len * 1000000.0 / 1024.0 / elapsed_us : 0.0);
+            status = gatts_dispatch_write(handle, data, len, true);
+        } else if (lw_status != LONG_WRITE_ERR_EMPTY) {
+            status = gatts_long_write_status(lw_status);
+        }
+    } else {
+        long_write_cancel(&long_write);
+    }
+
+    esp_ble_gatts_send_response(gatts_if, param->exec_write.conn_id, param->exec_write.trans_id, status, NULL);
 }
 
 static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
@@ -381,153 +2444,243 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
         gl_profile_tab[PROFILE_APP_IDX].service_id.id.uuid.uuid.uuid16 = GATTS_SERVICE_UUID;
 
         esp_ble_gap_set_device_name(DEVICE_NAME);
+        adv_config_done = ADV_CONFIG_FLAG | SCAN_RSP_CONFIG_FLAG;
+        portENTER_CRITICAL(&adv_state_lock);
+        memcpy(adv_manufacturer, adv_state_latest, ADV_STATE_LEN);
+        portEXIT_CRITICAL(&adv_state_lock);
         esp_ble_gap_config_adv_data(&adv_data);
+        esp_ble_gap_config_adv_data(&scan_rsp_data);
         esp_ble_gatts_create_service(gatts_if, &gl_profile_tab[PROFILE_APP_IDX].service_id, GATTS_NUM_HANDLE);
         break;
 
     case ESP_GATTS_CREATE_EVT:
         ESP_LOGI(TAG, "Service created, handle %d", param->create.service_handle);
         gl_profile_tab[PROFILE_APP_IDX].service_handle = param->create.service_handle;
-        gl_profile_tab[PROFILE_APP_IDX].char_uuid_color.len = ESP_UUID_LEN_16;
-        gl_profile_tab[PROFILE_APP_IDX].char_uuid_color.uuid.uuid16 = GATTS_CHAR_UUID_COLOR;
 
         esp_ble_gatts_start_service(gl_profile_tab[PROFILE_APP_IDX].service_handle);
 
-        // Add color characteristic
-        esp_ble_gatts_add_char(gl_profile_tab[PROFILE_APP_IDX].service_handle,
-                              &gl_profile_tab[PROFILE_APP_IDX].char_uuid_color,
-                              ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
-                              ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
-                              NULL, NULL);
+        // Add the first characteristic, the rest are chained from ESP_GATTS_ADD_CHAR_EVT
+        gatts_add_char(0);
         break;
 
-    case ESP_GATTS_ADD_CHAR_EVT:
-        ESP_LOGI(TAG, "Characteristic added, handle %d", param->add_char.attr_handle);
+    case ESP_GATTS_ADD_CHAR_EVT: {
+        ESP_LOGI(TAG, "Characteristic 0x%04X added, handle %d",
+                 param->add_char.char_uuid.uuid.uuid16, param->add_char.attr_handle);
+
+        int idx = gatts_char_index_by_uuid(param->add_char.char_uuid.uuid.uuid16);
+        if (idx >= 0) {
+            gl_profile_tab[PROFILE_APP_IDX].char_handles[idx] = param->add_char.attr_handle;
+            if (gatts_char_defs[idx].property & ESP_GATT_CHAR_PROP_BIT_NOTIFY) {
+                // Client characteristic configuration first, the next characteristic follows from ADD_CHAR_DESCR_EVT
+                gatts_char_adding_cccd = idx;
+                esp_bt_uuid_t descr_uuid = {
+                    .len = ESP_UUID_LEN_16,
+                    .uuid.uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG,
+                };
+                esp_ble_gatts_add_char_descr(gl_profile_tab[PROFILE_APP_IDX].service_handle, &descr_uuid,
+                                             ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, NULL, NULL);
+            } else if (idx + 1 < CHAR_IDX_NUM) {
+                gatts_add_char(idx + 1);
+            }
+        }
+        break;
+    }
 
-        if (param->add_char.char_uuid.uuid.uuid16 == GATTS_CHAR_UUID_COLOR) {
-            gl_profile_tab[PROFILE_APP_IDX].char_handle_color = param->add_char.attr_handle;
+    case ESP_GATTS_ADD_CHAR_DESCR_EVT: {
+        int idx = gatts_char_adding_cccd;
+        ESP_LOGI(TAG, "CCCD for characteristic 0x%04X added, handle %d",
+                 gatts_char_defs[idx].uuid, param->add_char_descr.attr_handle);
+        gl_profile_tab[PROFILE_APP_IDX].cccd_handles[idx] = param->add_char_descr.attr_handle;
+        if (idx + 1 < CHAR_IDX_NUM) {
+            gatts_add_char(idx + 1);
+        }
+        break;
+    }
 
-            // Now add text characteristic
-            gl_profile_tab[PROFILE_APP_IDX].char_uuid_text.len = ESP_UUID_LEN_16;
-            gl_profile_tab[PROFILE_APP_IDX].char_uuid_text.uuid.uuid16 = GATTS_CHAR_UUID_TEXT;
+    case ESP_GATTS_READ_EVT: {
+        conn_slot_t *slot = conn_slot_by_id(param->read.conn_id);
+        if (slot == NULL) {
+            // A connection being turned away, see ESP_GATTS_CONNECT_EVT: answer so its ATT
+            // transaction does not wait for the timeout
+            if (param->read.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id,
+                                            ESP_GATT_INSUF_RESOURCE, NULL);
+            }
+            break;
+        }
+        esp_gatt_rsp_t rsp;
+        memset(&rsp, 0, sizeof(rsp));
+        rsp.attr_value.handle = param->read.handle;
+
+        int char_idx = gatts_char_index_by_handle(param->read.handle);
+        int cccd_idx = gatts_cccd_index_by_handle(param->read.handle);
+        if (char_idx == CHAR_IDX_CREDITS) {
+            rsp.attr_value.len = stream_credits_encode(slot, rsp.attr_value.value);
+#if CONFIG_DISPLAY_TRACE
+        } else if (char_idx == CHAR_IDX_TRACE) {
+            rsp.attr_value.len = trace_read_chunk(slot->mtu, rsp.attr_value.value);
+#endif
+        } else if (char_idx == CHAR_IDX_LINK) {
+            rsp.attr_value.len = link_info_encode(slot, rsp.attr_value.value);
+        } else if (char_idx == CHAR_IDX_STATS) {
+            rsp.attr_value.offset = param->read.offset;
+            rsp.attr_value.len = latency_report_read(param->read.offset, rsp.attr_value.value, slot->mtu - 1);
+        } else if (cccd_idx >= 0) {
+            rsp.attr_value.len = 2;
+            rsp.attr_value.value[0] = slot->cccd_values[cccd_idx] & 0xFF;
+            rsp.attr_value.value[1] = slot->cccd_values[cccd_idx] >> 8;
+        }
+        esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
+        break;
+    }
 
-            esp_ble_gatts_add_char(gl_profile_tab[PROFILE_APP_IDX].service_handle,
-                                  &gl_profile_tab[PROFILE_APP_IDX].char_uuid_text,
-                                  ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
-                                  ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
-                                  NULL, NULL);
-        } else if (param->add_char.char_uuid.uuid.uuid16 == GATTS_CHAR_UUID_TEXT) {
-            gl_profile_tab[PROFILE_APP_IDX].char_handle_text = param->add_char.attr_handle;
+    case ESP_GATTS_MTU_EVT: {
+        conn_slot_t *slot = conn_slot_by_id(param->mtu.conn_id);
+        if (slot == NULL) {
+            break;
         }
+        slot->mtu = param->mtu.mtu;
+        ESP_LOGI(TAG, "MTU of conn %d: %d, %d bytes per write", slot->conn_id, slot->mtu, slot->mtu - 3);
+        link_send_info(slot);
         break;
+    }
+
+    case ESP_GATTS_WRITE_EVT: {
+        esp_gatt_status_t write_status = ESP_GATT_OK;
+        gatts_rx_us = (uint32_t)esp_timer_get_time();
+        gatts_slot = conn_slot_by_id(param->write.conn_id);
+        if (gatts_slot == NULL) {
+            // A connection being turned away, see ESP_GATTS_CONNECT_EVT
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
+                                            ESP_GATT_INSUF_RESOURCE, NULL);
+            }
+            break;
+        }
+        conn_note_activity(gatts_slot);
+
+        if (param->write.is_prep) {
+            gatts_prepare_write(gatts_if, param);
+            break;
+        }
 
-    case ESP_GATTS_WRITE_EVT:
-        ESP_LOGI(TAG, "=== WRITE EVENT RECEIVED ===");
-        ESP_LOGI(TAG, "  Handle: %d", param->write.handle);
-        ESP_LOGI(TAG, "  Value length: %d bytes", param->write.len);
-        ESP_LOGI(TAG, "  Need response: %s", param->write.need_rsp ? "YES" : "NO");
-
-        // Print hex dump of received data
-        ESP_LOGI(TAG, "  Data (hex): ");
-        for (int i = 0; i < param->write.len; i++) {
-            printf("%02X ", param->write.value[i]);
-            if ((i + 1) % 16 == 0) printf("\n              ");
-        }
-        printf("\n");
-
-        if (param->write.handle == gl_profile_tab[PROFILE_APP_IDX].char_handle_color) {
-            ESP_LOGI(TAG, "  -> COLOR CHARACTERISTIC");
-
-            if (param->write.len == 2) {
-                // RGB565 format (2 bytes)
-                uint16_t color = (param->write.value[0] << 8) | param->write.value[1];
-                ESP_LOGI(TAG, "  -> RGB565 format: 0x%04X", color);
-                lcd_clear_screen(color);
-            } else if (param->write.len == 6 || param->write.len == 7) {
-                // Hex string format: "RRGGBB" or "#RRGGBB"
-                char hex_str[8] = {0};
-                memcpy(hex_str, param->write.value, param->write.len);
-                hex_str[param->write.len] = '\0';
-
-                // Skip '#' if present
-                char *hex_start = (hex_str[0] == '#') ? hex_str + 1 : hex_str;
-
-                // Parse RGB888 hex string and use directly (no RGB565 conversion!)
-                uint32_t rgb888 = strtol(hex_start, NULL, 16);
-                uint8_t r8 = (rgb888 >> 16) & 0xFF;
-                uint8_t g8 = (rgb888 >> 8) & 0xFF;
-                uint8_t b8 = rgb888 & 0xFF;
-
-                ESP_LOGI(TAG, "  -> Hex format: %s -> RGB888(0x%06X)", hex_str, (unsigned int)rgb888);
-                ESP_LOGI(TAG, "     RGB888: R=%d, G=%d, B=%d", r8, g8, b8);
-
-                // Use RGB888 directly - LVGL will handle the conversion internally
-                lcd_clear_screen_rgb888(rgb888);
+        // Pixel, asset and throughput data are hot paths: no per-write logging
+        int write_idx = gatts_char_index_by_handle(param->write.handle);
+        if (write_idx == CHAR_IDX_IMAGE || write_idx == CHAR_IDX_ASSET || write_idx == CHAR_IDX_THROUGHPUT) {
+            if (write_idx == CHAR_IDX_IMAGE) {
+                write_status = image_handle_write(param->write.value, param->write.len);
+            } else if (write_idx == CHAR_IDX_ASSET) {
+                write_status = asset_handle_write(param->write.value, param->write.len);
             } else {
-                ESP_LOGW(TAG, "  -> ERROR: Invalid color data length: %d (expected 2 for RGB565 or 6/7 for hex)", param->write.len);
+                write_status = throughput_handle_write(param->write.value, param->write.len);
             }
-        } else if (param->write.handle == gl_profile_tab[PROFILE_APP_IDX].char_handle_text) {
-            ESP_LOGI(TAG, "  -> TEXT CHARACTERISTIC");
-            // Text command: expecting string
-            char text_buf[GATTS_DEMO_CHAR_VAL_LEN_MAX + 1] = {0};
-            memcpy(text_buf, param->write.value, param->write.len);
-            text_buf[param->write.len] = '\0';
-            ESP_LOGI(TAG, "  -> Received text: '%s'", text_buf);
-            ESP_LOGI(TAG, "  -> Text length: %d characters", (int)strlen(text_buf));
-            lcd_display_text(text_buf);
-        } else {
-            ESP_LOGW(TAG, "  -> UNKNOWN HANDLE");
+            if (write_status != ESP_GATT_OK) {
+                TRACE(TRACE_EV_GATT_WRITE, write_idx | (write_status << 8), param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, write_status, NULL);
+            }
+            break;
         }
 
-        // Send response if needed
+        // Verbose per-write logging is compiled out unless CONFIG_LOG_MAXIMUM_LEVEL allows it
+        ESP_LOGV(TAG, "Write: handle %d, %d bytes, need response %d",
+                 param->write.handle, param->write.len, param->write.need_rsp);
+        ESP_LOG_BUFFER_HEX_LEVEL(TAG, param->write.value, param->write.len, ESP_LOG_VERBOSE);
+
+        write_status = gatts_dispatch_write(param->write.handle, param->write.value, param->write.len, false);
+        TRACE(TRACE_EV_GATT_WRITE, gatts_char_index_by_handle(param->write.handle) | (write_status << 8),
+              param->write.len);
+
+        // Respond as soon as the command is queued; rendering happens in lvgl_task
         if (param->write.need_rsp) {
-            ESP_LOGI(TAG, "  -> Sending response...");
-            esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, NULL);
+            esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, write_status, NULL);
         }
-        ESP_LOGI(TAG, "===========================");
+        break;
+    }
+
+    case ESP_GATTS_EXEC_WRITE_EVT:
+        gatts_rx_us = (uint32_t)esp_timer_get_time();
+        gatts_slot = conn_slot_by_id(param->exec_write.conn_id);
+        if (gatts_slot == NULL) {
+            esp_ble_gatts_send_response(gatts_if, param->exec_write.conn_id, param->exec_write.trans_id,
+                                        ESP_GATT_INSUF_RESOURCE, NULL);
+            break;
+        }
+        conn_note_activity(gatts_slot);
+        gatts_exec_write(gatts_if, param);
         break;
 
-    case ESP_GATTS_CONNECT_EVT:
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "╔════════════════════════════════════╗");
-        ESP_LOGI(TAG, "║   FLUTTER APP CONNECTED!           ║");
-        ESP_LOGI(TAG, "╚════════════════════════════════════╝");
-        ESP_LOGI(TAG, "  Connection ID: %d", param->connect.conn_id);
-        ESP_LOGI(TAG, "  Remote device address: %02x:%02x:%02x:%02x:%02x:%02x",
-                 param->connect.remote_bda[0], param->connect.remote_bda[1],
-                 param->connect.remote_bda[2], param->connect.remote_bda[3],
-                 param->connect.remote_bda[4], param->connect.remote_bda[5]);
-        ESP_LOGI(TAG, "  Connection interval: %d", param->connect.conn_params.interval);
-        ESP_LOGI(TAG, "  Latency: %d", param->connect.conn_params.latency);
-        ESP_LOGI(TAG, "  Timeout: %d", param->connect.conn_params.timeout);
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "Waiting for commands from Flutter app...");
-        ESP_LOGI(TAG, "");
-
-        gl_profile_tab[PROFILE_APP_IDX].conn_id = param->connect.conn_id;
+    case ESP_GATTS_CONNECT_EVT: {
+        TRACE(TRACE_EV_CONNECT, param->connect.conn_id, param->connect.conn_params.interval);
+        ESP_LOGI(TAG, "Connected: conn %d, " ESP_BD_ADDR_STR ", interval %d, latency %d, timeout %d",
+                 param->connect.conn_id, ESP_BD_ADDR_HEX(param->connect.remote_bda),
+                 param->connect.conn_params.interval, param->connect.conn_params.latency,
+                 param->connect.conn_params.timeout);
+        ESP_LOGD(TAG, "");
+        ESP_LOGD(TAG, "╔════════════════════════════════════╗");
+        ESP_LOGD(TAG, "║   FLUTTER APP CONNECTED!           ║");
+        ESP_LOGD(TAG, "╚════════════════════════════════════╝");
+        ESP_LOGD(TAG, "Waiting for commands from Flutter app...");
+        ESP_LOGD(TAG, "");
+
+        conn_slot_t *slot = conn_slot_claim(param->connect.conn_id, param->connect.remote_bda,
+                                            param->connect.conn_params.interval);
+        if (slot == NULL) {
+            // Only possible if the controller accepts more links than configured
+            ESP_LOGW(TAG, "All %d connection slots in use, disconnecting conn %d", GATTS_MAX_CONN,
+                     param->connect.conn_id);
+            esp_ble_gap_disconnect(param->connect.remote_bda);
+            break;
+        }
+        conn_start(slot);
+
         // Update status indicator to green (connected)
-        set_connection_status(STATUS_CONNECTED);
+        display_post_status(STATUS_CONNECTED);
+
+        // Connecting stopped advertising; stay visible at the slow interval while a slot is free
+        if (conn_count < GATTS_MAX_CONN) {
+            adv_start(false);
+        } else if (adv_fast_timer != NULL) {
+            esp_timer_stop(adv_fast_timer);
+        }
         break;
+    }
+
+    case ESP_GATTS_DISCONNECT_EVT: {
+        TRACE(TRACE_EV_DISCONNECT, param->disconnect.conn_id, param->disconnect.reason);
+        ESP_LOGI(TAG, "Disconnected: conn %d, " ESP_BD_ADDR_STR ", reason 0x%02x",
+                 param->disconnect.conn_id, ESP_BD_ADDR_HEX(param->disconnect.remote_bda), param->disconnect.reason);
+        ESP_LOGD(TAG, "");
+        ESP_LOGD(TAG, "╔════════════════════════════════════╗");
+        ESP_LOGD(TAG, "║   FLUTTER APP DISCONNECTED         ║");
+        ESP_LOGD(TAG, "╚════════════════════════════════════╝");
+        conn_slot_t *slot = conn_slot_by_id(param->disconnect.conn_id);
+        if (slot == NULL) {
+            break;
+        }
+        if (slot->stream_received > 0) {
+            int64_t stream_us = slot->stream_last_us - slot->stream_first_us;
+            ESP_LOGI(TAG, "  Stream: %u frames, %u dropped, %.1f ops/s",
+                     (unsigned int)slot->stream_received, (unsigned int)slot->stream_dropped,
+                     stream_us > 0 ? (slot->stream_received - 1) * 1000000.0 / stream_us : 0.0);
+        }
+        conn_stop(slot);
 
-    case ESP_GATTS_DISCONNECT_EVT:
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "╔════════════════════════════════════╗");
-        ESP_LOGI(TAG, "║   FLUTTER APP DISCONNECTED         ║");
-        ESP_LOGI(TAG, "╚════════════════════════════════════╝");
-        ESP_LOGI(TAG, "  Connection ID: %d", param->disconnect.conn_id);
-        ESP_LOGI(TAG, "  Reason: 0x%02x", param->disconnect.reason);
-        ESP_LOGI(TAG, "  Remote device: %02x:%02x:%02x:%02x:%02x:%02x",
-                 param->disconnect.remote_bda[0], param->disconnect.remote_bda[1],
-                 param->disconnect.remote_bda[2], param->disconnect.remote_bda[3],
-                 param->disconnect.remote_bda[4], param->disconnect.remote_bda[5]);
-        ESP_LOGI(TAG, "");
-        ESP_LOGI(TAG, "Restarting advertising...");
-        ESP_LOGI(TAG, "");
-
-        esp_ble_gap_start_advertising(&adv_params);
+        // Fast advertising again, so the client finds the device quickly when it comes back. Advertising
+        // only stopped when the last free slot was taken; otherwise it is running at the slow interval.
+        ESP_LOGD(TAG, "Restarting advertising...");
+        if (conn_count == GATTS_MAX_CONN - 1) {
+            adv_start(true);
+        } else {
+            adv_restart_with(true);
+        }
         // Update status indicator to flashing blue (advertising again)
-        set_connection_status(STATUS_ADVERTISING);
+        if (conn_count == 0) {
+            display_post_status(STATUS_ADVERTISING);
+        }
         break;
+    }
 
     default:
         break;
@@ -558,13 +2711,25 @@ void init_lcd(void)
 {
     ESP_LOGI(TAG, "Initializing ST7789 LCD display");
 
-    // Initialize backlight GPIO
-    gpio_config_t bk_gpio_config = {
-        .mode = GPIO_MODE_OUTPUT,
-        .pin_bit_mask = 1ULL << PIN_NUM_BK_LIGHT
+    // Initialize backlight PWM (starts off)
+    ledc_timer_config_t bk_timer_config = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .duty_resolution = LEDC_TIMER_8_BIT,
+        .timer_num = LCD_BK_LIGHT_LEDC_TIMER,
+        .freq_hz = LCD_BK_LIGHT_PWM_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
     };
-    ESP_ERROR_CHECK(gpio_config(&bk_gpio_config));
-    gpio_set_level(PIN_NUM_BK_LIGHT, LCD_BK_LIGHT_OFF_LEVEL);
+    ESP_ERROR_CHECK(ledc_timer_config(&bk_timer_config));
+    ledc_channel_config_t bk_channel_config = {
+        .gpio_num = PIN_NUM_BK_LIGHT,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = LCD_BK_LIGHT_LEDC_CHANNEL,
+        .timer_sel = LCD_BK_LIGHT_LEDC_TIMER,
+        .duty = 0,
+        .hpoint = 0,
+        .flags.output_invert = !LCD_BK_LIGHT_ON_LEVEL,
+    };
+    ESP_ERROR_CHECK(ledc_channel_config(&bk_channel_config));
 
     // Initialize SPI bus
     spi_bus_config_t buscfg = {
@@ -586,7 +2751,11 @@ void init_lcd(void)
         .lcd_cmd_bits = 8,
         .lcd_param_bits = 8,
         .spi_mode = 0,
-        .trans_queue_depth = 10,
+        // Each LVGL flush is a single color transfer (max_transfer_sz covers a full frame) and
+        // the next draw_bitmap waits for it, so only one buffer is ever queued behind the wire
+        .trans_queue_depth = 4,
+        .on_color_trans_done = lcd_color_trans_done_cb,
+        .user_ctx = &disp_drv,
     };
     ESP_ERROR_CHECK(esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)LCD_HOST, &io_config, &io_handle));
 
@@ -607,29 +2776,57 @@ void init_lcd(void)
     ESP_ERROR_CHECK(esp_lcd_panel_set_gap(panel_handle, 0, 34));  // Swap gap for rotation
     ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, true));
 
-    // Turn on backlight
-    gpio_set_level(PIN_NUM_BK_LIGHT, LCD_BK_LIGHT_ON_LEVEL);
+    // The backlight stays off until the first frame, see lvgl_monitor_cb
     ESP_LOGI(TAG, "LCD initialized successfully!");
 
-    // Clear to black (using direct draw, LVGL not ready yet)
-    lcd_fill_rect(panel_handle, 0, 0, LCD_H_RES, LCD_V_RES, COLOR_BLACK);
-    current_color = COLOR_BLACK;
+    // Persistent DMA tile for the solid-fill engine
+    lcd_direct_done_sem = xSemaphoreCreateBinary();
+    lcd_fill_tile = heap_caps_malloc(LCD_H_RES * LCD_FILL_TILE_LINES * sizeof(uint16_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (lcd_fill_tile == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate fill tile");
+        return;
+    }
+
+    // Row slots for image streaming, each sent to the panel with one transfer
+    uint8_t *image_slot_bufs[IMAGE_STREAM_SLOTS];
+    const size_t image_slot_size = LCD_H_RES * IMAGE_SLOT_LINES * sizeof(uint16_t);
+    for (int i = 0; i < IMAGE_STREAM_SLOTS; i++) {
+        image_slot_bufs[i] = heap_caps_malloc(image_slot_size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (image_slot_bufs[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate image slot %d", i);
+            return;
+        }
+    }
+    image_stream_init(&image_stream, image_slot_bufs, image_slot_size, LCD_H_RES, LCD_V_RES);
+
+    // No clear here: LVGL's first frame covers the whole screen
+    boot_mark(BOOT_PHASE_LCD);
 }
 
-void init_lvgl(void)
+// Allocate the render buffers. They are the largest DMA blocks, so they are taken before the
+// Bluetooth stack starts allocating in parallel; on failure disp_buf stays empty.
+void init_render_buffers(void)
 {
-    ESP_LOGI(TAG, "Initializing LVGL");
-
-    // Initialize LVGL
-    lv_init();
+    const size_t heap_free_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+#if CONFIG_DISPLAY_RENDER_DIRECT
+    const size_t buf_size = LCD_H_RES * LCD_V_RES;
+    const size_t stage_size = LCD_H_RES * LCD_DIRECT_STAGE_LINES;
+    lcd_framebuffer = heap_caps_malloc(buf_size * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    lcd_direct_stage = heap_caps_malloc(stage_size * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+
+    if (lcd_framebuffer == NULL || lcd_direct_stage == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate LVGL framebuffer (%d bytes, largest free DMA block %d)",
+                 (int)(buf_size * sizeof(lv_color_t)), (int)heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
+        return;
+    }
 
-    // Set custom tick function (use lv_tick_set_cb if available, otherwise lv_tick_custom_cb)
-    #if LV_TICK_CUSTOM
-    lv_tick_set_cb(lvgl_tick_get_cb);
-    #endif
+    ESP_LOGI(TAG, "LVGL direct mode: framebuffer %d bytes, staging %d bytes (%d lines)",
+             (int)(buf_size * sizeof(lv_color_t)), (int)(stage_size * sizeof(lv_color_t)), LCD_DIRECT_STAGE_LINES);
 
-    // Allocate draw buffers
-    const size_t buf_size = LCD_H_RES * 40; // 40 lines buffer
+    // One full-screen buffer; LVGL renders dirty areas in place
+    lv_disp_draw_buf_init(&disp_buf, lcd_framebuffer, NULL, buf_size);
+#else
+    const size_t buf_size = LCD_H_RES * LCD_DRAW_BUF_LINES;
     buf1 = heap_caps_malloc(buf_size * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
     buf2 = heap_caps_malloc(buf_size * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
 
@@ -638,18 +2835,49 @@ void init_lvgl(void)
         return;
     }
 
-    ESP_LOGI(TAG, "LVGL draw buffers allocated: %d bytes each", buf_size * sizeof(lv_color_t));
+    ESP_LOGI(TAG, "LVGL draw buffers allocated: %d bytes each (%d lines)", buf_size * sizeof(lv_color_t), LCD_DRAW_BUF_LINES);
 
     // Initialize LVGL draw buffer
     lv_disp_draw_buf_init(&disp_buf, buf1, buf2, buf_size);
+#endif
+
+    // Memory budget: what the render buffers took and what is left for BLE and the rest
+    ESP_LOGI(TAG, "Render buffers: %d bytes; internal heap free %d, largest DMA block %d",
+             (int)(heap_free_before - heap_caps_get_free_size(MALLOC_CAP_INTERNAL)),
+             (int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+             (int)heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
+}
+
+void init_lvgl(void)
+{
+    if (disp_buf.buf1 == NULL) {
+        ESP_LOGE(TAG, "No render buffers, display disabled");
+        return;
+    }
+    ESP_LOGI(TAG, "Initializing LVGL");
+
+    // Initialize LVGL
+    lv_init();
+
+    // Set custom tick function (use lv_tick_set_cb if available, otherwise lv_tick_custom_cb)
+    #if LV_TICK_CUSTOM
+    lv_tick_set_cb(lvgl_tick_get_cb);
+    #endif
+
+    lvgl_flush_done_sem = xSemaphoreCreateBinary();
 
     // Initialize display driver
     lv_disp_drv_init(&disp_drv);
     disp_drv.hor_res = LCD_H_RES;
     disp_drv.ver_res = LCD_V_RES;
     disp_drv.flush_cb = lvgl_flush_cb;
+    disp_drv.wait_cb = lvgl_wait_cb;
+    disp_drv.monitor_cb = lvgl_monitor_cb;
     disp_drv.draw_buf = &disp_buf;
     disp_drv.user_data = panel_handle;
+#if CONFIG_DISPLAY_RENDER_DIRECT
+    disp_drv.direct_mode = 1;
+#endif
 
     lv_disp_t *disp = lv_disp_drv_register(&disp_drv);
     if (disp == NULL) {
@@ -657,59 +2885,158 @@ void init_lvgl(void)
         return;
     }
 
-    ESP_LOGI(TAG, "LVGL display driver registered");
+    // Frame budget: all updates invalidated within one period are rendered in a single pass
+    lv_timer_set_period(_lv_disp_get_refr_timer(disp), CONFIG_DISPLAY_FRAME_BUDGET_MS);
+
+    ESP_LOGI(TAG, "LVGL display driver registered (frame budget %d ms)", CONFIG_DISPLAY_FRAME_BUDGET_MS);
+
+    // The scene itself is shared with the host benchmark; it reaches the panel through these hooks
+    static const display_scene_hooks_t scene_hooks = {
+        .fill_rect = scene_fill_rect,
+        .fill_wait = scene_fill_wait,
+        .set_brightness = scene_set_brightness,
+        .request_refresh = scene_request_refresh,
+        .find_image = scene_find_image,
+    };
+    display_scene_create(&scene_hooks, CONFIG_DISPLAY_LABEL_CACHE_KB * 1024);
+    state_restore();
 
-    // Create screen and label
-    screen_obj = lv_obj_create(NULL);
-    // Use RGB888 black (0x000000) for proper color handling
-    lv_obj_set_style_bg_color(screen_obj, lv_color_hex(0x000000), 0);
-    lv_scr_load(screen_obj);
+    // Advertise the restored state from the start
+    uint8_t adv[ADV_STATE_LEN];
+    adv_state_encode(&display_state, FIRMWARE_VERSION, adv);
+    adv_update_state(adv);
 
-    // Create text label
-    text_label = lv_label_create(screen_obj);
-    lv_label_set_text(text_label, "Ready");
-    // Use RGB888 white (0xFFFFFF) instead of RGB565 (0xFFFF) for proper white color
-    lv_obj_set_style_text_color(text_label, lv_color_hex(0xFFFFFF), 0);
-    lv_obj_set_style_text_font(text_label, &lv_font_montserrat_24, 0);  // 24pt font (enabled via sdkconfig)
-    lv_obj_set_width(text_label, LCD_H_RES - 40);  // Wider margin for better readability
-    lv_label_set_long_mode(text_label, LV_LABEL_LONG_WRAP);
+    ESP_LOGI(TAG, "LVGL UI created");
+    boot_mark(BOOT_PHASE_LVGL);
 
-    // Make label background transparent so screen color shows through
-    lv_obj_set_style_bg_opa(text_label, LV_OPA_TRANSP, 0);
+    // Start LVGL task (from here on only lvgl_task may touch LVGL)
+    xTaskCreate(lvgl_task, "LVGL_Task", 4096, NULL, 5, &lvgl_task_handle);
 
-    lv_obj_center(text_label);
+    ESP_LOGI(TAG, "LVGL initialized successfully!");
+}
 
-    // Create connection status indicator in top right corner
-    status_indicator = lv_obj_create(screen_obj);
-    lv_obj_set_size(status_indicator, 20, 20);  // 20x20 circle
-    lv_obj_align(status_indicator, LV_ALIGN_TOP_RIGHT, -10, 10);  // 10px from top and right edges
-    lv_obj_set_style_radius(status_indicator, LV_RADIUS_CIRCLE, 0);  // Make it circular
-    lv_obj_set_style_bg_color(status_indicator, lv_color_hex(0xFF0000), 0);  // Start red (not connected)
-    lv_obj_set_style_border_color(status_indicator, lv_color_hex(0x000000), 0);  // Black outline
-    lv_obj_set_style_border_width(status_indicator, 2, 0);  // 2px border width
+// Saves the display state published by lvgl_task. Bursts of updates (a color picker being
+// dragged, a stream of texts) are coalesced into one write once they pause, and a state that
+// ends up where it started is not written at all.
+static void state_task(void *pvParameter)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(STATE_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Opening NVS for the display state failed: %s", esp_err_to_name(ret));
+        vTaskDelete(NULL);
+        return;
+    }
+    uint8_t blob[CMD_FRAME_ENCODED_MAX];
+    uint8_t adv[ADV_STATE_LEN];
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t first_us = esp_timer_get_time();
+        while (esp_timer_get_time() - first_us < STATE_SAVE_MAX_MS * 1000LL &&
+               ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STATE_SAVE_QUIET_MS)) != 0) {
+        }
 
-    ESP_LOGI(TAG, "LVGL UI created");
+        portENTER_CRITICAL(&state_blob_lock);
+        size_t len = state_blob_len;
+        memcpy(blob, state_blob, len);
+        memcpy(adv, state_adv, sizeof(adv));
+        portEXIT_CRITICAL(&state_blob_lock);
 
-    // Start LVGL task
-    xTaskCreate(lvgl_task, "LVGL_Task", 4096, NULL, 5, NULL);
+        // Scanning apps see the state as soon as updates pause, whether or not it needs saving
+        adv_update_state(adv);
+        if (len == state_saved_len && memcmp(blob, state_saved, len) == 0) {
+            continue;
+        }
 
-    // Start status indicator task
-    xTaskCreate(status_indicator_task, "Status_Indicator_Task", 2048, NULL, 4, NULL);
+        int64_t start_us = esp_timer_get_time();
+        ret = nvs_set_blob(nvs, STATE_NVS_KEY, blob, len);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Saving the display state failed: %s", esp_err_to_name(ret));
+            continue;
+        }
+        memcpy(state_saved, blob, len);
+        state_saved_len = len;
+        ESP_LOGI(TAG, "Display state saved: %u bytes in %lld ms", (unsigned int)len,
+                 (esp_timer_get_time() - start_us) / 1000);
+    }
+}
 
-    ESP_LOGI(TAG, "LVGL initialized successfully!");
+// Load the saved display state and start the task that keeps it up to date
+void init_state(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(STATE_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret == ESP_OK) {
+        state_saved_len = sizeof(state_saved);
+        ret = nvs_get_blob(nvs, STATE_NVS_KEY, state_saved, &state_saved_len);
+        nvs_close(nvs);
+    }
+    if (ret != ESP_OK) {
+        // Nothing saved yet (the namespace only exists after the first write)
+        if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Reading the display state failed: %s", esp_err_to_name(ret));
+        }
+        state_saved_len = 0;
+    }
+    xTaskCreate(state_task, "State_Task", 2560, NULL, 2, &state_task_handle);
+}
+
+// Map the asset partition and start the flash writer; without the partition uploads are refused
+void init_assets(void)
+{
+    asset_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ASSET_PARTITION_SUBTYPE, "assets");
+    if (asset_partition == NULL) {
+        ESP_LOGW(TAG, "No assets partition, uploads disabled");
+        return;
+    }
+    const void *base;
+    esp_err_t ret = esp_partition_mmap(asset_partition, 0, asset_partition->size, ESP_PARTITION_MMAP_DATA,
+                                       &base, &asset_mmap);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Mapping the assets partition failed: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    static const asset_store_io_t io = {
+        .write = asset_flash_write,
+        .erase = asset_flash_erase,
+        .hash = asset_hash,
+    };
+    asset_store_init(&asset_store, base, asset_partition->size, &io);
+    asset_store_stats_t stats;
+    asset_store_get_stats(&asset_store, &stats);
+    ESP_LOGI(TAG, "Assets: %u stored, %u/%u bytes used", (unsigned int)stats.assets, (unsigned int)stats.used,
+             (unsigned int)stats.capacity);
+
+    asset_lock = xSemaphoreCreateMutex();
+    asset_ring = xRingbufferCreate(ASSET_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (asset_ring == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate asset ring, uploads disabled");
+        return;
+    }
+    xTaskCreate(asset_task, "Asset_Task", 3072, NULL, 4, &asset_task_handle);
 }
 
 void init_ble(void)
 {
     esp_err_t ret;
 
-    // Initialize NVS
-    ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
+    // Timers first: the Bluedroid task starts them from REG_EVT and CONNECT_EVT as soon as the app
+    // is registered, and only reads the handles, which never change after this
+    const esp_timer_create_args_t idle_timer_args = {
+        .callback = conn_idle_check,
+        .name = "conn_idle",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&idle_timer_args, &conn_idle_timer));
+
+    const esp_timer_create_args_t adv_timer_args = {
+        .callback = adv_fast_expired,
+        .name = "adv_fast",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&adv_timer_args, &adv_fast_timer));
 
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
 
@@ -725,6 +3052,7 @@ void init_ble(void)
         ESP_LOGE(TAG, "Enable controller failed: %s", esp_err_to_name(ret));
         return;
     }
+    boot_mark(BOOT_PHASE_CONTROLLER);
 
     ret = esp_bluedroid_init();
     if (ret) {
@@ -737,6 +3065,7 @@ void init_ble(void)
         ESP_LOGE(TAG, "Enable bluedroid failed: %s", esp_err_to_name(ret));
         return;
     }
+    boot_mark(BOOT_PHASE_BLUEDROID);
 
     ret = esp_ble_gatts_register_callback(gatts_event_handler);
     if (ret) {
@@ -756,7 +3085,7 @@ void init_ble(void)
         return;
     }
 
-    esp_err_t local_mtu_ret = esp_ble_gatt_set_local_mtu(500);
+    esp_err_t local_mtu_ret = esp_ble_gatt_set_local_mtu(GATTS_LOCAL_MTU);
     if (local_mtu_ret) {
         ESP_LOGE(TAG, "Set local MTU failed: %s", esp_err_to_name(local_mtu_ret));
     }
@@ -764,26 +3093,109 @@ void init_ble(void)
     ESP_LOGI(TAG, "BLE initialized successfully");
 }
 
+// Bring up the Bluetooth stack while app_main initializes the panel and LVGL. Until the display
+// is up its callbacks only queue commands, which lvgl_task applies on its first pass.
+static void ble_init_task(void *pvParameter)
+{
+    init_ble();
+    vTaskDelete(NULL);
+}
+
 void app_main(void)
 {
+    boot_mark(BOOT_PHASE_APP_MAIN);
     ESP_LOGI(TAG, "Starting ESP32 IoT BLE Device with LVGL");
 
-    // Initialize LCD first
+#if CONFIG_DISPLAY_TRACE
+    trace_init(&trace_ring);
+    TRACE(TRACE_EV_BOOT, 0, 0);
+#endif
+    display_cmd_queue_init(&display_cmd_queue);
+    for (int i = 0; i < GATTS_MAX_CONN; i++) {
+        display_cmd_queue_init(&conn_slots[i].queue);
+    }
+    latency_stats_init(&latency_stats);
+    latency_report_len = stats_report_encode(LATENCY_STAGE_MASK_ALL, latency_report, sizeof(latency_report));
+    long_write_init(&long_write, long_write_arena, LONG_WRITE_ARENA_SIZE);
+
+    // Initialize NVS (display state and the BLE stack)
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Render buffers first, while the largest DMA blocks are still free
+    init_render_buffers();
+
+    // Bluetooth starts now and comes up alongside the display, advertising as soon as it can
+    xTaskCreate(ble_init_task, "BLE_Init", 4096, NULL, uxTaskPriorityGet(NULL), NULL);
+
     init_lcd();
 
-    // Initialize LVGL
-    init_lvgl();
+    // Map stored assets before the first command can refer to one
+    init_assets();
 
-    // Initialize BLE
-    init_ble();
+    // Load the saved display state, shown on the first frame
+    init_state();
+
+    // Initialize LVGL; lvgl_task renders the first frame and turns the backlight on
+    init_lvgl();
 
     ESP_LOGI(TAG, "System ready. Waiting for BLE connections...");
     ESP_LOGI(TAG, "Device name: %s", DEVICE_NAME);
     ESP_LOGI(TAG, "Color characteristic UUID: 0x%04X", GATTS_CHAR_UUID_COLOR);
     ESP_LOGI(TAG, "Text characteristic UUID: 0x%04X", GATTS_CHAR_UUID_TEXT);
+    ESP_LOGI(TAG, "Command characteristic UUID: 0x%04X", GATTS_CHAR_UUID_COMMAND);
+    ESP_LOGI(TAG, "Stream characteristic UUID: 0x%04X (credits 0x%04X)", GATTS_CHAR_UUID_STREAM, GATTS_CHAR_UUID_CREDITS);
+    ESP_LOGI(TAG, "Stats characteristic UUID: 0x%04X", GATTS_CHAR_UUID_STATS);
+    ESP_LOGI(TAG, "Asset characteristic UUID: 0x%04X", GATTS_CHAR_UUID_ASSET);
+#if CONFIG_DISPLAY_TRACE
+    ESP_LOGI(TAG, "Trace characteristic UUID: 0x%04X", GATTS_CHAR_UUID_TRACE);
+#endif
 
-    // Keep running
+    // Keep running, periodically reporting refresh scheduler counters
+    uint32_t last_rendered = 0;
+    uint32_t last_wakeups = 0;
     while (1) {
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        vTaskDelay(10000 / portTICK_PERIOD_MS);
+
+        uint32_t requested, coalesced, rendered, flush_bytes;
+        display_get_refresh_stats(&requested, &coalesced, &rendered, &flush_bytes);
+        if (rendered != last_rendered) {
+            // Summed over the system queue and the connections' queues, high water of the fullest
+            display_cmd_queue_stats_t qstats;
+            display_cmd_queue_get_stats(&display_cmd_queue, &qstats);
+            for (int i = 0; i < GATTS_MAX_CONN; i++) {
+                display_cmd_queue_stats_t slot_stats;
+                display_cmd_queue_get_stats(&conn_slots[i].queue, &slot_stats);
+                qstats.enqueued += slot_stats.enqueued;
+                qstats.dropped += slot_stats.dropped;
+                qstats.dequeued += slot_stats.dequeued;
+                qstats.high_water = LV_MAX(qstats.high_water, slot_stats.high_water);
+            }
+
+            ESP_LOGI(TAG, "Display frames: %u requested, %u coalesced, %u rendered, %u bytes flushed (%u per frame)",
+                     (unsigned int)requested, (unsigned int)coalesced, (unsigned int)rendered,
+                     (unsigned int)flush_bytes, (unsigned int)(flush_bytes / rendered));
+            ESP_LOGI(TAG, "Display queue: %u enqueued, %u dropped, %u dequeued, high water %u/%d",
+                     (unsigned int)qstats.enqueued, (unsigned int)qstats.dropped,
+                     (unsigned int)qstats.dequeued, (unsigned int)qstats.high_water, DISPLAY_CMD_QUEUE_LEN);
+
+            // Read from lvgl_task's counters; a torn snapshot only skews one log line
+            label_cache_stats_t cstats;
+            display_scene_get_label_cache_stats(&cstats);
+            ESP_LOGI(TAG, "Label cache: %u hits, %u misses, %u evictions, %u entries, %u/%u bytes",
+                     (unsigned int)cstats.hits, (unsigned int)cstats.misses, (unsigned int)cstats.evictions,
+                     (unsigned int)cstats.entries, (unsigned int)cstats.bytes_used, (unsigned int)cstats.budget);
+            last_rendered = rendered;
+        }
+        // Silence here means the LVGL task did not wake at all
+        uint32_t wakeups = lvgl_wakeups;
+        if (wakeups != last_wakeups) {
+            ESP_LOGI(TAG, "LVGL task: %u wakeups in the last 10 s", (unsigned int)(wakeups - last_wakeups));
+            last_wakeups = wakeups;
+        }
     }
 }
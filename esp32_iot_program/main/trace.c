@@ -0,0 +1,63 @@
+/*
+ * Binary trace ring, see trace.h
+ */
+
+#include <string.h>
+#include "trace.h"
+
+#define RING_MASK (TRACE_RING_LEN - 1)
+
+_Static_assert((TRACE_RING_LEN & RING_MASK) == 0, "TRACE_RING_LEN must be a power of two");
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+void trace_init(trace_ring_t *ring)
+{
+    memset(ring, 0, sizeof(*ring));
+    atomic_init(&ring->written, 0);
+}
+
+void trace_record(trace_ring_t *ring, uint32_t time_us, uint16_t event, uint16_t a, uint32_t b)
+{
+    uint32_t index = atomic_fetch_add_explicit(&ring->written, 1, memory_order_relaxed);
+    trace_record_t *r = &ring->records[index & RING_MASK];
+    r->time_us = time_us;
+    r->event = event;
+    r->a = a;
+    r->b = b;
+}
+
+size_t trace_snapshot(trace_ring_t *ring, uint32_t now_us, uint8_t *out)
+{
+    uint32_t written = atomic_load_explicit(&ring->written, memory_order_acquire);
+    uint32_t count = written < TRACE_RING_LEN ? written : TRACE_RING_LEN;
+    uint32_t first = written - count;
+
+    memcpy(out, "TRC1", 4);
+    put_u16(out + 4, TRACE_RECORD_SIZE);
+    put_u16(out + 6, (uint16_t)count);
+    put_u32(out + 8, written);
+    put_u32(out + 12, now_us);
+
+    uint8_t *p = out + TRACE_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        const trace_record_t *r = &ring->records[(first + i) & RING_MASK];
+        put_u32(p, r->time_us);
+        put_u16(p + 4, r->event);
+        put_u16(p + 6, r->a);
+        put_u32(p + 8, r->b);
+        p += TRACE_RECORD_SIZE;
+    }
+    return (size_t)(p - out);
+}
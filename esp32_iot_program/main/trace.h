@@ -0,0 +1,73 @@
+/*
+ * Binary trace ring
+ * Fixed-size ring of timestamped 12-byte event records, cheap enough for
+ * the BLE callbacks and lvgl_task where a log line would stall on the UART.
+ * The oldest records are overwritten when the ring wraps.
+ *
+ * Any task may record; a slot is claimed with one atomic increment and
+ * filled in place. A snapshot taken while another task is recording may
+ * contain one torn record, which is acceptable for diagnostics.
+ *
+ * Snapshot layout (little-endian), decoded by tools/trace_decode.py:
+ *   header: "TRC1", uint16 record size, uint16 record count,
+ *           uint32 records written since boot, uint32 snapshot time (us)
+ *   record: uint32 time (us), uint16 event, uint16 a, uint32 b
+ * Records are ordered oldest first.
+ *
+ * Portable C11, no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_RING_LEN      256  // must be a power of two
+#define TRACE_RECORD_SIZE   12
+#define TRACE_HEADER_SIZE   16
+#define TRACE_SNAPSHOT_MAX  (TRACE_HEADER_SIZE + TRACE_RING_LEN * TRACE_RECORD_SIZE)
+
+// Event ids, mirrored in tools/trace_decode.py
+typedef enum {
+    TRACE_EV_BOOT = 1,         // a: -, b: -
+    TRACE_EV_ADV_START,        // a: status, b: -
+    TRACE_EV_CONNECT,          // a: conn id, b: connection interval (1.25 ms units)
+    TRACE_EV_DISCONNECT,       // a: conn id, b: reason
+    TRACE_EV_GATT_WRITE,       // a: characteristic index | status << 8, b: length
+    TRACE_EV_QUEUE_FULL,       // a: command type, b: -
+    TRACE_EV_CMD_APPLY,        // a: command type, b: commands still queued
+    TRACE_EV_FRAME,            // a: render time (ms), b: pixels
+    TRACE_EV_LONG_WRITE,       // a: characteristic index, b: length
+    TRACE_EV_IMAGE_OPEN,       // a: image id, b: w << 16 | h
+    TRACE_EV_IMAGE_DRAWN,      // a: image id, b: bytes
+    TRACE_EV_IMAGE_ERROR,      // a: image id, b: image_stream_status_t
+    TRACE_EV_CONN_PARAMS,      // a: peripheral latency, b: connection interval (1.25 ms units)
+} trace_event_t;
+
+typedef struct {
+    uint32_t time_us;
+    uint16_t event;
+    uint16_t a;
+    uint32_t b;
+} trace_record_t;
+
+typedef struct {
+    trace_record_t records[TRACE_RING_LEN];
+    _Atomic uint32_t written;  // records ever claimed; the next slot is written & (LEN - 1)
+} trace_ring_t;
+
+void trace_init(trace_ring_t *ring);
+
+void trace_record(trace_ring_t *ring, uint32_t time_us, uint16_t event, uint16_t a, uint32_t b);
+
+// Serialize the ring into out (TRACE_SNAPSHOT_MAX bytes), returns the snapshot length
+size_t trace_snapshot(trace_ring_t *ring, uint32_t now_us, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
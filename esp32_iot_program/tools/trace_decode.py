@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Decode a trace ring snapshot from the display firmware (main/trace.h).
+
+Input is either the raw snapshot read from the trace characteristic (0xFF07)
+or a serial log containing the "TRACE <hex>" lines printed after writing 0x02
+to it:
+
+    tools/trace_decode.py snapshot.bin
+    idf.py monitor | tee log.txt; tools/trace_decode.py log.txt
+"""
+
+import re
+import struct
+import sys
+
+# Mirrors trace_event_t in main/trace.h
+EVENTS = {
+    1: "BOOT",
+    2: "ADV_START",
+    3: "CONNECT",
+    4: "DISCONNECT",
+    5: "GATT_WRITE",
+    6: "QUEUE_FULL",
+    7: "CMD_APPLY",
+    8: "FRAME",
+    9: "LONG_WRITE",
+    10: "IMAGE_OPEN",
+    11: "IMAGE_DRAWN",
+    12: "IMAGE_ERROR",
+    13: "CONN_PARAMS",
+}
+
+HEADER = struct.Struct("<4sHHII")
+RECORD = struct.Struct("<IHHI")
+
+
+def describe(event, a, b):
+    name = EVENTS.get(event, "EVENT_%d" % event)
+    if name == "GATT_WRITE":
+        return name, "char %d status 0x%02x len %d" % (a & 0xFF, a >> 8, b)
+    if name == "CONNECT":
+        return name, "conn %d interval %.2f ms" % (a, b * 1.25)
+    if name == "CONN_PARAMS":
+        return name, "interval %.2f ms latency %d" % (b * 1.25, a)
+    if name == "DISCONNECT":
+        return name, "conn %d reason 0x%02x" % (a, b)
+    if name == "FRAME":
+        return name, "%d ms %d px" % (a, b)
+    if name == "IMAGE_OPEN":
+        return name, "image %d %dx%d" % (a, b >> 16, b & 0xFFFF)
+    if name in ("IMAGE_DRAWN", "IMAGE_ERROR"):
+        return name, "image %d %d" % (a, b)
+    return name, "a=%d b=%d" % (a, b)
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data.startswith(b"TRC1"):
+        return data
+    # Serial log: concatenate the hex payload of every TRACE line
+    text = data.decode("utf-8", errors="replace")
+    hex_lines = re.findall(r"TRACE ([0-9a-fA-F]+)", text)
+    return bytes.fromhex("".join(hex_lines))
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: %s <snapshot.bin | serial log>" % sys.argv[0])
+    data = load(sys.argv[1])
+    if len(data) < HEADER.size:
+        sys.exit("no trace snapshot found")
+    magic, record_size, count, written, now_us = HEADER.unpack_from(data)
+    if magic != b"TRC1" or record_size != RECORD.size:
+        sys.exit("not a trace snapshot (magic %r, record size %d)" % (magic, record_size))
+    if len(data) < HEADER.size + count * record_size:
+        sys.exit("snapshot truncated: %d of %d records" % ((len(data) - HEADER.size) // record_size, count))
+
+    print("%d records, %d written since boot, %d overwritten" % (count, written, written - count))
+    prev_us = None
+    for i in range(count):
+        time_us, event, a, b = RECORD.unpack_from(data, HEADER.size + i * record_size)
+        name, detail = describe(event, a, b)
+        # Timestamps are the low 32 bits of esp_timer, wrapping every ~71 minutes
+        delta = "" if prev_us is None else "+%.3f" % (((time_us - prev_us) & 0xFFFFFFFF) / 1000.0)
+        ago = ((now_us - time_us) & 0xFFFFFFFF) / 1000.0
+        print("%12.3f ms  %10s  -%10.3f ms  %-12s %s" % (time_us / 1000.0, delta, ago, name, detail))
+        prev_us = time_us
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,43 @@
+import 'package:flutter/material.dart';
+import 'package:flutter_blue_plus/flutter_blue_plus.dart';
+
+// Display state the device advertises in its manufacturer data, readable from a scan result
+// without connecting. Mirrors esp32_iot_program/main/adv_state.h, little-endian after the
+// company id: uint8 layout version, uint8 firmware version, uint8 R, G, B of the background,
+// uint32 state hash.
+//
+// The hash is the 32-bit FNV-1a of the device's state as one command frame with every field in
+// operation order (background, text, text color, font, brightness, asset or hide asset), so a
+// DisplayFrame built the same way for the state the app wants hashes to the same value.
+class AdvertisedState {
+  static const int companyId = 0xFFFF; // ADV_STATE_COMPANY_ID
+  static const int layoutVersion = 1; // ADV_STATE_VERSION
+
+  final int firmwareVersion;
+  final Color background;
+  final int stateHash;
+
+  AdvertisedState(this.firmwareVersion, this.background, this.stateHash);
+
+  // The state in a scan result, or null for devices (or firmware) that do not advertise it
+  static AdvertisedState? fromScan(ScanResult result) {
+    final data = result.advertisementData.manufacturerData[companyId];
+    if (data == null || data.length < 9 || data[0] != layoutVersion) {
+      return null;
+    }
+    final hash = data[5] | (data[6] << 8) | (data[7] << 16) | (data[8] << 24);
+    return AdvertisedState(data[1], Color.fromARGB(0xFF, data[2], data[3], data[4]), hash);
+  }
+
+  static int fnv1a(List<int> bytes) {
+    int hash = 0x811C9DC5;
+    for (final b in bytes) {
+      hash ^= b;
+      hash = (hash * 0x01000193) & 0xFFFFFFFF;
+    }
+    return hash;
+  }
+
+  // Whether the device already shows the state encoded in frame (DisplayFrame.build())
+  bool shows(List<int> frame) => fnv1a(frame) == stateHash;
+}
@@ -0,0 +1,271 @@
+import 'dart:async';
+
+import 'package:crypto/crypto.dart';
+import 'package:flutter_blue_plus/flutter_blue_plus.dart';
+import 'package:shared_preferences/shared_preferences.dart';
+
+import 'link_info.dart';
+
+// Stores assets in the device's flash asset partition over the asset
+// characteristic (0xFF09), so later command frames can show them by key
+// instead of re-sending the bytes. Assets are content-addressed: the key is
+// the first 8 bytes of the SHA-256 of the data, checked by the device.
+// Every write starts with an opcode, fields are little-endian:
+//   BEGIN  0x01 key(8) type(1) size(4)  (write with response)
+//   DATA   0x02 offset(4) data          (write without response)
+//   FINISH 0x03                         the device checks the data hashes to the key
+//   ABORT  0x04
+//   ERASE  0x05                         erase every stored asset
+//   QUERY  0x06 key(8)*n                which of up to 60 keys are stored
+// The device notifies a status on the same characteristic:
+//   uint8 op, uint8 status, uint16 reserved, uint32 bytes written, uint32 byte limit
+// and answers QUERY with:
+//   uint8 op, uint8 status, uint8 count, uint8 reserved, one bit per key (set when stored)
+// Data is only written while offset < limit; the limit grows as the device
+// writes flash, so a sector erase never overruns its queue.
+//
+// The keys known to be on the device are kept in a manifest per device, so
+// showing an asset that is already stored costs one command frame. The
+// manifest is checked with QUERY on start, the partition may have been
+// erased or reflashed since.
+class AssetUpload {
+  static const int opBegin = 0x01;
+  static const int opData = 0x02;
+  static const int opFinish = 0x03;
+  static const int opAbort = 0x04;
+  static const int opErase = 0x05;
+  static const int opQuery = 0x06;
+
+  static const int typeBlob = 0x00;
+  static const int typeImage = 0x01; // LVGL binary image, see lvglImage
+
+  static const int keyLength = 8;
+  static const int queryMax = 60; // ASSET_QUERY_MAX
+
+  // asset_store_status_t on the device
+  static const int statusOk = 0;
+  static const int statusFull = 1;
+  static const int statusDuplicate = 8;
+  static const List<String> statusNames = [
+    'ok',
+    'store full',
+    'no upload in progress',
+    'non-contiguous data',
+    'more data than announced',
+    'incomplete',
+    'hash mismatch',
+    'flash error',
+    'already stored',
+    'busy with another client',
+  ];
+
+  // SharedPreferences key prefix for the manifest of each device
+  static const String _manifestPrefix = 'asset_manifest_';
+
+  final BluetoothDevice device;
+  final BluetoothCharacteristic assetCharacteristic;
+
+  StreamSubscription<List<int>>? _statusSubscription;
+  Completer<void>? _reply;
+  int _replyOp = 0;
+  int _replyStatus = statusOk;
+  List<int> _queryBits = const [];
+  int _limit = 0;
+  Completer<void>? _limitRaised;
+  String? _error;
+  final Set<String> _manifest = {};
+  int sent = 0;
+  int total = 0;
+  bool _busy = false;
+
+  AssetUpload({
+    required this.device,
+    required this.assetCharacteristic,
+  });
+
+  bool get busy => _busy;
+
+  String get _manifestKey => '$_manifestPrefix${device.remoteId.str}';
+
+  Future<void> start() async {
+    _statusSubscription = assetCharacteristic.onValueReceived.listen(_onStatus);
+    await assetCharacteristic.setNotifyValue(true);
+
+    final prefs = await SharedPreferences.getInstance();
+    final saved = prefs.getStringList(_manifestKey) ?? const <String>[];
+    if (saved.isEmpty) {
+      return;
+    }
+    // Keep only the keys the device still has
+    final keys = saved.map(_keyFromHex).toList();
+    try {
+      final present = await query(keys);
+      for (int i = 0; i < keys.length; i++) {
+        if (present[i]) {
+          _manifest.add(saved[i]);
+        }
+      }
+      await _saveManifest();
+    } catch (e) {
+      // Start with an empty manifest: a miss only costs an upload that BEGIN reports as a duplicate
+      print('[Asset] Manifest check failed: $e');
+    }
+  }
+
+  Future<void> stop() async {
+    await _statusSubscription?.cancel();
+    _statusSubscription = null;
+  }
+
+  // Key of data as stored by the device
+  static List<int> keyOf(List<int> data) => sha256.convert(data).bytes.sublist(0, keyLength);
+
+  static String keyHex(List<int> key) => key.map((b) => b.toRadixString(16).padLeft(2, '0')).join();
+
+  static List<int> _keyFromHex(String hex) =>
+      List.generate(keyLength, (i) => int.parse(hex.substring(2 * i, 2 * i + 2), radix: 16));
+
+  static int _le32(List<int> v, int i) => v[i] | (v[i + 1] << 8) | (v[i + 2] << 16) | (v[i + 3] << 24);
+
+  static List<int> _bytes32(int v) => [v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, (v >> 24) & 0xFF];
+
+  static String _statusName(int status) => status < statusNames.length ? statusNames[status] : '$status';
+
+  void _onStatus(List<int> value) {
+    if (value.length >= 4 && value[0] == opQuery) {
+      _queryBits = value.sublist(4);
+      if (_replyOp == opQuery && !(_reply?.isCompleted ?? true)) {
+        _reply!.complete();
+      }
+      return;
+    }
+    if (value.length < 12) {
+      return;
+    }
+    final op = value[0];
+    final status = value[1];
+    if (op == opBegin && status == statusDuplicate) {
+      // Someone stored the same bytes already: nothing to send
+      _replyStatus = status;
+      if (_replyOp == op && !(_reply?.isCompleted ?? true)) {
+        _reply!.complete();
+      }
+    } else if (status != statusOk) {
+      _replyStatus = status;
+      _error = 'Device rejected asset: ${_statusName(status)}';
+      if (!(_reply?.isCompleted ?? true)) {
+        _reply!.completeError(StateError(_error!));
+      }
+    } else {
+      _limit = _le32(value, 8);
+      if (op == _replyOp && !(_reply?.isCompleted ?? true)) {
+        _reply!.complete();
+      }
+    }
+    _limitRaised?.complete();
+    _limitRaised = null;
+  }
+
+  // Write a control op and wait for the device to report its result
+  Future<void> _request(int op, List<int> value) async {
+    _reply = Completer<void>();
+    _replyOp = op;
+    _replyStatus = statusOk;
+    await assetCharacteristic.write(value);
+    await _reply!.future.timeout(const Duration(seconds: 30));
+  }
+
+  Future<void> _saveManifest() async {
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.setStringList(_manifestKey, _manifest.toList());
+  }
+
+  // Whether the manifest says the device holds key
+  bool contains(List<int> key) => _manifest.contains(keyHex(key));
+
+  // Which of keys the device holds, asked in batches of queryMax
+  Future<List<bool>> query(List<List<int>> keys) async {
+    final present = <bool>[];
+    for (int start = 0; start < keys.length; start += queryMax) {
+      final batch = keys.sublist(start, (start + queryMax).clamp(0, keys.length));
+      await _request(opQuery, [opQuery, for (final key in batch) ...key]);
+      for (int i = 0; i < batch.length; i++) {
+        present.add(i ~/ 8 < _queryBits.length && (_queryBits[i ~/ 8] & (1 << (i % 8))) != 0);
+      }
+    }
+    return present;
+  }
+
+  // Make sure data is stored and return its key. Only uploads when the key
+  // is not in the manifest; a full store is erased and the upload retried once.
+  Future<List<int>> ensure(int type, List<int> data) async {
+    final key = keyOf(data);
+    if (contains(key)) {
+      return key;
+    }
+    try {
+      await upload(key, type, data);
+    } on StateError {
+      if (_replyStatus != statusFull) {
+        rethrow;
+      }
+      await eraseAll();
+      await upload(key, type, data);
+    }
+    return key;
+  }
+
+  // Store data under key; completes once the device verified the hash and published the asset,
+  // or right after BEGIN when the device already holds the key
+  Future<void> upload(List<int> key, int type, List<int> data) async {
+    _busy = true;
+    _error = null;
+    sent = 0;
+    total = data.length;
+    try {
+      // BEGIN erases the sectors for the asset before it is acknowledged
+      await _request(opBegin, [opBegin, ...key, type, ..._bytes32(data.length)]);
+
+      if (_replyStatus != statusDuplicate) {
+        // Every write is exactly one full packet: the opcode and the offset come out of it
+        final chunkSize = writePayload(device) - 5;
+        while (sent < total) {
+          if (_error != null) {
+            throw StateError(_error!);
+          }
+          if (sent >= _limit) {
+            _limitRaised = Completer<void>();
+            await _limitRaised!.future;
+            continue;
+          }
+          final end = [sent + chunkSize, _limit, total].reduce((a, b) => a < b ? a : b);
+          await assetCharacteristic.write([opData, ..._bytes32(sent), ...data.sublist(sent, end)],
+              withoutResponse: true);
+          sent = end;
+        }
+        await _request(opFinish, [opFinish]);
+      }
+      _manifest.add(keyHex(key));
+      await _saveManifest();
+    } finally {
+      _busy = false;
+    }
+  }
+
+  Future<void> eraseAll() async {
+    await _request(opErase, [opErase]);
+    _manifest.clear();
+    await _saveManifest();
+  }
+
+  // LVGL v8 binary image of big-endian RGB565 pixels, the byte order of the panel
+  // (LV_COLOR_16_SWAP): a 4-byte header with color format LV_IMG_CF_TRUE_COLOR, then the pixels
+  static List<int> lvglImage(int w, int h, List<int> pixels) {
+    if (pixels.length != w * h * 2) {
+      throw ArgumentError('Expected ${w * h * 2} pixel bytes, got ${pixels.length}');
+    }
+    const cfTrueColor = 4;
+    final header = cfTrueColor | (w << 10) | (h << 21);
+    return [..._bytes32(header), ...pixels];
+  }
+}
@@ -0,0 +1,264 @@
+import 'dart:async';
+import 'dart:collection';
+
+import 'package:flutter_blue_plus/flutter_blue_plus.dart';
+
+import 'display_protocol.dart';
+import 'link_info.dart';
+
+// Latency of one op type over the last samples, from send() until the device
+// took the frame that carried it: the credit that frame used came back on the
+// stream, or the write was acknowledged on the command characteristic.
+// A value that replaced a pending one keeps the older send time, so a backlog
+// shows up as latency instead of disappearing into the merge.
+class CommandLatency {
+  static const int samples = 32;
+
+  final Queue<int> _us = Queue<int>();
+  int count = 0;
+  int lastUs = 0;
+
+  void add(int us) {
+    _us.add(us);
+    if (_us.length > samples) {
+      _us.removeFirst();
+    }
+    lastUs = us;
+    count++;
+  }
+
+  double get lastMs => lastUs / 1000;
+
+  double get medianMs {
+    final sorted = _us.toList()..sort();
+    return sorted.isEmpty ? 0 : sorted[sorted.length ~/ 2] / 1000;
+  }
+
+  double get maxMs => _us.isEmpty ? 0 : _us.reduce((a, b) => a > b ? a : b) / 1000;
+}
+
+class _PendingOp {
+  final int type;
+  final List<int> value;
+  final DateTime queuedAt;
+  final List<Completer<void>> waiters;
+
+  _PendingOp(this.type, this.value, this.queuedAt, this.waiters);
+}
+
+class _InFlight {
+  final int seq;
+  final List<_PendingOp> ops;
+
+  _InFlight(this.seq, this.ops);
+}
+
+// Outgoing display commands with latest-wins merging. Every op of a frame
+// passed to send() waits in a pending slot per op type; a newer op of the
+// same type replaces it, so a burst of color picks or slider moves leaves one
+// background or brightness op, not a backlog. Whenever the link can take a
+// frame, all pending ops go out together as one frame.
+//
+// Frames that fit one write go to the stream characteristic (0xFF04) without
+// response, as many as the credit window on the credits characteristic
+// (0xFF05) allows:
+//   uint32 credit limit  - stream frames the client may have sent since connecting
+//   uint32 dropped       - stream frames the device dropped since connecting
+// The first notification grants the whole window, so later limits minus the
+// window count the frames the device applied or dropped. Longer frames, and firmware
+// without the stream, use the command characteristic (0xFF03) one
+// acknowledged write at a time.
+class CommandQueue {
+  final BluetoothDevice device;
+  final BluetoothCharacteristic commandCharacteristic;
+  final BluetoothCharacteristic? streamCharacteristic;
+  final BluetoothCharacteristic? creditsCharacteristic;
+
+  // Insertion-ordered: ops go out in the order they were last sent
+  final Map<int, _PendingOp> _pending = {};
+  final Queue<_InFlight> _inFlight = Queue<_InFlight>();
+  int _streamed = 0;
+  int _creditLimit = 0;
+  int? _window;
+  int _frames = 0;
+  bool _writing = false;
+  StreamSubscription<List<int>>? _creditsSubscription;
+  DateTime? _firstSend;
+  DateTime? _lastSend;
+
+  // Frames the device reported as dropped
+  int deviceDropped = 0;
+  // Ops replaced by a newer one of the same type before they were written
+  int superseded = 0;
+
+  // Latency per op type (DisplayFrame.op*)
+  final Map<int, CommandLatency> latency = {};
+
+  // Called whenever a frame was written or latency samples arrived
+  void Function()? onChanged;
+
+  CommandQueue({
+    required this.device,
+    required this.commandCharacteristic,
+    this.streamCharacteristic,
+    this.creditsCharacteristic,
+  });
+
+  bool get _canStream => streamCharacteristic != null && creditsCharacteristic != null;
+
+  // Frames written on either characteristic
+  int get sent => _frames;
+
+  // Stream frames written and not yet applied by the device
+  int get inFlight => _inFlight.length;
+
+  double get opsPerSecond {
+    if (_firstSend == null || _lastSend == null || _frames < 2) {
+      return 0;
+    }
+    final micros = _lastSend!.difference(_firstSend!).inMicroseconds;
+    return micros > 0 ? (_frames - 1) * 1000000 / micros : 0;
+  }
+
+  Future<void> start() async {
+    if (!_canStream) {
+      return;
+    }
+    _creditsSubscription = creditsCharacteristic!.onValueReceived.listen(_onCredits);
+    // The device answers the subscription with the initial window
+    await creditsCharacteristic!.setNotifyValue(true);
+  }
+
+  Future<void> stop() async {
+    await _creditsSubscription?.cancel();
+    _creditsSubscription = null;
+    final error = StateError('Command queue stopped');
+    for (final op in _pending.values) {
+      for (final waiter in op.waiters) {
+        waiter.completeError(error);
+      }
+    }
+    _pending.clear();
+  }
+
+  static int _le32(List<int> v, int i) => v[i] | (v[i + 1] << 8) | (v[i + 2] << 16) | (v[i + 3] << 24);
+
+  void _onCredits(List<int> value) {
+    if (value.length < 8) {
+      return;
+    }
+    _creditLimit = _le32(value, 0);
+    deviceDropped = _le32(value, 4);
+    _window ??= _creditLimit;
+
+    // The device returns credits for applied and dropped frames alike: frames up to this one are done
+    final handled = _creditLimit - _window!;
+    final now = DateTime.now();
+    bool sampled = false;
+    while (_inFlight.isNotEmpty && _inFlight.first.seq <= handled) {
+      _record(_inFlight.removeFirst().ops, now);
+      sampled = true;
+    }
+    if (sampled) {
+      onChanged?.call();
+    }
+    _pump();
+  }
+
+  void _record(List<_PendingOp> ops, DateTime now) {
+    for (final op in ops) {
+      latency.putIfAbsent(op.type, () => CommandLatency()).add(now.difference(op.queuedAt).inMicroseconds);
+    }
+  }
+
+  // Queue the ops of a DisplayFrame. Completes once a frame carrying them, or newer values of the
+  // same op types, was written.
+  Future<void> send(List<int> frame) {
+    final ops = DisplayFrame.ops(frame);
+    final done = Completer<void>();
+    final now = DateTime.now();
+    for (final op in ops) {
+      final replaced = _pending.remove(op.key);
+      if (replaced != null) {
+        superseded++;
+      }
+      _pending[op.key] = _PendingOp(
+        op.key,
+        op.value,
+        replaced?.queuedAt ?? now,
+        [...?replaced?.waiters, if (identical(op, ops.last)) done],
+      );
+    }
+    if (ops.isEmpty) {
+      done.complete();
+    }
+    _pump();
+    return done.future;
+  }
+
+  // send() for callers that do not wait: streaming input where a failed write is followed by the
+  // next value anyway
+  void post(List<int> frame) {
+    send(frame).catchError((e) => print('[Queue] Write failed: $e'));
+  }
+
+  List<int> _build(Iterable<_PendingOp> ops) => [
+        for (final op in ops) ...[op.type, op.value.length, ...op.value],
+        DisplayFrame.opCommit,
+        0,
+      ];
+
+  Future<void> _pump() async {
+    if (_writing) {
+      return;
+    }
+    _writing = true;
+    try {
+      while (_pending.isNotEmpty) {
+        final frame = _build(_pending.values);
+        final stream = _canStream && frame.length <= writePayload(device);
+        if (stream && _streamed >= _creditLimit) {
+          // The next credit notification pumps again; meanwhile new ops keep merging
+          break;
+        }
+        final ops = _pending.values.toList();
+        _pending.clear();
+        _frames++;
+        _firstSend ??= DateTime.now();
+        _lastSend = DateTime.now();
+        try {
+          if (stream) {
+            _streamed++;
+            _inFlight.add(_InFlight(_streamed, ops));
+            await streamCharacteristic!.write(frame, withoutResponse: true);
+          } else {
+            await commandCharacteristic.write(frame, allowLongWrite: frame.length > writePayload(device));
+            _record(ops, DateTime.now());
+          }
+          for (final op in ops) {
+            for (final waiter in op.waiters) {
+              waiter.complete();
+            }
+          }
+        } catch (e) {
+          if (stream) {
+            // The device never saw the frame: give the credit back and keep seq in step with its count.
+            // Writes are serialised by _writing, so the failed frame is the newest in flight.
+            if (_inFlight.isNotEmpty && _inFlight.last.seq == _streamed) {
+              _inFlight.removeLast();
+            }
+            _streamed--;
+          }
+          for (final op in ops) {
+            for (final waiter in op.waiters) {
+              waiter.completeError(e);
+            }
+          }
+        }
+        onChanged?.call();
+      }
+    } finally {
+      _writing = false;
+    }
+  }
+}
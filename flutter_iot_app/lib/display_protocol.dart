@@ -0,0 +1,109 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/material.dart';
+
+// Binary command frame for the ESP32 command characteristic (0xFF03).
+// Mirrors esp32_iot_program/main/cmd_frame.h:
+//   frame := op* COMMIT
+//   op    := type(1) length(1) value(length)
+// All operations in one frame are applied by the device in a single render.
+class DisplayFrame {
+  static const int opSetBackground = 0x01;
+  static const int opSetText = 0x02;
+  static const int opSetTextColor = 0x03;
+  static const int opSetFont = 0x04;
+  static const int opSetBrightness = 0x05;
+  static const int opShowAsset = 0x06;
+  static const int opCommit = 0xFF;
+
+  // Longest text the device accepts in one frame (CMD_FRAME_TEXT_MAX)
+  static const int maxTextBytes = 128;
+
+  static const Map<int, String> opNames = {
+    opSetBackground: 'Background',
+    opSetText: 'Text',
+    opSetTextColor: 'Text color',
+    opSetFont: 'Font',
+    opSetBrightness: 'Brightness',
+    opShowAsset: 'Asset',
+  };
+
+  final BytesBuilder _bytes = BytesBuilder();
+
+  void _addOp(int type, List<int> value) {
+    _bytes.addByte(type);
+    _bytes.addByte(value.length);
+    _bytes.add(value);
+  }
+
+  static List<int> _rgb(Color color) => [color.red, color.green, color.blue];
+
+  DisplayFrame setBackground(Color color) {
+    _addOp(opSetBackground, _rgb(color));
+    return this;
+  }
+
+  DisplayFrame setText(String text) {
+    List<int> bytes = utf8.encode(text);
+    if (bytes.length > maxTextBytes) {
+      throw ArgumentError('Text is ${bytes.length} bytes, the device accepts at most $maxTextBytes');
+    }
+    _addOp(opSetText, bytes);
+    return this;
+  }
+
+  DisplayFrame setTextColor(Color color) {
+    _addOp(opSetTextColor, _rgb(color));
+    return this;
+  }
+
+  DisplayFrame setFont(int sizePx) {
+    _addOp(opSetFont, [sizePx]);
+    return this;
+  }
+
+  DisplayFrame setBrightness(int level) {
+    _addOp(opSetBrightness, [level.clamp(0, 255)]);
+    return this;
+  }
+
+  // Show an image stored with AssetUpload by its 8-byte key, top-left corner at (x, y)
+  DisplayFrame showAsset(List<int> key, int x, int y) {
+    if (key.length != 8) {
+      throw ArgumentError('Asset keys are 8 bytes, got ${key.length}');
+    }
+    _addOp(opShowAsset, [...key, x & 0xFF, x >> 8, y & 0xFF, y >> 8]);
+    return this;
+  }
+
+  DisplayFrame hideAsset() {
+    _addOp(opShowAsset, const []);
+    return this;
+  }
+
+  // The ops of a built frame as (type, value) in frame order, without COMMIT
+  static List<MapEntry<int, List<int>>> ops(List<int> frame) {
+    final result = <MapEntry<int, List<int>>>[];
+    int i = 0;
+    while (i + 2 <= frame.length) {
+      final type = frame[i];
+      final end = i + 2 + frame[i + 1];
+      if (type == opCommit) {
+        return result;
+      }
+      if (end > frame.length) {
+        break;
+      }
+      result.add(MapEntry(type, frame.sublist(i + 2, end)));
+      i = end;
+    }
+    throw ArgumentError('Frame is not terminated by COMMIT');
+  }
+
+  // Terminate the frame with COMMIT and return the bytes to write
+  List<int> build() {
+    _addOp(opCommit, const []);
+    return _bytes.takeBytes();
+  }
+}
@@ -0,0 +1,106 @@
+import 'dart:typed_data';
+
+// Q565 lossless RGB565 encoder, the counterpart of the firmware decoder in
+// esp32_iot_program/main/image_codec.h (see there for the op layout).
+// Besides the bytes, the encoder records where every op ends and how many
+// pixels have been coded by then, so an uploader can split the stream at
+// op boundaries and stay within a limit counted in decoded pixel bytes.
+class Q565Encoded {
+  final Uint8List bytes;
+  // Encoded length and pixel count at the end of each op
+  final Int32List opByteEnds;
+  final Int32List opPixelEnds;
+
+  Q565Encoded(this.bytes, this.opByteEnds, this.opPixelEnds);
+
+  int get opCount => opByteEnds.length;
+}
+
+class Q565Encoder {
+  static const int opIndex = 0x00;
+  static const int opDiff = 0x40;
+  static const int opLuma = 0x80;
+  static const int opRun = 0xC0;
+  static const int opPixel = 0xFE;
+  static const int runMax = 62;
+
+  static int _hash(int px) => (((px >> 11) & 0x1F) * 3 + ((px >> 5) & 0x3F) * 5 + (px & 0x1F) * 7) & 63;
+
+  // Signed difference wrapped to a bits-wide channel
+  static int _wrap(int diff, int bits) {
+    final range = 1 << bits;
+    diff &= range - 1;
+    return diff >= range ~/ 2 ? diff - range : diff;
+  }
+
+  static int _halfDg(int dg) => (dg + 32) ~/ 2 - 16;
+
+  // Encode big-endian RGB565 pixel bytes, as sent raw to the image characteristic
+  static Q565Encoded encode(List<int> pixelBytes) {
+    final count = pixelBytes.length ~/ 2;
+    final out = Uint8List(count * 3);
+    final byteEnds = Int32List(count);
+    final pixelEnds = Int32List(count);
+    final index = List<int>.filled(64, 0);
+    int len = 0;
+    int ops = 0;
+    int prev = 0;
+    int run = 0;
+
+    void endOp(int pixelsCoded) {
+      byteEnds[ops] = len;
+      pixelEnds[ops] = pixelsCoded;
+      ops++;
+    }
+
+    for (int i = 0; i < count; i++) {
+      final px = (pixelBytes[2 * i] << 8) | pixelBytes[2 * i + 1];
+      if (px == prev) {
+        run++;
+        if (run == runMax || i + 1 == count) {
+          out[len++] = opRun | (run - 1);
+          endOp(i + 1);
+          run = 0;
+        }
+        continue;
+      }
+      if (run > 0) {
+        out[len++] = opRun | (run - 1);
+        endOp(i);
+        run = 0;
+      }
+
+      final h = _hash(px);
+      if (index[h] == px) {
+        out[len++] = opIndex | h;
+      } else {
+        index[h] = px;
+        final dr = _wrap(((px >> 11) & 0x1F) - ((prev >> 11) & 0x1F), 5);
+        final dg = _wrap(((px >> 5) & 0x3F) - ((prev >> 5) & 0x3F), 6);
+        final db = _wrap((px & 0x1F) - (prev & 0x1F), 5);
+        final half = _halfDg(dg);
+        final drDg = dr - half;
+        final dbDg = db - half;
+
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          out[len++] = opDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+        } else if (drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7) {
+          out[len++] = opLuma | (dg + 32);
+          out[len++] = ((drDg + 8) << 4) | (dbDg + 8);
+        } else {
+          out[len++] = opPixel;
+          out[len++] = px >> 8;
+          out[len++] = px & 0xFF;
+        }
+      }
+      endOp(i + 1);
+      prev = px;
+    }
+
+    return Q565Encoded(
+      Uint8List.sublistView(out, 0, len),
+      Int32List.sublistView(byteEnds, 0, ops),
+      Int32List.sublistView(pixelEnds, 0, ops),
+    );
+  }
+}
@@ -0,0 +1,200 @@
+import 'dart:async';
+
+import 'package:flutter_blue_plus/flutter_blue_plus.dart';
+
+import 'image_codec.dart';
+import 'link_info.dart';
+
+// Streams RGB565 pixels into a screen window over the image characteristic
+// (0xFF06). Every write starts with an opcode:
+//   OPEN  0x01 x y w h [encoding]  (uint16 little-endian each, write with response)
+//   DATA  0x02 pixels              (write without response)
+//   ABORT 0x03
+// Pixels are big-endian RGB565, row-major (encoding 0), or Q565 compressed
+// (encoding 1, see image_codec.dart).
+// The device notifies acknowledgements on the same characteristic:
+//   uint16 image id, uint8 state, uint8 reserved, uint32 bytes drawn, uint32 byte limit
+// Pixel bytes are only written while bytes sent < limit; the limit grows as
+// the device draws rows, so the link stays busy without overrunning it.
+// The limit counts decoded pixel bytes, so compressed data is cut at op
+// boundaries that decode to no more than the limit.
+class ImageUpload {
+  static const int opOpen = 0x01;
+  static const int opData = 0x02;
+  static const int opAbort = 0x03;
+
+  static const int encodingRaw = 0;
+  static const int encodingQ565 = 1;
+
+  static const int stateReceiving = 0;
+  static const int stateDrawn = 1;
+  static const int stateError = 2;
+
+  final BluetoothDevice device;
+  final BluetoothCharacteristic imageCharacteristic;
+
+  StreamSubscription<List<int>>? _ackSubscription;
+  int? _imageId;
+  int _limit = 0;
+  int drawn = 0;
+  int sent = 0;      // pixel bytes sent (decoded size)
+  int total = 0;
+  int wireBytes = 0; // bytes on the air, after compression
+  Completer<void>? _limitRaised;
+  Completer<void>? _done;
+  DateTime? _started;
+  DateTime? _finished;
+
+  ImageUpload({
+    required this.device,
+    required this.imageCharacteristic,
+  });
+
+  bool get busy => _done != null && !_done!.isCompleted;
+
+  double get bytesPerSecond {
+    if (_started == null) {
+      return 0;
+    }
+    final end = _finished ?? DateTime.now();
+    final micros = end.difference(_started!).inMicroseconds;
+    return micros > 0 ? drawn * 1000000 / micros : 0;
+  }
+
+  Future<void> start() async {
+    _ackSubscription = imageCharacteristic.onValueReceived.listen(_onAck);
+    await imageCharacteristic.setNotifyValue(true);
+  }
+
+  Future<void> stop() async {
+    await _ackSubscription?.cancel();
+    _ackSubscription = null;
+  }
+
+  void _onAck(List<int> value) {
+    if (value.length < 12) {
+      return;
+    }
+    final imageId = value[0] | (value[1] << 8);
+    final state = value[2];
+    // The first acknowledgement after OPEN names the new image
+    _imageId ??= imageId;
+    if (imageId != _imageId) {
+      return;
+    }
+
+    if (state == stateError) {
+      if (!(_done?.isCompleted ?? true)) {
+        _done!.completeError(StateError('Device rejected image $imageId'));
+      }
+      _limitRaised?.complete();
+      _limitRaised = null;
+      return;
+    }
+    drawn = value[4] | (value[5] << 8) | (value[6] << 16) | (value[7] << 24);
+    _limit = value[8] | (value[9] << 8) | (value[10] << 16) | (value[11] << 24);
+    _limitRaised?.complete();
+    _limitRaised = null;
+    if (state == stateDrawn && !(_done?.isCompleted ?? true)) {
+      _finished = DateTime.now();
+      _done!.complete();
+    }
+  }
+
+  Future<void> _waitForLimit() async {
+    _limitRaised = Completer<void>();
+    await _limitRaised!.future;
+  }
+
+  // Draw pixels (big-endian RGB565, w * h * 2 bytes) at (x, y); completes once the device drew them.
+  // With compress, Q565 is only used when it is smaller than the raw pixels.
+  Future<void> send(int x, int y, int w, int h, List<int> pixels, {bool compress = false}) async {
+    if (pixels.length != w * h * 2) {
+      throw ArgumentError('Expected ${w * h * 2} pixel bytes, got ${pixels.length}');
+    }
+    var encoded = compress ? Q565Encoder.encode(pixels) : null;
+    if (encoded != null && encoded.bytes.length >= pixels.length) {
+      // Noise-like content grows under Q565: send it raw
+      encoded = null;
+    }
+    _imageId = null;
+    _limit = 0;
+    drawn = 0;
+    sent = 0;
+    wireBytes = 0;
+    total = pixels.length;
+    _done = Completer<void>();
+    _started = DateTime.now();
+    _finished = null;
+
+    await imageCharacteristic.write([
+      opOpen,
+      x & 0xFF, x >> 8,
+      y & 0xFF, y >> 8,
+      w & 0xFF, w >> 8,
+      h & 0xFF, h >> 8,
+      encoded != null ? encodingQ565 : encodingRaw,
+    ]);
+
+    // Every write is at most one full packet, less the opcode byte
+    final chunkSize = writePayload(device) - 1;
+    int op = 0;
+    while (sent < total && !_done!.isCompleted) {
+      if (sent >= _limit) {
+        await _waitForLimit();
+        continue;
+      }
+      List<int> chunk;
+      if (encoded == null) {
+        final end = [sent + chunkSize, _limit, total].reduce((a, b) => a < b ? a : b);
+        chunk = pixels.sublist(sent, end);
+        sent = end;
+      } else {
+        // Whole ops only, as many as fit in a packet and decode within the limit
+        final start = op == 0 ? 0 : encoded.opByteEnds[op - 1];
+        int last = op;
+        while (last < encoded.opCount &&
+            encoded.opByteEnds[last] - start <= chunkSize &&
+            encoded.opPixelEnds[last] * 2 <= _limit) {
+          last++;
+        }
+        if (last == op) {
+          await _waitForLimit();
+          continue;
+        }
+        chunk = encoded.bytes.sublist(start, encoded.opByteEnds[last - 1]);
+        sent = encoded.opPixelEnds[last - 1] * 2;
+        op = last;
+      }
+      wireBytes += chunk.length;
+      await imageCharacteristic.write([opData, ...chunk], withoutResponse: true);
+    }
+    await _done!.future;
+  }
+
+  Future<void> abort() async {
+    await imageCharacteristic.write([opAbort]);
+    if (!(_done?.isCompleted ?? true)) {
+      _done!.completeError(StateError('Aborted'));
+    }
+    _limitRaised?.complete();
+    _limitRaised = null;
+  }
+
+  // Diagonal RGB gradient, handy for spotting dropped or misplaced rows
+  static List<int> testPattern(int w, int h) {
+    final pixels = List<int>.filled(w * h * 2, 0);
+    for (int y = 0; y < h; y++) {
+      for (int x = 0; x < w; x++) {
+        final r = (x * 31) ~/ (w > 1 ? w - 1 : 1);
+        final g = (y * 63) ~/ (h > 1 ? h - 1 : 1);
+        final b = 31 - r;
+        final rgb565 = (r << 11) | (g << 5) | b;
+        final i = (y * w + x) * 2;
+        pixels[i] = rgb565 >> 8;
+        pixels[i + 1] = rgb565 & 0xFF;
+      }
+    }
+    return pixels;
+  }
+}
@@ -0,0 +1,120 @@
+import 'dart:async';
+
+import 'package:flutter_blue_plus/flutter_blue_plus.dart';
+
+// End-to-end command latency reported by the stats characteristic (0xFF08),
+// see esp32_iot_program/main/latency_stats.h for the layout:
+//   header: uint8 version, uint8 unit (us), uint16 entry count
+//   entry:  uint8 command type, uint8 stage, uint32 samples, uint16 p50, p95, p99
+//   then label cache counters: uint32 hits, misses, evictions, uint16 entries, uint16 KB used
+// Reads return every stage; notifications (about once per second while
+// commands arrive) carry only the total stage. Both end with the label cache counters.
+class LatencyEntry {
+  final int type;
+  final int stage;
+  final int count;
+  // Percentiles in milliseconds; null when beyond the histogram range
+  final double? p50;
+  final double? p95;
+  final double? p99;
+
+  LatencyEntry(this.type, this.stage, this.count, this.p50, this.p95, this.p99);
+}
+
+class LabelCacheStats {
+  final int hits;
+  final int misses;
+  final int evictions;
+  final int entries;
+  final int kbUsed;
+
+  LabelCacheStats(this.hits, this.misses, this.evictions, this.entries, this.kbUsed);
+
+  double get hitRate => hits + misses > 0 ? hits / (hits + misses) : 0;
+}
+
+class LatencyStats {
+  static const List<String> typeNames = [
+    'Color 565', 'Color 888', 'Text', 'Status', 'Frame', 'Long text',
+  ];
+  static const List<String> stageNames = ['parse', 'wait', 'render', 'flush', 'total'];
+  static const int stageTotal = 4;
+
+  final BluetoothCharacteristic statsCharacteristic;
+  StreamSubscription<List<int>>? _subscription;
+
+  // Latest entry per (type, stage), keyed type * 16 + stage
+  final Map<int, LatencyEntry> _entries = {};
+
+  // Rendered label cache on the device, null until firmware reports it
+  LabelCacheStats? labelCache;
+
+  // Called whenever new numbers arrived
+  void Function()? onChanged;
+
+  LatencyStats({required this.statsCharacteristic});
+
+  Future<void> start() async {
+    _subscription = statsCharacteristic.onValueReceived.listen(_parse);
+    await statsCharacteristic.setNotifyValue(true);
+    await refresh();
+  }
+
+  Future<void> stop() async {
+    await _subscription?.cancel();
+    _subscription = null;
+  }
+
+  // Read the full breakdown; onValueReceived delivers it to _parse
+  Future<void> refresh() async {
+    await statsCharacteristic.read();
+  }
+
+  LatencyEntry? entry(int type, int stage) => _entries[type * 16 + stage];
+
+  // Command types with samples, in protocol order
+  List<int> get types {
+    final result = _entries.values.map((e) => e.type).toSet().toList();
+    result.sort();
+    return result;
+  }
+
+  static String typeName(int type) => type < typeNames.length ? typeNames[type] : 'Type $type';
+
+  void _parse(List<int> value) {
+    if (value.length < 4 || value[0] != 1) {
+      return;
+    }
+    final unitUs = value[1];
+    final count = value[2] | (value[3] << 8);
+    double? ms(int units) => units == 0xFFFF ? null : units * unitUs / 1000.0;
+    int le32(int p) => value[p] | (value[p + 1] << 8) | (value[p + 2] << 16) | (value[p + 3] << 24);
+    for (int i = 0; i < count; i++) {
+      final p = 4 + i * 12;
+      if (p + 12 > value.length) {
+        break;
+      }
+      final samples = le32(p + 2);
+      final entry = LatencyEntry(
+        value[p],
+        value[p + 1],
+        samples,
+        ms(value[p + 6] | (value[p + 7] << 8)),
+        ms(value[p + 8] | (value[p + 9] << 8)),
+        ms(value[p + 10] | (value[p + 11] << 8)),
+      );
+      _entries[entry.type * 16 + entry.stage] = entry;
+    }
+    final c = 4 + count * 12;
+    if (value.length >= c + 16) {
+      labelCache = LabelCacheStats(
+        le32(c),
+        le32(c + 4),
+        le32(c + 8),
+        value[c + 12] | (value[c + 13] << 8),
+        value[c + 14] | (value[c + 15] << 8),
+      );
+    }
+    onChanged?.call();
+  }
+}
@@ -0,0 +1,72 @@
+import 'dart:async';
+import 'dart:io';
+
+import 'package:flutter_blue_plus/flutter_blue_plus.dart';
+
+// Largest ATT MTU a client may ask for; the connection settles on the smaller of this and the
+// device's limit (500)
+const int requestedMtu = 517;
+
+// Ask for the largest MTU. Android only negotiates on request; iOS does it on its own when
+// connecting and refuses the request.
+Future<void> requestLargestMtu(BluetoothDevice device) async {
+  if (!Platform.isAndroid) {
+    return;
+  }
+  try {
+    final mtu = await device.requestMtu(requestedMtu);
+    print('[BLE] MTU $mtu');
+  } catch (e) {
+    print('[BLE] MTU request failed, staying at ${device.mtuNow}: $e');
+  }
+}
+
+// Bytes one write carries on the current connection: the ATT header takes 3 bytes of the MTU.
+// Bulk transfers split their data into writes of exactly this size.
+int writePayload(BluetoothDevice device) => device.mtuNow - 3;
+
+// Link limits reported by the device on the link characteristic (0xFF0B), read once and
+// notified again after an MTU exchange, little-endian:
+//   uint8 version, uint8 reserved, uint16 MTU, uint16 largest MTU the device accepts,
+//   uint16 largest single write, uint16 largest long (prepared) write value
+class LinkInfo {
+  final BluetoothCharacteristic linkCharacteristic;
+  StreamSubscription<List<int>>? _subscription;
+
+  int mtu = 23;
+  int maxMtu = 23;
+  int maxWrite = 20;
+  int maxLongWrite = 0;
+
+  // Called whenever new limits arrived
+  void Function()? onChanged;
+
+  LinkInfo({required this.linkCharacteristic});
+
+  Future<void> start() async {
+    _subscription = linkCharacteristic.onValueReceived.listen(_parse);
+    await linkCharacteristic.setNotifyValue(true);
+    await linkCharacteristic.read();
+  }
+
+  Future<void> stop() async {
+    await _subscription?.cancel();
+    _subscription = null;
+  }
+
+  static int _le16(List<int> v, int i) => v[i] | (v[i + 1] << 8);
+
+  void _parse(List<int> value) {
+    if (value.length < 10) {
+      return;
+    }
+    mtu = _le16(value, 2);
+    maxMtu = _le16(value, 4);
+    maxWrite = _le16(value, 6);
+    maxLongWrite = _le16(value, 8);
+    onChanged?.call();
+  }
+
+  // Whether a value of len bytes can be written, in one write or as a long write
+  bool fits(int len) => len <= maxWrite || len <= maxLongWrite;
+}
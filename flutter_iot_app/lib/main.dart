@@ -1,3 +1,4 @@
+import 'dart:async';
 import 'dart:convert';
 import 'package:flutter/material.dart';
 import 'package:flutter_blue_plus/flutter_blue_plus.dart';
@@ -5,6 +6,15 @@ import 'package:permission_handler/permission_handler.dart';
 import 'package:flex_color_picker/flex_color_picker.dart';
 import 'package:shared_preferences/shared_preferences.dart';
 
+import 'advertised_state.dart';
+import 'asset_upload.dart';
+import 'command_queue.dart';
+import 'display_protocol.dart';
+import 'image_upload.dart';
+import 'latency_stats.dart';
+import 'link_info.dart';
+import 'throughput_test.dart';
+
 void main() {
   runApp(const MyApp());
 }
@@ -129,7 +139,8 @@ class _BluetoothScannerPageState extends State<BluetoothScannerPage> {
 
       // Try to connect
       print('[AutoConnect] Connecting to device...');
-      await device.connect(timeout: const Duration(seconds: 5));
+      // The MTU is negotiated by the device page, see requestLargestMtu
+      await device.connect(timeout: const Duration(seconds: 5), mtu: null);
       print('[AutoConnect] Connected successfully!');
 
       if (mounted) {
@@ -218,7 +229,7 @@ class _BluetoothScannerPageState extends State<BluetoothScannerPage> {
   Future<void> _connectToDevice(BluetoothDevice device) async {
     try {
       print('[BLE] Attempting to connect to ${device.platformName} (${device.remoteId})');
-      await device.connect();
+      await device.connect(mtu: null);
       print('[BLE] Connection successful!');
 
       // Save the device for auto-reconnect
@@ -342,6 +353,8 @@ class _BluetoothScannerPageState extends State<BluetoothScannerPage> {
                     itemBuilder: (context, index) {
                       final result = scanResults[index];
                       final device = result.device;
+                      // What the screen shows, advertised by the device
+                      final state = AdvertisedState.fromScan(result);
 
                       return Card(
                         margin: const EdgeInsets.symmetric(
@@ -349,7 +362,12 @@ class _BluetoothScannerPageState extends State<BluetoothScannerPage> {
                           vertical: 8,
                         ),
                         child: ListTile(
-                          leading: const Icon(Icons.bluetooth, color: Colors.blue),
+                          leading: state == null
+                              ? const Icon(Icons.bluetooth, color: Colors.blue)
+                              : CircleAvatar(
+                                  backgroundColor: state.background,
+                                  child: const Icon(Icons.bluetooth, color: Colors.white),
+                                ),
                           title: Text(
                             device.platformName.isNotEmpty
                                 ? device.platformName
@@ -361,6 +379,9 @@ class _BluetoothScannerPageState extends State<BluetoothScannerPage> {
                             children: [
                               Text('ID: ${device.remoteId}'),
                               Text('RSSI: ${result.rssi} dBm'),
+                              if (state != null)
+                                Text('Firmware ${state.firmwareVersion}, state '
+                                    '${state.stateHash.toRadixString(16).padLeft(8, '0')}'),
                             ],
                           ),
                           trailing: ElevatedButton(
@@ -397,6 +418,19 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
   final TextEditingController _textController = TextEditingController();
   BluetoothCharacteristic? _textCharacteristic;
   BluetoothCharacteristic? _colorCharacteristic;
+  BluetoothCharacteristic? _commandCharacteristic;
+  BluetoothCharacteristic? _streamCharacteristic;
+  BluetoothCharacteristic? _creditsCharacteristic;
+  CommandQueue? _commandQueue;
+  ImageUpload? _imageUpload;
+  String? _imageStatus;
+  AssetUpload? _assetUpload;
+  String? _assetStatus;
+  LatencyStats? _latencyStats;
+  LinkInfo? _linkInfo;
+  ThroughputTest? _throughputTest;
+  String? _throughputStatus;
+  double _brightness = 255;
   bool isDiscovering = true;
   bool isConnected = true;
   String statusMessage = 'Discovering services...';
@@ -406,11 +440,20 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
   static const String SERVICE_UUID_SHORT = "00ff";
   static const String COLOR_CHAR_UUID_SHORT = "ff01";
   static const String TEXT_CHAR_UUID_SHORT = "ff02";
+  static const String COMMAND_CHAR_UUID_SHORT = "ff03";
+  static const String STREAM_CHAR_UUID_SHORT = "ff04";
+  static const String CREDITS_CHAR_UUID_SHORT = "ff05";
+  static const String IMAGE_CHAR_UUID_SHORT = "ff06";
+  static const String STATS_CHAR_UUID_SHORT = "ff08";
+  static const String ASSET_CHAR_UUID_SHORT = "ff09";
+  static const String THROUGHPUT_CHAR_UUID_SHORT = "ff0a";
+  static const String LINK_CHAR_UUID_SHORT = "ff0b";
 
   // Full 128-bit UUIDs
   static const String SERVICE_UUID = "0000ff00-0000-1000-8000-00805f9b34fb";
   static const String COLOR_CHAR_UUID = "0000ff01-0000-1000-8000-00805f9b34fb";
   static const String TEXT_CHAR_UUID = "0000ff02-0000-1000-8000-00805f9b34fb";
+  static const String COMMAND_CHAR_UUID = "0000ff03-0000-1000-8000-00805f9b34fb";
 
   @override
   void initState() {
@@ -458,6 +501,8 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
 
   Future<void> _discoverServices() async {
     try {
+      // Largest MTU first, so every transfer below is chunked to it
+      await requestLargestMtu(widget.device);
       print('[BLE] Starting service discovery...');
       List<BluetoothService> services = await widget.device.discoverServices();
       print('[BLE] Found ${services.length} services');
@@ -489,6 +534,11 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
                              charUuidStr == TEXT_CHAR_UUID_SHORT.toLowerCase() ||
                              charUuidStr.contains(TEXT_CHAR_UUID_SHORT.toLowerCase());
 
+            // Check if this is the batched command characteristic (newer firmware only)
+            bool isCommandChar = charUuidStr == COMMAND_CHAR_UUID.toLowerCase() ||
+                                charUuidStr == COMMAND_CHAR_UUID_SHORT.toLowerCase() ||
+                                charUuidStr.contains(COMMAND_CHAR_UUID_SHORT.toLowerCase());
+
             if (isColorChar) {
               print('[BLE] Found color characteristic!');
               print('[BLE] Properties: read=${characteristic.properties.read}, write=${characteristic.properties.write}');
@@ -497,6 +547,80 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
               });
             }
 
+            if (isCommandChar) {
+              print('[BLE] Found command characteristic!');
+              setState(() {
+                _commandCharacteristic = characteristic;
+              });
+            }
+
+            // Streaming characteristics (write without response + credit notifications)
+            if (charUuidStr.contains(STREAM_CHAR_UUID_SHORT)) {
+              print('[BLE] Found stream characteristic!');
+              _streamCharacteristic = characteristic;
+            }
+            if (charUuidStr.contains(CREDITS_CHAR_UUID_SHORT)) {
+              print('[BLE] Found credits characteristic!');
+              _creditsCharacteristic = characteristic;
+            }
+
+            // Image streaming characteristic (windowed pixel upload)
+            if (charUuidStr.contains(IMAGE_CHAR_UUID_SHORT)) {
+              print('[BLE] Found image characteristic!');
+              final upload = ImageUpload(device: widget.device, imageCharacteristic: characteristic);
+              await upload.start();
+              setState(() {
+                _imageUpload = upload;
+              });
+            }
+
+            // Asset store characteristic (flash upload, shown by key from command frames)
+            if (charUuidStr.contains(ASSET_CHAR_UUID_SHORT)) {
+              print('[BLE] Found asset characteristic!');
+              final upload = AssetUpload(device: widget.device, assetCharacteristic: characteristic);
+              await upload.start();
+              setState(() {
+                _assetUpload = upload;
+              });
+            }
+
+            // Link limits: MTU and the largest write the device accepts (read + notify)
+            if (charUuidStr.contains(LINK_CHAR_UUID_SHORT)) {
+              print('[BLE] Found link characteristic!');
+              final info = LinkInfo(linkCharacteristic: characteristic);
+              info.onChanged = () {
+                print('[BLE] Link: MTU ${info.mtu} (device max ${info.maxMtu}), '
+                    '${info.maxWrite} bytes per write, ${info.maxLongWrite} per long write');
+              };
+              await info.start();
+              _linkInfo = info;
+            }
+
+            // Link throughput test (write without response + notify)
+            if (charUuidStr.contains(THROUGHPUT_CHAR_UUID_SHORT)) {
+              print('[BLE] Found throughput characteristic!');
+              final test = ThroughputTest(device: widget.device, throughputCharacteristic: characteristic);
+              await test.start();
+              setState(() {
+                _throughputTest = test;
+              });
+            }
+
+            // Command latency statistics (read + notify)
+            if (charUuidStr.contains(STATS_CHAR_UUID_SHORT)) {
+              print('[BLE] Found stats characteristic!');
+              final stats = LatencyStats(statsCharacteristic: characteristic);
+              stats.onChanged = () {
+                if (mounted) {
+                  setState(() {});
+                }
+              };
+              await stats.start();
+              setState(() {
+                _latencyStats = stats;
+              });
+            }
+
             if (isTextChar) {
               print('[BLE] Found text characteristic!');
               print('[BLE] Properties: read=${characteristic.properties.read}, write=${characteristic.properties.write}');
@@ -516,6 +640,26 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
         }
       }
 
+      // Every display command goes through one queue: on the credit stream when the firmware has
+      // it, otherwise as acknowledged writes to the command characteristic
+      if (_commandCharacteristic != null) {
+        final queue = CommandQueue(
+          device: widget.device,
+          commandCharacteristic: _commandCharacteristic!,
+          streamCharacteristic: _streamCharacteristic,
+          creditsCharacteristic: _creditsCharacteristic,
+        );
+        queue.onChanged = () {
+          if (mounted) {
+            setState(() {});
+          }
+        };
+        await queue.start();
+        setState(() {
+          _commandQueue = queue;
+        });
+      }
+
       // Check if we found the characteristics
       if (_colorCharacteristic != null || _textCharacteristic != null) {
         setState(() {
@@ -540,7 +684,23 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
     }
   }
 
+  // Values longer than one write go out as a long (prepared) write for the device to reassemble;
+  // a plain write would be cut to MTU - 3 bytes on some platforms
+  Future<void> _writeValue(BluetoothCharacteristic characteristic, List<int> value) async {
+    final info = _linkInfo;
+    if (info != null && !info.fits(value.length)) {
+      throw ArgumentError('${value.length} bytes, the device takes at most ${info.maxLongWrite}');
+    }
+    await characteristic.write(value, allowLongWrite: value.length > writePayload(widget.device));
+  }
+
   Future<void> _sendToDisplay() async {
+    // Firmware with the command characteristic takes color and text in one frame through the queue
+    if (_commandQueue != null) {
+      await _sendFrameToDisplay();
+      return;
+    }
+
     bool colorSent = false;
     bool textSent = false;
     String message = '';
@@ -574,7 +734,7 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
         List<int> bytes = utf8.encode(text);
         print('[BLE] Sending text: "$text" (${bytes.length} bytes)');
 
-        await _textCharacteristic!.write(bytes);
+        await _writeValue(_textCharacteristic!, bytes);
         print('[BLE] Text write successful!');
         textSent = true;
 
@@ -633,6 +793,61 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
     }
   }
 
+  Future<void> _sendFrameToDisplay() async {
+    final text = _textController.text;
+    final DisplayFrame frame = DisplayFrame().setBackground(selectedColor);
+
+    try {
+      if (text.isNotEmpty) {
+        frame.setText(text);
+      }
+      List<int> bytes = frame.build();
+      final info = _linkInfo;
+      if (info != null && !info.fits(bytes.length)) {
+        throw ArgumentError('${bytes.length} bytes, the device takes at most ${info.maxLongWrite}');
+      }
+      print('[BLE] Queueing command frame (${bytes.length} bytes)');
+
+      // Clear before waiting: the next message may be typed while this one is queued
+      _textController.clear();
+      await _commandQueue!.send(bytes);
+      print('[BLE] Command frame write successful!');
+    } catch (e) {
+      print('[BLE] Command frame write failed: $e');
+      if (mounted) {
+        ScaffoldMessenger.of(context).showSnackBar(
+          SnackBar(
+            content: Text('Failed to send to display: $e'),
+            backgroundColor: Colors.red,
+          ),
+        );
+      }
+      return;
+    }
+
+    if (mounted) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        SnackBar(
+          content: Row(
+            children: [
+              Container(
+                width: 20,
+                height: 20,
+                decoration: BoxDecoration(
+                  color: selectedColor,
+                  border: Border.all(color: Colors.white, width: 2),
+                ),
+              ),
+              const SizedBox(width: 8),
+              Expanded(child: Text(text.isNotEmpty ? 'Color and text sent!' : 'Color sent!')),
+            ],
+          ),
+          backgroundColor: Colors.green,
+        ),
+      );
+    }
+  }
+
   // Convert Color to hex string format (easier and supported by ESP32)
   String _colorToHexString(Color color) {
     // Extract RGB components (0-255)
@@ -716,8 +931,170 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
     }
   }
 
+  // Live brightness: every slider movement is queued, only the newest value waits for a write
+  void _onBrightnessChanged(double value) {
+    setState(() {
+      _brightness = value;
+    });
+    _commandQueue?.post(DisplayFrame().setBrightness(value.round()).build());
+  }
+
+  // Full-screen test pattern through the image characteristic, Q565 compressed
+  Future<void> _sendTestPattern() async {
+    final upload = _imageUpload!;
+    const width = 320;
+    const height = 172;
+    final timer = Timer.periodic(const Duration(milliseconds: 250), (_) {
+      setState(() {
+        _imageStatus = 'Sent ${upload.sent} / ${upload.total} bytes (${upload.wireBytes} on air), '
+            'drawn ${upload.drawn} (${(upload.bytesPerSecond / 1024).toStringAsFixed(1)} KB/s)';
+      });
+    });
+    try {
+      await upload.send(0, 0, width, height, ImageUpload.testPattern(width, height), compress: true);
+      setState(() {
+        _imageStatus = 'Drew ${upload.total} bytes from ${upload.wireBytes} on air at '
+            '${(upload.bytesPerSecond / 1024).toStringAsFixed(1)} KB/s';
+      });
+    } catch (e) {
+      print('[Image] Upload failed: $e');
+      setState(() {
+        _imageStatus = 'Upload failed: $e';
+      });
+    } finally {
+      timer.cancel();
+    }
+  }
+
+  // Show a test pattern by its key: the pixels are only sent when the device does not have them,
+  // after that it is a 16-byte frame op
+  Future<void> _showTestAsset() async {
+    const size = 96;
+    final upload = _assetUpload!;
+    try {
+      final image = AssetUpload.lvglImage(size, size, ImageUpload.testPattern(size, size));
+      final started = DateTime.now();
+      setState(() {
+        _assetStatus = 'Checking ${image.length} bytes...';
+      });
+      final known = upload.contains(AssetUpload.keyOf(image));
+      final key = await upload.ensure(AssetUpload.typeImage, image);
+      final ms = DateTime.now().difference(started).inMilliseconds;
+      _assetStatus = known || upload.sent == 0
+          ? 'Already stored as ${AssetUpload.keyHex(key)}'
+          : 'Stored ${image.length} bytes in $ms ms';
+      final frame = DisplayFrame().showAsset(key, 8, 8).build();
+      await _commandQueue!.send(frame);
+      setState(() {
+        _assetStatus = '${_assetStatus ?? ''}\nShown with a ${frame.length}-byte frame';
+      });
+    } catch (e) {
+      print('[Asset] Failed: $e');
+      setState(() {
+        _assetStatus = 'Asset failed: $e';
+      });
+    }
+  }
+
+  // Goodput both ways for a few seconds each, with the link parameters the device saw
+  Future<void> _measureThroughput() async {
+    final test = _throughputTest!;
+    const duration = Duration(seconds: 3);
+    String describe(String label, ThroughputResult r) =>
+        '$label: ${(r.bytesPerSecond / 1024).toStringAsFixed(1)} KB/s';
+    try {
+      setState(() {
+        _throughputStatus = 'Measuring app to device...';
+      });
+      final up = await test.measureToDevice(duration);
+      setState(() {
+        _throughputStatus = '${describe('To device', up)}\nMeasuring device to app...';
+      });
+      final down = await test.measureFromDevice(duration);
+      setState(() {
+        _throughputStatus = '${describe('To device', up)}\n'
+            '${describe('From device', down)} (${test.received} of ${down.bytes} bytes arrived)\n'
+            'PHY ${ThroughputResult.phyName(down.txPhy)}/${ThroughputResult.phyName(down.rxPhy)}, '
+            'interval ${down.intervalMs.toStringAsFixed(2)} ms, MTU ${down.mtu}';
+      });
+    } catch (e) {
+      print('[Throughput] Failed: $e');
+      setState(() {
+        _throughputStatus = 'Throughput test failed: $e';
+      });
+    }
+  }
+
+  // App-side latency per op type, from the queue to the device taking the frame
+  List<Widget> _buildQueueLatencyRows() {
+    final latency = _commandQueue!.latency;
+    final types = latency.keys.toList()..sort();
+    return types.map((type) {
+      final l = latency[type]!;
+      return Text(
+        '${DisplayFrame.opNames[type] ?? 'Op $type'}: last ${l.lastMs.toStringAsFixed(1)} ms, '
+        'median ${l.medianMs.toStringAsFixed(1)}, max ${l.maxMs.toStringAsFixed(1)} (n=${l.count})',
+        style: TextStyle(fontSize: 12, color: Colors.grey.shade600),
+      );
+    }).toList();
+  }
+
+  // One line per command type: end-to-end percentiles, then the median of every stage
+  List<Widget> _buildLatencyRows() {
+    final stats = _latencyStats!;
+    final types = stats.types;
+    if (types.isEmpty) {
+      return [
+        Text('No commands measured yet', style: TextStyle(fontSize: 12, color: Colors.grey.shade600)),
+      ];
+    }
+    String fmt(double? ms) => ms == null ? '>115' : ms.toStringAsFixed(1);
+    return types.map((type) {
+      final total = stats.entry(type, LatencyStats.stageTotal);
+      final stages = <String>[];
+      for (int stage = 0; stage < LatencyStats.stageTotal; stage++) {
+        final e = stats.entry(type, stage);
+        if (e != null) {
+          stages.add('${LatencyStats.stageNames[stage]} ${fmt(e.p50)}');
+        }
+      }
+      return Padding(
+        padding: const EdgeInsets.only(bottom: 4.0),
+        child: Column(
+          crossAxisAlignment: CrossAxisAlignment.start,
+          children: [
+            Text(
+              total == null
+                  ? LatencyStats.typeName(type)
+                  : '${LatencyStats.typeName(type)}: p50 ${fmt(total.p50)}, p95 ${fmt(total.p95)}, '
+                      'p99 ${fmt(total.p99)} (n=${total.count})',
+              style: const TextStyle(fontSize: 14),
+            ),
+            if (stages.isNotEmpty)
+              Text(
+                'median ${stages.join(', ')}',
+                style: TextStyle(fontSize: 12, color: Colors.grey.shade600),
+              ),
+          ],
+        ),
+      );
+    }).toList();
+  }
+
+  Widget _buildLabelCacheRow(LabelCacheStats c) {
+    return Text(
+      'Label cache: ${c.hits} hits, ${c.misses} misses (${(c.hitRate * 100).toStringAsFixed(0)}%), '
+      '${c.evictions} evictions, ${c.entries} entries, ${c.kbUsed} KB',
+      style: TextStyle(fontSize: 12, color: Colors.grey.shade600),
+    );
+  }
+
   @override
   void dispose() {
+    _latencyStats?.stop();
+    _imageUpload?.stop();
+    _assetUpload?.stop();
+    _commandQueue?.stop();
     _textController.dispose();
     super.dispose();
   }
@@ -891,6 +1268,124 @@ class _DeviceControlPageState extends State<DeviceControlPage> {
             ),
             const SizedBox(height: 24),
 
+            // Live brightness section (command frame firmware only)
+            if (_commandQueue != null) ...[
+              const Text(
+                'Backlight Brightness:',
+                style: TextStyle(
+                  fontSize: 18,
+                  fontWeight: FontWeight.bold,
+                ),
+              ),
+              Slider(
+                value: _brightness,
+                min: 0,
+                max: 255,
+                onChanged: isConnected ? _onBrightnessChanged : null,
+              ),
+              Text(
+                'Sent ${_commandQueue!.sent} frames '
+                '(${_commandQueue!.opsPerSecond.toStringAsFixed(1)} ops/s), '
+                '${_commandQueue!.superseded} superseded, '
+                '${_commandQueue!.inFlight} in flight, '
+                '${_commandQueue!.deviceDropped} dropped by device',
+                style: TextStyle(
+                  fontSize: 12,
+                  color: Colors.grey.shade600,
+                ),
+              ),
+              ..._buildQueueLatencyRows(),
+              const SizedBox(height: 24),
+            ],
+
+            // Image streaming section (image firmware only)
+            if (_imageUpload != null) ...[
+              ElevatedButton.icon(
+                onPressed: isConnected && !_imageUpload!.busy ? _sendTestPattern : null,
+                icon: const Icon(Icons.image),
+                label: const Text('Send Test Pattern'),
+              ),
+              if (_imageStatus != null)
+                Padding(
+                  padding: const EdgeInsets.only(top: 8.0),
+                  child: Text(
+                    _imageStatus!,
+                    style: TextStyle(
+                      fontSize: 12,
+                      color: Colors.grey.shade600,
+                    ),
+                  ),
+                ),
+              const SizedBox(height: 24),
+            ],
+
+            // Asset store section (asset firmware only)
+            if (_assetUpload != null && _commandCharacteristic != null) ...[
+              ElevatedButton.icon(
+                onPressed: isConnected && !_assetUpload!.busy ? _showTestAsset : null,
+                icon: const Icon(Icons.sd_storage),
+                label: const Text('Show Stored Asset'),
+              ),
+              if (_assetStatus != null)
+                Padding(
+                  padding: const EdgeInsets.only(top: 8.0),
+                  child: Text(
+                    _assetStatus!,
+                    style: TextStyle(
+                      fontSize: 12,
+                      color: Colors.grey.shade600,
+                    ),
+                  ),
+                ),
+              const SizedBox(height: 24),
+            ],
+
+            // Link throughput section (throughput firmware only)
+            if (_throughputTest != null) ...[
+              ElevatedButton.icon(
+                onPressed: isConnected && !_throughputTest!.busy ? _measureThroughput : null,
+                icon: const Icon(Icons.speed),
+                label: const Text('Measure Throughput'),
+              ),
+              if (_throughputStatus != null)
+                Padding(
+                  padding: const EdgeInsets.only(top: 8.0),
+                  child: Text(
+                    _throughputStatus!,
+                    style: TextStyle(
+                      fontSize: 12,
+                      color: Colors.grey.shade600,
+                    ),
+                  ),
+                ),
+              const SizedBox(height: 24),
+            ],
+
+            // Command latency section (stats firmware only)
+            if (_latencyStats != null) ...[
+              Row(
+                children: [
+                  const Expanded(
+                    child: Text(
+                      'Command Latency (ms):',
+                      style: TextStyle(
+                        fontSize: 18,
+                        fontWeight: FontWeight.bold,
+                      ),
+                    ),
+                  ),
+                  IconButton(
+                    onPressed: isConnected ? () => _latencyStats!.refresh() : null,
+                    icon: const Icon(Icons.refresh),
+                    tooltip: 'Read stage breakdown',
+                  ),
+                ],
+              ),
+              ..._buildLatencyRows(),
+              if (_latencyStats!.labelCache != null) _buildLabelCacheRow(_latencyStats!.labelCache!),
+              const SizedBox(height: 24),
+            ],
+
             // Text input section
             const Text(
               'Send Text to Display:',
@@ -0,0 +1,126 @@
+import 'dart:async';
+
+import 'package:flutter_blue_plus/flutter_blue_plus.dart';
+
+import 'link_info.dart';
+
+// Link goodput both ways over the throughput characteristic (0xFF0A).
+// Every write starts with an opcode, fields are little-endian:
+//   RX_START 0x01                      reset the device's receive counters
+//   DATA     0x02 filler               (write without response) counted by the device
+//   RX_STOP  0x03                      the device notifies the receive result
+//   TX_START 0x04 duration_ms(2)       the device notifies DATA filler for that long, then the result
+// Result notification:
+//   uint8 op (0x05), uint8 direction (0 to device, 1 from device), uint8 tx PHY, uint8 rx PHY,
+//   uint32 bytes, uint32 elapsed us, uint16 connection interval (1.25 ms units), uint16 MTU
+// PHYs are 1 for 1M, 2 for 2M and 3 for coded, as seen by the device.
+class ThroughputResult {
+  final int direction;
+  final int txPhy;
+  final int rxPhy;
+  final int bytes;
+  final int elapsedUs;
+  final int interval;
+  final int mtu;
+
+  ThroughputResult(this.direction, this.txPhy, this.rxPhy, this.bytes, this.elapsedUs, this.interval, this.mtu);
+
+  double get bytesPerSecond => elapsedUs > 0 ? bytes * 1000000 / elapsedUs : 0;
+
+  double get intervalMs => interval * 1.25;
+
+  static String phyName(int phy) => const {1: '1M', 2: '2M', 3: 'coded'}[phy] ?? '$phy';
+}
+
+class ThroughputTest {
+  static const int opRxStart = 0x01;
+  static const int opData = 0x02;
+  static const int opRxStop = 0x03;
+  static const int opTxStart = 0x04;
+  static const int opResult = 0x05;
+
+  static const int directionToDevice = 0;
+  static const int directionFromDevice = 1;
+
+  final BluetoothDevice device;
+  final BluetoothCharacteristic throughputCharacteristic;
+
+  StreamSubscription<List<int>>? _subscription;
+  Completer<ThroughputResult>? _result;
+  int _received = 0;
+  bool _busy = false;
+
+  ThroughputTest({
+    required this.device,
+    required this.throughputCharacteristic,
+  });
+
+  bool get busy => _busy;
+
+  // Filler bytes that arrived here during the last device-to-app run
+  int get received => _received;
+
+  Future<void> start() async {
+    _subscription = throughputCharacteristic.onValueReceived.listen(_onValue);
+    await throughputCharacteristic.setNotifyValue(true);
+  }
+
+  Future<void> stop() async {
+    await _subscription?.cancel();
+    _subscription = null;
+  }
+
+  static int _le16(List<int> v, int i) => v[i] | (v[i + 1] << 8);
+
+  static int _le32(List<int> v, int i) => v[i] | (v[i + 1] << 8) | (v[i + 2] << 16) | (v[i + 3] << 24);
+
+  void _onValue(List<int> value) {
+    if (value.isEmpty) {
+      return;
+    }
+    if (value[0] == opData) {
+      _received += value.length;
+    } else if (value[0] == opResult && value.length >= 16) {
+      final result = ThroughputResult(value[1], value[2], value[3], _le32(value, 4), _le32(value, 8),
+          _le16(value, 12), _le16(value, 14));
+      if (!(_result?.isCompleted ?? true)) {
+        _result!.complete(result);
+      }
+    }
+  }
+
+  // App to device: write MTU-sized filler without response for duration, the device times
+  // the bytes from the first to the last write it received
+  Future<ThroughputResult> measureToDevice(Duration duration) async {
+    _busy = true;
+    try {
+      await throughputCharacteristic.write([opRxStart]);
+      final chunk = List<int>.filled(writePayload(device), 0x5A);
+      chunk[0] = opData;
+      final end = DateTime.now().add(duration);
+      while (DateTime.now().isBefore(end)) {
+        await throughputCharacteristic.write(chunk, withoutResponse: true);
+      }
+      _result = Completer<ThroughputResult>();
+      await throughputCharacteristic.write([opRxStop]);
+      return await _result!.future.timeout(const Duration(seconds: 5));
+    } finally {
+      _busy = false;
+    }
+  }
+
+  // Device to app: the device notifies filler as fast as its controller takes it and reports
+  // what it sent; received counts what actually arrived here
+  Future<ThroughputResult> measureFromDevice(Duration duration) async {
+    _busy = true;
+    _received = 0;
+    try {
+      _result = Completer<ThroughputResult>();
+      final ms = duration.inMilliseconds;
+      await throughputCharacteristic.write([opTxStart, ms & 0xFF, (ms >> 8) & 0xFF]);
+      return await _result!.future.timeout(duration + const Duration(seconds: 5));
+    } finally {
+      _busy = false;
+    }
+  }
+}